@@ -3,12 +3,17 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 5) in ivec4 boneIds;
 layout (location = 6) in vec4 weights;
+layout (location = 7) in uint drawIndex;
 
 const int MAX_BONES = 500;
 const int MAX_BONE_INFLUENCE = 4;
 layout (binding = 8) uniform sampler2D boneMatrixTexture;
 
 uniform mat4 model;
+uniform bool useDrawData;
+layout (std430, binding = 6) buffer ModelMatrixBuffer{
+	mat4 modelMatrices[];
+};
 
 mat4 getBoneMatrix(int index)
 {
@@ -22,13 +27,14 @@ mat4 getBoneMatrix(int index)
 
 void main()
 {
+	mat4 modelMatrix = useDrawData ? modelMatrices[drawIndex] : model;
 	vec4 totalPosition = vec4(0.0);
 	bool hasBone = false;
 	for(int i = 0; i < MAX_BONE_INFLUENCE; i++)
 	{
 		if(boneIds[i] == -1)
 			continue;
-		if(weights[i] == -1.0)
+		if(weights[i] <= 0.0)
 			continue;
 		if(boneIds[i] >= MAX_BONES)
 		{
@@ -44,5 +50,5 @@ void main()
 	{
 		totalPosition = vec4(aPos, 1.0);
 	}
-	gl_Position = model * totalPosition;
+	gl_Position = modelMatrix * totalPosition;
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+#version 450 core
+
+// position (and skinning) only; gl_Position must match test.vert bit for bit for the GL_EQUAL color pass
+layout (location = 0) in vec3 aPos;
+layout (location = 5) in ivec4 boneIds;
+layout (location = 6) in vec4 weights;
+layout (location = 7) in uint drawIndex;
+
+const int MAX_BONES = 500;
+const int MAX_BONE_INFLUENCE = 4;
+
+layout (binding = 8) uniform sampler2D boneMatrixTexture;
+
+invariant gl_Position;
+
+uniform mat4 model;
+uniform bool useDrawData;
+layout (std430, binding = 6) buffer ModelMatrixBuffer{
+	mat4 modelMatrices[];
+};
+layout (std140, binding=0) uniform Matrices
+{
+	mat4 view;
+	mat4 projection;
+};
+
+mat4 getBoneMatrix(int index)
+{
+	return mat4(
+		texelFetch(boneMatrixTexture, ivec2(0, index), 0),
+		texelFetch(boneMatrixTexture, ivec2(1, index), 0),
+		texelFetch(boneMatrixTexture, ivec2(2, index), 0),
+		texelFetch(boneMatrixTexture, ivec2(3, index), 0)
+		);
+}
+
+void main()
+{
+	mat4 modelMatrix = useDrawData ? modelMatrices[drawIndex] : model;
+	vec4 totalPosition = vec4(0.0);
+	bool hasBone = false;
+	for(int i = 0; i < MAX_BONE_INFLUENCE; i++)
+	{
+		if(boneIds[i] == -1)
+			continue;
+		if(weights[i] <= 0.0)
+			continue;
+		if(boneIds[i] >= MAX_BONES)
+		{
+			totalPosition = vec4(aPos, 1.0);
+			break;
+		}
+		mat4 boneMatrix = getBoneMatrix(boneIds[i]);
+		totalPosition += boneMatrix * vec4(aPos, 1.0) * weights[i];
+		hasBone = true;
+	}
+	if(!hasBone)
+	{
+		totalPosition = vec4(aPos, 1.0);
+	}
+	gl_Position = projection * view * modelMatrix * totalPosition;
+}
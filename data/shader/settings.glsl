@@ -0,0 +1,6 @@
+#define PCF_SHADOW
+#define USE_HDR
+//#define USE_BLOOM
+//#define USE_ENVIRONMENT_MAPPING
+//#define USE_CLUSTERED_SHADING
+//#define USE_BINDLESS_TEXTURES
\ No newline at end of file
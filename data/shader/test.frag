@@ -1,5 +1,9 @@
 #version 450 core
 #include "data/shader/settings.glsl"
+#ifdef USE_BINDLESS_TEXTURES
+#extension GL_ARB_bindless_texture : require
+#extension GL_NV_gpu_shader5 : require
+#endif
 
 in VS_OUT{
 	vec3 normal;
@@ -7,6 +11,7 @@ in VS_OUT{
 	vec3 fragPos;
 	vec4 fragPosLightSpace;
 	mat3 TBN;
+	flat uint materialIndex;
 }fs_in;
 
 layout(location = 0) out vec4 fragColor;
@@ -26,6 +31,58 @@ layout (binding = 4) uniform sampler2D shininessMap;
 layout (binding = 6) uniform sampler2D shadowMap;
 layout (binding = 7) uniform samplerCubeArray shadowMapArray;
 
+uniform bool useMaterialTable;
+struct MaterialData{
+	uvec2 textures[5];
+	uint textureMask;
+	uint padding;
+};
+layout (std430, binding = 7) buffer MaterialBuffer{
+	MaterialData materials[];
+};
+#ifndef USE_BINDLESS_TEXTURES
+layout (binding = 9) uniform sampler2DArray materialArrays[7];
+#endif
+
+const int ALBEDO_SLOT = 0;
+const int AMBIENT_SLOT = 1;
+const int SPECULAR_SLOT = 2;
+const int NORMAL_SLOT = 3;
+
+bool isDefaultMaterial(){
+	return useMaterialTable ? materials[fs_in.materialIndex].textureMask == 0u : useDefaultMaterial;
+}
+
+bool materialHasNormalMap(){
+	return useMaterialTable ? (materials[fs_in.materialIndex].textureMask & (1u << NORMAL_SLOT)) != 0u : hasNormalMap;
+}
+
+vec4 sampleMaterial(int slot, sampler2D map, vec2 uv){
+	if(!useMaterialTable){
+		return texture(map, uv);
+	}
+	MaterialData material = materials[fs_in.materialIndex];
+	if((material.textureMask & (1u << slot)) == 0u){
+		return vec4(0.0, 0.0, 0.0, 1.0);
+	}
+	uvec2 ref = material.textures[slot];
+#ifdef USE_BINDLESS_TEXTURES
+	return texture(sampler2D(ref), uv);
+#else
+	vec3 coord = vec3(uv, float(ref.y));
+	switch(ref.x){
+		case 0u: return texture(materialArrays[0], coord);
+		case 1u: return texture(materialArrays[1], coord);
+		case 2u: return texture(materialArrays[2], coord);
+		case 3u: return texture(materialArrays[3], coord);
+		case 4u: return texture(materialArrays[4], coord);
+		case 5u: return texture(materialArrays[5], coord);
+		case 6u: return texture(materialArrays[6], coord);
+	}
+	return vec4(0.0, 0.0, 0.0, 1.0);
+#endif
+}
+
 uniform vec3 cameraPos;
 
 uniform int pointLightNum;
@@ -33,7 +90,8 @@ uniform int directionLightNum;
 uniform int spotLightNum;
 
 struct PointLight {
-	vec4 position;
+	vec3 position;
+	int shadowIndex;
 	vec3 color;
 	float brightness;
 	float constant;
@@ -70,16 +128,95 @@ layout (std430, binding = 3) buffer SpotLightBuffer{
 	SpotLight spotLights[];
 };
 
-vec3 calculatePointLight(vec3 albedoColor, vec3 specularColor, vec3 cameraDir, vec3 normal){
-	vec3 result;
+#ifdef USE_CLUSTERED_SHADING
+layout (std140, binding=0) uniform Matrices
+{
+	mat4 view;
+	mat4 projection;
+};
+
+// (offset, count) of each cluster in clusterLightIndices
+layout (std430, binding = 4) buffer ClusterGridBuffer{
+	uvec2 clusters[];
+};
+
+layout (std430, binding = 5) buffer ClusterLightIndexBuffer{
+	uint clusterLightIndices[];
+};
+
+uniform ivec3 clusterDims;
+uniform vec2 clusterTileSize;
+uniform float clusterScale;
+uniform float clusterBias;
+
+uint getClusterIndex(){
+	float depth = -(view * vec4(fs_in.fragPos, 1.0)).z;
+	int slice = clamp(int(floor(log(depth) * clusterScale + clusterBias)), 0, clusterDims.z - 1);
+	ivec2 tile = clamp(ivec2(gl_FragCoord.xy / clusterTileSize), ivec2(0), clusterDims.xy - 1);
+	return uint((slice * clusterDims.y + tile.y) * clusterDims.x + tile.x);
+}
+#endif
+
+vec3 calculateOnePointLight(int i, vec3 albedoColor, vec3 specularColor, vec3 cameraDir, vec3 normal){
+	float attenuation = 1.0 / (pointLights[i].constant + pointLights[i].linear * length(pointLights[i].position - fs_in.fragPos) + pointLights[i].quadratic * length(pointLights[i].position - fs_in.fragPos) * length(pointLights[i].position - fs_in.fragPos));
+	vec3 lightDir = normalize(pointLights[i].position - fs_in.fragPos);
+	float diff = max(dot(lightDir,normal),0);
+	vec3 halfway = normalize(cameraDir + lightDir);
+	float spec = pow(max(dot(halfway,normal),0),32);
+	return (diff * albedoColor + spec * specularColor) * pointLights[i].color * pointLights[i].brightness * attenuation;
+}
+
+float calculateOnePointLightShadow(int i, vec3 normal){
+	vec3 fragToLight = fs_in.fragPos - pointLights[i].position;
+	float currentDepth = length(fragToLight);
+	float bias = max(0.5 * (1.0 - dot(normal, normalize(fragToLight))), 0.05);
+	float farPlane = pointLights[i].farPlane;
+	int shadowIndex = pointLights[i].shadowIndex;
+	if(shadowIndex < 0 || currentDepth>farPlane){
+		return 0.0;
+	}
+#ifdef PCF_SHADOW
+	float offset = 0.1;
+	float samples = 4.0;
+	float shadow = 0;
+	for(float x = -offset; x < offset; x += offset / (samples * 0.5))
+	{
+		for(float y = -offset; y < offset; y += offset / (samples * 0.5))
+		{
+			for(float z = -offset; z < offset; z += offset / (samples * 0.5))
+			{
+				float closestDepth = texture(shadowMapArray, vec4(fragToLight+vec3(x,y,z), shadowIndex)).r;
+				closestDepth *= farPlane;
+				if(currentDepth - bias > closestDepth)
+					shadow += 0.75;
+			}
+		}
+	}
+	return shadow / (samples * samples * samples);
+#else
+	float closestDepth = texture(shadowMapArray, vec4(fragToLight, shadowIndex)).r;
+	closestDepth *= farPlane;
+	return currentDepth - bias > closestDepth ? 0.75 : 0.0;
+#endif
+}
+
+// 光照和阴影在同一个循环里累加，分簇时只查找影响本簇的点光源的阴影
+vec3 calculatePointLight(vec3 albedoColor, vec3 specularColor, vec3 cameraDir, vec3 normal, out float shadow){
+	vec3 result = vec3(0.0);
+	shadow = 0.0;
+#ifdef USE_CLUSTERED_SHADING
+	uvec2 cluster = clusters[getClusterIndex()];
+	for(uint j = 0; j < cluster.y; j++){
+		int i = int(clusterLightIndices[cluster.x + j]);
+		result += calculateOnePointLight(i, albedoColor, specularColor, cameraDir, normal);
+		shadow += calculateOnePointLightShadow(i, normal);
+	}
+#else
 	for(int i=0;i<pointLightNum;i++){
-		float attenuation = 1.0 / (pointLights[i].constant + pointLights[i].linear * length(pointLights[i].position.xyz - fs_in.fragPos) + pointLights[i].quadratic * length(pointLights[i].position.xyz - fs_in.fragPos) * length(pointLights[i].position.xyz - fs_in.fragPos));
-		vec3 lightDir = normalize(pointLights[i].position.xyz - fs_in.fragPos);
-		float diff = max(dot(lightDir,normal),0);
-		vec3 halfway = normalize(cameraDir + lightDir);
-		float spec = pow(max(dot(halfway,normal),0),32);
-		result += (diff * albedoColor + spec * specularColor) * pointLights[i].color * pointLights[i].brightness * attenuation;
+		result += calculateOnePointLight(i, albedoColor, specularColor, cameraDir, normal);
+		shadow += calculateOnePointLightShadow(i, normal);
 	}
+#endif
 	return result;
 }
 
@@ -115,7 +252,7 @@ vec3 calculateEnvironmentMapping(){
 	vec3 result;
 	vec3 cameraDir = normalize(cameraPos - fs_in.fragPos);
 	vec3 reflectionDir = reflect(cameraDir,fs_in.normal);
-	result = texture(skybox, reflectionDir).rgb*texture(ambientMap,fs_in.texCoords).rgb;
+	result = texture(skybox, reflectionDir).rgb*sampleMaterial(AMBIENT_SLOT, ambientMap, fs_in.texCoords).rgb;
 	return result;
 }	
 #endif
@@ -151,47 +288,9 @@ float calculateDirectionLightShadow(vec3 normal){
 	return shadow;
 }
 
-float calculatePointLightShadow(vec3 normal){
-	float shadow = 0;
-	for(int i = 0; i < pointLightNum; i++){
-		vec3 fragToLight = fs_in.fragPos - pointLights[i].position.xyz;
-		float currentDepth = length(fragToLight);
-		float bias = max(0.5 * (1.0 - dot(normal, normalize(fragToLight))), 0.05);
-		float farPlane = pointLights[i].farPlane;
-		if(currentDepth>farPlane){
-			continue;
-		}
-#ifdef PCF_SHADOW
-		float offset = 0.1;
-		float samples = 4.0;
-		float tempShadow = 0;
-		for(float x = -offset; x < offset; x += offset / (samples * 0.5))
-		{
-			for(float y = -offset; y < offset; y += offset / (samples * 0.5))
-			{
-				for(float z = -offset; z < offset; z += offset / (samples * 0.5))
-				{
-					float closestDepth = texture(shadowMapArray, vec4(fragToLight+vec3(x,y,z), i)).r;
-					closestDepth *= farPlane;
-					if(currentDepth - bias > closestDepth)
-						tempShadow += 0.75;
-				}
-			}
-		}
-		tempShadow /= samples * samples * samples;
-		shadow += tempShadow;
-#else
-		float closestDepth = texture(shadowMapArray, vec4(fragToLight, i)).r;
-		closestDepth *= farPlane;
-		shadow += currentDepth - bias > closestDepth ? 0.75 : 0.0;
-#endif
-	}
-	return shadow;
-}
-
 vec3 getNormal(bool hasNormalMap){
 	if(hasNormalMap){
-		vec3 normal = texture(normalMap, fs_in.texCoords).rgb;
+		vec3 normal = sampleMaterial(NORMAL_SLOT, normalMap, fs_in.texCoords).rgb;
 		normal = normalize(normal * 2.0 - 1.0);
 		return normalize(fs_in.TBN * normal);
 	}
@@ -202,30 +301,32 @@ vec3 getNormal(bool hasNormalMap){
 
 void main()
 {
+	bool defaultMaterial = isDefaultMaterial();
 	vec3 albedoColor;
-	if(useDefaultMaterial){
+	if(defaultMaterial){
 		albedoColor = vec3(0.5,0.5,0.5);
 	}else{
-		albedoColor = texture(albedoMap, fs_in.texCoords).rgb;
+		albedoColor = sampleMaterial(ALBEDO_SLOT, albedoMap, fs_in.texCoords).rgb;
 	}
 	albedoColor = pow(albedoColor, vec3(2.2));
 	vec3 specularColor;
-	if(useDefaultMaterial){
+	if(defaultMaterial){
 		specularColor = vec3(1.0,1.0,1.0);
 	}else{
-		specularColor = texture(specularMap, fs_in.texCoords).rgb;
+		specularColor = sampleMaterial(SPECULAR_SLOT, specularMap, fs_in.texCoords).rgb;
 	}
 	vec3 cameraDir = normalize(cameraPos - fs_in.fragPos);
-	vec3 normal = getNormal(hasNormalMap);
+	vec3 normal = getNormal(materialHasNormalMap());
 	vec3 ambient = 0.1 * albedoColor;
 	vec3 result = vec3(0.0);
 	result += calculateDirectionLight(albedoColor,specularColor,cameraDir,normal);
-	result += calculatePointLight(albedoColor,specularColor,cameraDir,normal);
+	float pointLightShadow;
+	result += calculatePointLight(albedoColor,specularColor,cameraDir,normal,pointLightShadow);
 	result += calculateSpotLight(albedoColor,specularColor,cameraDir,normal);
 #ifdef USE_ENVIRONMENT_MAPPING
 	result += calculateEnvironmentMapping();
 #endif
-	float shadow = clamp(calculatePointLightShadow(normal) + calculateDirectionLightShadow(normal), 0.0, 1.0);
+	float shadow = clamp(pointLightShadow + calculateDirectionLightShadow(normal), 0.0, 1.0);
 	result = (1.0 - shadow) * result;
 	result += ambient;
 	fragColor = vec4(result,1.0);
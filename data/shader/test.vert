@@ -1,27 +1,40 @@
 #version 450 core
 
 layout (location = 0) in vec3 aPos;
+// packed layout: normal is octahedral (xy), tangent is octahedral (xy) + bitangent sign (z)
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in vec3 aTangent;
+layout (location = 3) in vec4 aTangent;
 layout (location = 4) in vec3 aBitangent;
 layout (location = 5) in ivec4 boneIds;
 layout (location = 6) in vec4 weights;
+layout (location = 7) in uint drawIndex;
+layout (location = 8) in uint drawMaterial;
+layout (location = 9) in uint packedVertex;
 
 const int MAX_BONES = 500;
 const int MAX_BONE_INFLUENCE = 4;
 
 layout (binding = 8) uniform sampler2D boneMatrixTexture;
 
+// depthPrepass.vert computes the same gl_Position, the color pass tests depth with GL_EQUAL after the prepass
+invariant gl_Position;
+
 out VS_OUT{
 	vec3 normal;
 	vec2 texCoords;
 	vec3 fragPos;
 	vec4 fragPosLightSpace;
 	mat3 TBN;
+	flat uint materialIndex;
 }vs_out;
 
 uniform mat4 model;
+uniform bool useDrawData;
+uniform int materialIndex;
+layout (std430, binding = 6) buffer ModelMatrixBuffer{
+	mat4 modelMatrices[];
+};
 layout (std140, binding=0) uniform Matrices
 {
 	mat4 view;
@@ -39,8 +52,26 @@ mat4 getBoneMatrix(int index)
 		);
 }
 
+vec3 octDecode(vec2 e)
+{
+	vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if(v.z < 0.0)
+		v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(v);
+}
+
 void main()
 {
+	vec3 normal = aNormal;
+	vec3 tangent = aTangent.xyz;
+	vec3 bitangent = aBitangent;
+	if(packedVertex != 0u)
+	{
+		normal = octDecode(aNormal.xy);
+		tangent = octDecode(aTangent.xy);
+		bitangent = cross(normal, tangent) * aTangent.z;
+	}
+	mat4 modelMatrix = useDrawData ? modelMatrices[drawIndex] : model;
 	vec4 totalPosition = vec4(0.0);
     vec3 totalNormal = vec3(0.0);
     vec3 totalTangent = vec3(0.0);
@@ -50,38 +81,39 @@ void main()
 	{
 		if(boneIds[i] == -1)
 			continue;
-		if(weights[i] == -1.0)
+		if(weights[i] <= 0.0)
 			continue;
 		if(boneIds[i] >= MAX_BONES)
 		{
 			totalPosition = vec4(aPos, 1.0);
-            totalNormal = aNormal;
-            totalTangent = aTangent;
-            totalBitangent = aBitangent;
+            totalNormal = normal;
+            totalTangent = tangent;
+            totalBitangent = bitangent;
 			break;
 		}
 		mat4 boneMatrix = getBoneMatrix(boneIds[i]);
         mat3 boneMatrix3 = mat3(boneMatrix);
         totalPosition += boneMatrix * vec4(aPos, 1.0) * weights[i];
-        totalNormal   += boneMatrix3 * aNormal * weights[i];
-        totalTangent  += boneMatrix3 * aTangent * weights[i];
-        totalBitangent+= boneMatrix3 * aBitangent * weights[i];
+        totalNormal   += boneMatrix3 * normal * weights[i];
+        totalTangent  += boneMatrix3 * tangent * weights[i];
+        totalBitangent+= boneMatrix3 * bitangent * weights[i];
 		hasBone = true;
 	}
 	if(!hasBone)
 	{
 		totalPosition = vec4(aPos, 1.0);
-		totalNormal = aNormal;
-		totalTangent = aTangent;
-		totalBitangent = aBitangent;
+		totalNormal = normal;
+		totalTangent = tangent;
+		totalBitangent = bitangent;
 	}
-	gl_Position = projection * view * model * totalPosition;
-	vs_out.normal = normalize(mat3(transpose(inverse(model)))*totalNormal);
+	gl_Position = projection * view * modelMatrix * totalPosition;
+	vs_out.normal = normalize(mat3(transpose(inverse(modelMatrix)))*totalNormal);
 	vs_out.texCoords = aTexCoords;
-	vs_out.fragPos = (model*totalPosition).xyz;
+	vs_out.fragPos = (modelMatrix*totalPosition).xyz;
 	vs_out.fragPosLightSpace = lightSpaceMatrix * vec4(vs_out.fragPos, 1.0);
-	vec3 T = normalize(mat3(model) * totalTangent);
-	vec3 B = normalize(mat3(model) * totalBitangent);
-	vec3 N = normalize(mat3(model) * totalNormal);
+	vec3 T = normalize(mat3(modelMatrix) * totalTangent);
+	vec3 B = normalize(mat3(modelMatrix) * totalBitangent);
+	vec3 N = normalize(mat3(modelMatrix) * totalNormal);
 	vs_out.TBN = mat3(T, B, N);
+	vs_out.materialIndex = useDrawData ? drawMaterial : uint(materialIndex);
 }
\ No newline at end of file
@@ -10,12 +10,15 @@ class Animation
 {
 public:
 	Animation(const aiAnimation* animation, std::vector<Node>& nodes);
+	// Ԥָ
+	Animation(const std::string& name, float duration, float ticksPerSecond, std::unordered_map<std::string, Bone> bones);
 	~Animation() = default;
 	Bone* findBone(const std::string& name);
-	float getTicksPerSecond() { return ticksPerSecond; }
-	float getDuration() { return duration; }
+	float getTicksPerSecond() const { return ticksPerSecond; }
+	float getDuration() const { return duration; }
 	bool isValid() const { return valid; }
 	std::string getName() const { return name; }
+	const std::unordered_map<std::string, Bone>& getBones() const { return boneInfoMap; }
 private:
 	std::string name;
 	bool valid;
@@ -38,6 +41,11 @@ Animation::Animation(const aiAnimation* animation, std::vector<Node>& nodes)
 	readMissingBones(animation, nodes);
 }
 
+Animation::Animation(const std::string& name, float duration, float ticksPerSecond, std::unordered_map<std::string, Bone> bones)
+	: name(name), valid(true), duration(duration), ticksPerSecond(ticksPerSecond), boneInfoMap(std::move(bones))
+{
+}
+
 Bone* Animation::findBone(const std::string& name)
 {
 	return boneInfoMap.count(name) ? &boneInfoMap[name] : nullptr;
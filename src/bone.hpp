@@ -30,12 +30,16 @@ class Bone {
 public:
 	Bone() = default;
 	Bone(int id, const aiNodeAnim* channel);
+	Bone(int id, std::vector<KeyPosition> positions, std::vector<KeyRotation> rotations, std::vector<KeyScale> scales);
 	void update(float animationTime);
 	glm::mat4 getLocalTransform() const { return localTransform; };
 	int getBoneID() const { return id; }
 	int getPositionIndex(float animationTime);
 	int getRotationIndex(float animationTime);
 	int getScaleIndex(float animationTime);
+	const std::vector<KeyPosition>& getPositions() const { return positions; }
+	const std::vector<KeyRotation>& getRotations() const { return rotations; }
+	const std::vector<KeyScale>& getScales() const { return scales; }
 private:
 	std::vector<KeyPosition> positions;
 	std::vector<KeyRotation> rotations;
@@ -84,6 +88,14 @@ Bone::Bone(int id, const aiNodeAnim* channel)
 	}
 }
 
+Bone::Bone(int id, std::vector<KeyPosition> positions, std::vector<KeyRotation> rotations, std::vector<KeyScale> scales)
+	: positions(std::move(positions)), rotations(std::move(rotations)), scales(std::move(scales)), localTransform(1.0f), id(id)
+{
+	numPositions = (int)this->positions.size();
+	numRotations = (int)this->rotations.size();
+	numScalings = (int)this->scales.size();
+}
+
 void Bone::update(float animationTime) {
 	glm::mat4 translation = interpolatePosition(animationTime);
 	glm::mat4 rotation = interpolateRotation(animationTime);
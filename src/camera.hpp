@@ -12,6 +12,8 @@
 #define DEFAULT_PITCH 0.0f
 #define DEFAULT_YAW -90.0f
 #define DEFAULT_FOV 55.0f
+#define DEFAULT_NEAR 0.1f
+#define DEFAULT_FAR 100.0f
 #define DEFAULT_SENSITIVITY 0.05f
 
 enum Direction {
@@ -32,6 +34,9 @@ struct Frustum {
 	glm::vec4 farPlane;
 };
 
+// view-projectionȡƽ棬Դ/͸Ӿͬ
+Frustum extractFrustum(const glm::mat4& vp);
+
 class Camera {
 public:
 	Camera();
@@ -40,7 +45,12 @@ public:
 	glm::vec3 getFront();
 	glm::mat4 getViewMat();
 	glm::mat4 getProjectionMat(const float scrWidth, const float scrHeight);
+	float getNear() const { return DEFAULT_NEAR; }
+	float getFar() const { return DEFAULT_FAR; }
+	float getFov() const { return fov; }
 	Frustum getFrustum(const float scrWidth, const float scrHeight);
+	// ֱӷyaw/pitchͬ£֮ƴ
+	void lookAt(const glm::vec3& position, const glm::vec3& target);
 	void processKeyboard(Direction d, double deltaTime);
 	void processMouseMovement(const float xPos, const float yPos);
 	void processMouseScroll(const float yOffset);
@@ -91,14 +101,24 @@ glm::mat4 Camera::getViewMat() {
 }
 
 glm::mat4 Camera::getProjectionMat(const float scrWidth, const float scrHeight) {
-	return glm::perspective(glm::radians(fov), scrWidth / scrHeight, 0.1f, 100.0f);
+	return glm::perspective(glm::radians(fov), scrWidth / scrHeight, DEFAULT_NEAR, DEFAULT_FAR);
 }
 
 Frustum Camera::getFrustum(const float scrWidth, const float scrHeight) {
 	glm::mat4 proj = getProjectionMat(scrWidth, scrHeight);
 	glm::mat4 view = getViewMat();
-	glm::mat4 vp = proj * view;
+	return extractFrustum(proj * view);
+}
+
+void Camera::lookAt(const glm::vec3& position, const glm::vec3& target) {
+	pos = position;
+	if (glm::length(target - position) < 1e-6f) return;
+	front = glm::normalize(target - position);
+	pitch = glm::degrees(asin(glm::clamp(front.y, -1.0f, 1.0f)));
+	yaw = glm::degrees(atan2(front.z, front.x));
+}
 
+Frustum extractFrustum(const glm::mat4& vp) {
 	Frustum frustum;
 
 	// ȡƽ
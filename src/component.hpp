@@ -7,6 +7,7 @@
 #include "skybox.hpp"
 #include <iostream>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
 class Component {
 public:
@@ -23,6 +24,11 @@ std::string Component::getName() const {
 
 using ComponentPtr = std::shared_ptr<Component>;
 
+struct AABB {
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
 class Transform : public Component {
 public:
 	Transform() : Component("Transform") {
@@ -34,8 +40,78 @@ public:
 	glm::vec3 translate;
 	glm::vec3 scale;
 	glm::vec3 rotate;
+
+	// ޸translate/scale/rotateҪã´ζȡʱ¼
+	void markDirty() { dirty = true; }
+	void setParent(std::shared_ptr<Transform> parent);
+	std::shared_ptr<Transform> getParent() const { return parent.lock(); }
+	const glm::mat4& getLocalMatrix();
+	const glm::mat4& getWorldMatrix();
+	const glm::mat3& getRotationMatrix();
+	glm::vec3 getWorldPosition() { return glm::vec3(getWorldMatrix()[3]); }
+	// ռеķ򣬰ڵת
+	glm::vec3 getWorldDirection(const glm::vec3& localAxis) { return glm::normalize(glm::mat3(getWorldMatrix()) * localAxis); }
+	// ÿ¼һμһжǷҪ
+	unsigned int getVersion() { getWorldMatrix(); return version; }
+private:
+	bool dirty = true;
+	bool linkedToParent = false;
+	std::weak_ptr<Transform> parent;
+	glm::mat4 localMatrix = glm::mat4(1.0f);
+	glm::mat4 worldMatrix = glm::mat4(1.0f);
+	glm::mat3 rotationMatrix = glm::mat3(1.0f);
+	unsigned int version = 0;
+	unsigned int parentVersion = 0;
+	bool updateLocalMatrix();
 };
 
+void Transform::setParent(std::shared_ptr<Transform> parent) {
+	this->parent = parent;
+	dirty = true;
+}
+
+bool Transform::updateLocalMatrix() {
+	if (!dirty) return false;
+	glm::mat4 rotation = glm::mat4(1.0f);
+	rotation = glm::rotate(rotation, glm::radians(rotate.z), glm::vec3(0, 0, 1));
+	rotation = glm::rotate(rotation, glm::radians(rotate.y), glm::vec3(0, 1, 0));
+	rotation = glm::rotate(rotation, glm::radians(rotate.x), glm::vec3(1, 0, 0));
+	rotationMatrix = glm::mat3(rotation);
+	localMatrix = glm::translate(glm::mat4(1.0f), translate) * rotation;
+	localMatrix = glm::scale(localMatrix, scale);
+	dirty = false;
+	return true;
+}
+
+const glm::mat4& Transform::getLocalMatrix() {
+	updateLocalMatrix();
+	return localMatrix;
+}
+
+const glm::mat4& Transform::getWorldMatrix() {
+	bool localChanged = updateLocalMatrix();
+	if (auto p = parent.lock()) {
+		const glm::mat4& parentWorld = p->getWorldMatrix();
+		if (localChanged || !linkedToParent || parentVersion != p->version) {
+			worldMatrix = parentWorld * localMatrix;
+			parentVersion = p->version;
+			linkedToParent = true;
+			version++;
+		}
+	}
+	else if (localChanged || linkedToParent) {
+		worldMatrix = localMatrix;
+		linkedToParent = false;
+		version++;
+	}
+	return worldMatrix;
+}
+
+const glm::mat3& Transform::getRotationMatrix() {
+	updateLocalMatrix();
+	return rotationMatrix;
+}
+
 class RenderComponent : public Component {
 public:
 
@@ -46,13 +122,12 @@ public:
 	void setModel(ModelPtr model) { 
 		this->model = model; 
 		this->model->buildAABB(aabb.min, aabb.max);
+		boundsVersion++;
 	}
 	ModelPtr model;
-
-	struct AABB {
-		glm::vec3 min;
-		glm::vec3 max;
-	}aabb;
+	AABB aabb;
+	// aabbÿؽһμһ任ûиıʱRenderProxyStoreݴ˸Χ
+	unsigned int boundsVersion = 0;
 
 	bool skeletonVisible;
 };
@@ -140,13 +215,12 @@ public:
 	void setMesh(MeshPtr mesh) {
 		this->mesh = mesh;
 		this->mesh->buildAABB(aabb.min, aabb.max);
+		boundsVersion++;
 	}
 
 	MeshPtr mesh;
-	struct AABB {
-		glm::vec3 min;
-		glm::vec3 max;
-	}aabb;
+	AABB aabb;
+	unsigned int boundsVersion = 0;
 };
 
 class DynamicMaterialComponent : public Component {
@@ -231,13 +305,13 @@ void SkeletonViewerComponent::drawSkeleton() {
 		}
 	}
 	if (!bonePositions.empty()) {
-		glBindVertexArray(VAO);
+		GLState::getInstance().bindVertexArray(VAO);
 		glBindBuffer(GL_ARRAY_BUFFER, VBO);
 		glBufferData(GL_ARRAY_BUFFER, bonePositions.size() * sizeof(glm::vec3), &bonePositions[0], GL_STATIC_DRAW);
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
 		glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(bonePositions.size()));
-		glBindVertexArray(0);
+		GLState::getInstance().bindVertexArray(0);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 
@@ -250,13 +324,13 @@ void SkeletonViewerComponent::drawSkeleton() {
 	}
 
 	if (!lineVertices.empty()) {
-		glBindVertexArray(lineVAO);
+		GLState::getInstance().bindVertexArray(lineVAO);
 		glBindBuffer(GL_ARRAY_BUFFER, lineVBO);
 		glBufferData(GL_ARRAY_BUFFER, lineVertices.size() * sizeof(glm::vec3), lineVertices.data(), GL_STATIC_DRAW);
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
 		glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(lineVertices.size()));
-		glBindVertexArray(0);
+		GLState::getInstance().bindVertexArray(0);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 }
@@ -0,0 +1,464 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+#pragma once
+
+#include "frustumCuller.hpp"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ÿڵӦprimitiveһ[first, first + count)ҶӵleftΪ-1
+struct BVHNode {
+	glm::vec3 boundsMin;
+	int left;
+	glm::vec3 boundsMax;
+	int parent;
+	int first;
+	int count;
+};
+
+// Χвνṹ±궼RenderProxyStoreе±
+// ɾʱؽ(SAH)ֻƶʱҶӵrefit
+class BVH {
+public:
+	BVH() = default;
+
+	void build(const BoundsSoA& bounds);
+	// ƶ壬ûе巵falseҪؽ
+	bool refit(const BoundsSoA& bounds, const std::vector<unsigned int>& moved);
+	void queryFrustum(const Frustum& frustum, std::vector<unsigned int>& result) const;
+	void querySphere(const glm::vec3& center, float radius, std::vector<unsigned int>& result) const;
+	// ཻİΧ
+	bool raycast(const glm::vec3& origin, const glm::vec3& direction, unsigned int& hitIndex, float& hitDistance) const;
+
+	size_t getNodeCount() const { return nodes.size(); }
+	size_t getPrimitiveCount() const { return primIndices.size(); }
+
+	// 10̬+1000ƶ壬ͳƹrefit͸ѯʱ
+	static std::string benchmark();
+private:
+	static const int BIN_COUNT = 12;
+	static const int MAX_LEAF_SIZE = 8;
+
+	std::vector<BVHNode> nodes;
+	std::vector<unsigned int> primIndices;  // BVH˳ -> ±
+	std::vector<int> primSlots;             // ± -> BVH˳-1ʾ
+	std::vector<int> primLeaves;            // ± -> Ҷ
+	BoundsSoA primBounds;                   // BVH˳ţҶӿֱSIMD޳
+	mutable std::vector<int> stack;
+
+	void subdivide(int nodeIndex, const std::vector<glm::vec3>& boxMin, const std::vector<glm::vec3>& boxMax, const std::vector<glm::vec3>& centroid);
+	void updateNodeBounds(int nodeIndex);
+	static float halfArea(const glm::vec3& extent) { return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x; }
+};
+
+void BVH::build(const BoundsSoA& bounds) {
+	nodes.clear();
+	primIndices.clear();
+	primSlots.assign(bounds.size(), -1);
+	primLeaves.assign(bounds.size(), -1);
+
+	std::vector<glm::vec3> boxMin(bounds.size()), boxMax(bounds.size()), centroid(bounds.size());
+	for (size_t i = 0; i < bounds.size(); i++) {
+		// 볤Ϊǿպ
+		if (bounds.extentX[i] < 0.0f) continue;
+		glm::vec3 center = bounds.center(i);
+		glm::vec3 extent = bounds.extent(i);
+		boxMin[i] = center - extent;
+		boxMax[i] = center + extent;
+		centroid[i] = center;
+		primIndices.push_back((unsigned int)i);
+	}
+	if (primIndices.empty()) {
+		primBounds.resize(0);
+		return;
+	}
+
+	nodes.reserve(primIndices.size() * 2);
+	BVHNode root;
+	root.left = -1;
+	root.parent = -1;
+	root.first = 0;
+	root.count = (int)primIndices.size();
+	nodes.push_back(root);
+	subdivide(0, boxMin, boxMax, centroid);
+
+	primBounds.resize(primIndices.size());
+	for (size_t slot = 0; slot < primIndices.size(); slot++) {
+		unsigned int idx = primIndices[slot];
+		primBounds.set(slot, bounds.center(idx), bounds.extent(idx));
+		primSlots[idx] = (int)slot;
+	}
+	for (size_t n = 0; n < nodes.size(); n++) {
+		if (nodes[n].left != -1) continue;
+		for (int slot = nodes[n].first; slot < nodes[n].first + nodes[n].count; slot++) {
+			primLeaves[primIndices[slot]] = (int)n;
+		}
+	}
+}
+
+void BVH::subdivide(int nodeIndex, const std::vector<glm::vec3>& boxMin, const std::vector<glm::vec3>& boxMax, const std::vector<glm::vec3>& centroid) {
+	int first = nodes[nodeIndex].first;
+	int count = nodes[nodeIndex].count;
+	glm::vec3 nodeMin(FLT_MAX), nodeMax(-FLT_MAX), centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+	for (int i = first; i < first + count; i++) {
+		unsigned int idx = primIndices[i];
+		nodeMin = glm::min(nodeMin, boxMin[idx]);
+		nodeMax = glm::max(nodeMax, boxMax[idx]);
+		centroidMin = glm::min(centroidMin, centroid[idx]);
+		centroidMax = glm::max(centroidMax, centroid[idx]);
+	}
+	nodes[nodeIndex].boundsMin = nodeMin;
+	nodes[nodeIndex].boundsMax = nodeMax;
+	if (count <= 2) return;
+
+	// SAHҴСĻ
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = FLT_MAX;
+	for (int axis = 0; axis < 3; axis++) {
+		float axisMin = centroidMin[axis];
+		float axisMax = centroidMax[axis];
+		if (axisMax - axisMin < 1e-6f) continue;
+		int binCount[BIN_COUNT] = {};
+		glm::vec3 binMin[BIN_COUNT], binMax[BIN_COUNT];
+		for (int b = 0; b < BIN_COUNT; b++) {
+			binMin[b] = glm::vec3(FLT_MAX);
+			binMax[b] = glm::vec3(-FLT_MAX);
+		}
+		float scale = BIN_COUNT / (axisMax - axisMin);
+		for (int i = first; i < first + count; i++) {
+			unsigned int idx = primIndices[i];
+			int b = std::min(BIN_COUNT - 1, (int)((centroid[idx][axis] - axisMin) * scale));
+			binCount[b]++;
+			binMin[b] = glm::min(binMin[b], boxMin[idx]);
+			binMax[b] = glm::max(binMax[b], boxMax[idx]);
+		}
+		float leftArea[BIN_COUNT - 1], rightArea[BIN_COUNT - 1];
+		int leftCount[BIN_COUNT - 1], rightCount[BIN_COUNT - 1];
+		glm::vec3 leftMin(FLT_MAX), leftMax(-FLT_MAX), rightMin(FLT_MAX), rightMax(-FLT_MAX);
+		int leftSum = 0, rightSum = 0;
+		for (int b = 0; b < BIN_COUNT - 1; b++) {
+			leftSum += binCount[b];
+			leftCount[b] = leftSum;
+			leftMin = glm::min(leftMin, binMin[b]);
+			leftMax = glm::max(leftMax, binMax[b]);
+			leftArea[b] = leftSum ? halfArea(leftMax - leftMin) : 0.0f;
+			rightSum += binCount[BIN_COUNT - 1 - b];
+			rightCount[BIN_COUNT - 2 - b] = rightSum;
+			rightMin = glm::min(rightMin, binMin[BIN_COUNT - 1 - b]);
+			rightMax = glm::max(rightMax, binMax[BIN_COUNT - 1 - b]);
+			rightArea[BIN_COUNT - 2 - b] = rightSum ? halfArea(rightMax - rightMin) : 0.0f;
+		}
+		for (int b = 0; b < BIN_COUNT - 1; b++) {
+			float cost = leftCount[b] * leftArea[b] + rightCount[b] * rightArea[b];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b;
+			}
+		}
+	}
+
+	float leafCost = count * halfArea(nodeMax - nodeMin);
+	if (bestAxis == -1 || (bestCost >= leafCost && count <= MAX_LEAF_SIZE)) return;
+
+	// λԭطб
+	float axisMin = centroidMin[bestAxis];
+	float scale = BIN_COUNT / (centroidMax[bestAxis] - axisMin);
+	int i = first;
+	int j = first + count - 1;
+	while (i <= j) {
+		int b = std::min(BIN_COUNT - 1, (int)((centroid[primIndices[i]][bestAxis] - axisMin) * scale));
+		if (b <= bestSplit) {
+			i++;
+		}
+		else {
+			std::swap(primIndices[i], primIndices[j--]);
+		}
+	}
+	int leftCount = i - first;
+	if (leftCount == 0 || leftCount == count) return;
+
+	int leftIndex = (int)nodes.size();
+	BVHNode leftChild;
+	leftChild.left = -1;
+	leftChild.parent = nodeIndex;
+	leftChild.first = first;
+	leftChild.count = leftCount;
+	BVHNode rightChild = leftChild;
+	rightChild.first = i;
+	rightChild.count = count - leftCount;
+	nodes.push_back(leftChild);
+	nodes.push_back(rightChild);
+	nodes[nodeIndex].left = leftIndex;
+	subdivide(leftIndex, boxMin, boxMax, centroid);
+	subdivide(leftIndex + 1, boxMin, boxMax, centroid);
+}
+
+void BVH::updateNodeBounds(int nodeIndex) {
+	BVHNode& node = nodes[nodeIndex];
+	if (node.left == -1) {
+		glm::vec3 nodeMin(FLT_MAX), nodeMax(-FLT_MAX);
+		for (int slot = node.first; slot < node.first + node.count; slot++) {
+			glm::vec3 center = primBounds.center(slot);
+			glm::vec3 extent = primBounds.extent(slot);
+			nodeMin = glm::min(nodeMin, center - extent);
+			nodeMax = glm::max(nodeMax, center + extent);
+		}
+		node.boundsMin = nodeMin;
+		node.boundsMax = nodeMax;
+	}
+	else {
+		const BVHNode& leftChild = nodes[node.left];
+		const BVHNode& rightChild = nodes[node.left + 1];
+		node.boundsMin = glm::min(leftChild.boundsMin, rightChild.boundsMin);
+		node.boundsMax = glm::max(leftChild.boundsMax, rightChild.boundsMax);
+	}
+}
+
+bool BVH::refit(const BoundsSoA& bounds, const std::vector<unsigned int>& moved) {
+	if (moved.empty()) return true;
+	std::vector<int> dirtyNodes;
+	dirtyNodes.reserve(moved.size() * 4);
+	for (unsigned int idx : moved) {
+		if (idx >= primSlots.size()) return false;
+		int slot = primSlots[idx];
+		bool empty = bounds.extentX[idx] < 0.0f;
+		// պбЧ(򷴹)ıе弯ϣֻؽ
+		if ((slot == -1) != empty) return false;
+		if (slot == -1) continue;
+		primBounds.set(slot, bounds.center(idx), bounds.extent(idx));
+		for (int n = primLeaves[idx]; n != -1; n = nodes[n].parent) {
+			dirtyNodes.push_back(n);
+		}
+	}
+	// ӽڵ±Ǵڸڵ㣬ӴС¼ɱ֤Ե
+	std::sort(dirtyNodes.begin(), dirtyNodes.end(), std::greater<int>());
+	dirtyNodes.erase(std::unique(dirtyNodes.begin(), dirtyNodes.end()), dirtyNodes.end());
+	for (int n : dirtyNodes) {
+		updateNodeBounds(n);
+	}
+	return true;
+}
+
+void BVH::queryFrustum(const Frustum& frustum, std::vector<unsigned int>& result) const {
+	result.clear();
+	if (nodes.empty()) return;
+	const glm::vec4 planes[6] = {
+		frustum.leftPlane, frustum.rightPlane,
+		frustum.bottomPlane, frustum.topPlane,
+		frustum.nearPlane, frustum.farPlane
+	};
+	stack.clear();
+	stack.push_back(0);
+	while (!stack.empty()) {
+		const BVHNode& node = nodes[stack.back()];
+		stack.pop_back();
+		glm::vec3 center = (node.boundsMax + node.boundsMin) * 0.5f;
+		glm::vec3 extent = (node.boundsMax - node.boundsMin) * 0.5f;
+		bool outside = false;
+		bool intersect = false;
+		for (int p = 0; p < 6; p++) {
+			float distance = glm::dot(glm::vec3(planes[p]), center) + planes[p].w;
+			float radius = glm::dot(glm::abs(glm::vec3(planes[p])), extent);
+			if (distance + radius < 0.0f) {
+				outside = true;
+				break;
+			}
+			if (distance - radius < 0.0f) {
+				intersect = true;
+			}
+		}
+		if (outside) continue;
+		if (!intersect) {
+			// ڵȫ׶ڣֱ
+			for (int slot = node.first; slot < node.first + node.count; slot++) {
+				result.push_back((unsigned int)slot);
+			}
+		}
+		else if (node.left == -1) {
+			FrustumCuller::cullRange(frustum, primBounds, node.first, node.first + node.count, result);
+		}
+		else {
+			stack.push_back(node.left);
+			stack.push_back(node.left + 1);
+		}
+	}
+	for (unsigned int& slot : result) {
+		slot = primIndices[slot];
+	}
+}
+
+void BVH::querySphere(const glm::vec3& center, float radius, std::vector<unsigned int>& result) const {
+	result.clear();
+	if (nodes.empty()) return;
+	float radius2 = radius * radius;
+	auto boxDistance2 = [&](const glm::vec3& boxMin, const glm::vec3& boxMax) {
+		glm::vec3 closest = glm::clamp(center, boxMin, boxMax);
+		glm::vec3 delta = closest - center;
+		return glm::dot(delta, delta);
+		};
+	stack.clear();
+	stack.push_back(0);
+	while (!stack.empty()) {
+		const BVHNode& node = nodes[stack.back()];
+		stack.pop_back();
+		if (boxDistance2(node.boundsMin, node.boundsMax) > radius2) continue;
+		if (node.left != -1) {
+			stack.push_back(node.left);
+			stack.push_back(node.left + 1);
+			continue;
+		}
+		for (int slot = node.first; slot < node.first + node.count; slot++) {
+			glm::vec3 primCenter = primBounds.center(slot);
+			glm::vec3 primExtent = primBounds.extent(slot);
+			if (boxDistance2(primCenter - primExtent, primCenter + primExtent) <= radius2) {
+				result.push_back(primIndices[slot]);
+			}
+		}
+	}
+}
+
+bool BVH::raycast(const glm::vec3& origin, const glm::vec3& direction, unsigned int& hitIndex, float& hitDistance) const {
+	if (nodes.empty()) return false;
+	glm::vec3 invDir = 1.0f / direction;
+	auto slab = [&](const glm::vec3& boxMin, const glm::vec3& boxMax) {
+		glm::vec3 t0 = (boxMin - origin) * invDir;
+		glm::vec3 t1 = (boxMax - origin) * invDir;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+		float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		float exit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+		return enter <= exit ? enter : FLT_MAX;
+		};
+	float closest = FLT_MAX;
+	stack.clear();
+	stack.push_back(0);
+	while (!stack.empty()) {
+		const BVHNode& node = nodes[stack.back()];
+		stack.pop_back();
+		if (slab(node.boundsMin, node.boundsMax) >= closest) continue;
+		if (node.left != -1) {
+			// ӽڵջȷʣСclosest
+			float leftDistance = slab(nodes[node.left].boundsMin, nodes[node.left].boundsMax);
+			float rightDistance = slab(nodes[node.left + 1].boundsMin, nodes[node.left + 1].boundsMax);
+			if (leftDistance < rightDistance) {
+				stack.push_back(node.left + 1);
+				stack.push_back(node.left);
+			}
+			else {
+				stack.push_back(node.left);
+				stack.push_back(node.left + 1);
+			}
+			continue;
+		}
+		for (int slot = node.first; slot < node.first + node.count; slot++) {
+			glm::vec3 primCenter = primBounds.center(slot);
+			glm::vec3 primExtent = primBounds.extent(slot);
+			float distance = slab(primCenter - primExtent, primCenter + primExtent);
+			if (distance < closest) {
+				closest = distance;
+				hitIndex = primIndices[slot];
+			}
+		}
+	}
+	hitDistance = closest;
+	return closest < FLT_MAX;
+}
+
+std::string BVH::benchmark() {
+	std::ostringstream result;
+	const size_t staticCount = 100000;
+	const size_t movingCount = 1000;
+	const size_t count = staticCount + movingCount;
+
+	std::mt19937 rng(12345);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> size(0.1f, 2.0f);
+	std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+	BoundsSoA bounds;
+	bounds.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		bounds.set(i, glm::vec3(position(rng), position(rng), position(rng)), glm::vec3(size(rng), size(rng), size(rng)));
+	}
+	std::vector<unsigned int> moved;
+	for (size_t i = staticCount; i < count; i++) {
+		moved.push_back((unsigned int)i);
+	}
+
+	auto now = []() { return std::chrono::high_resolution_clock::now(); };
+	auto ms = [](std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end) {
+		return std::chrono::duration<double, std::milli>(end - start).count();
+		};
+
+	BVH bvh;
+	auto start = now();
+	bvh.build(bounds);
+	double buildTime = ms(start, now());
+
+	const int frames = 100;
+	glm::mat4 proj = glm::perspective(glm::radians(55.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+	std::vector<unsigned int> visible;
+	double refitTime = 0.0, bvhCullTime = 0.0, linearCullTime = 0.0, sphereTime = 0.0, rayTime = 0.0;
+	size_t bvhVisible = 0, linearVisible = 0, sphereHits = 0, rayHits = 0;
+	for (int frame = 0; frame < frames; frame++) {
+		for (unsigned int idx : moved) {
+			bounds.set(idx, bounds.center(idx) + glm::vec3(step(rng), step(rng), step(rng)), bounds.extent(idx));
+		}
+		start = now();
+		bvh.refit(bounds, moved);
+		refitTime += ms(start, now());
+
+		float angle = frame * 0.0628f;
+		glm::vec3 eye(position(rng) * 0.5f, 0.0f, position(rng) * 0.5f);
+		glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(cos(angle), 0.0f, sin(angle)), glm::vec3(0.0f, 1.0f, 0.0f));
+		Frustum frustum = extractFrustum(proj * view);
+
+		start = now();
+		bvh.queryFrustum(frustum, visible);
+		bvhCullTime += ms(start, now());
+		bvhVisible += visible.size();
+
+		start = now();
+		FrustumCuller::cull(frustum, bounds, visible);
+		linearCullTime += ms(start, now());
+		linearVisible += visible.size();
+
+		start = now();
+		bvh.querySphere(eye, 25.0f, visible);
+		sphereTime += ms(start, now());
+		sphereHits += visible.size();
+
+		start = now();
+		for (int r = 0; r < 100; r++) {
+			glm::vec3 direction = glm::normalize(glm::vec3(step(rng), step(rng), step(rng)) + glm::vec3(0.0f, 0.0f, 0.01f));
+			unsigned int hitIndex;
+			float hitDistance;
+			rayHits += bvh.raycast(eye, direction, hitIndex, hitDistance) ? 1 : 0;
+		}
+		rayTime += ms(start, now());
+	}
+
+	result << "BVH " << staticCount << " static + " << movingCount << " moving, " << bvh.getNodeCount() << " nodes\n";
+	result << "build " << buildTime << " ms\n";
+	result << "refit " << refitTime / frames << " ms/frame\n";
+	result << "frustum bvh " << bvhCullTime / frames << " ms, linear simd " << linearCullTime / frames << " ms";
+	if (bvhVisible != linearVisible) {
+		result << " MISMATCH " << bvhVisible << "/" << linearVisible;
+	}
+	result << "\n";
+	result << "sphere r=25 " << sphereTime / frames << " ms, avg " << sphereHits / frames << " hits\n";
+	result << "raycast " << rayTime / frames / 100.0 * 1000.0 << " us/ray, " << rayHits << " hits\n";
+	std::cout << result.str();
+	return result.str();
+}
+
+#endif // !BVH_HPP
@@ -0,0 +1,338 @@
+#ifndef FRUSTUMCULLER_HPP
+#define FRUSTUMCULLER_HPP
+#pragma once
+
+#include "../camera.hpp"
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// x64SSE2AVXں˲/arch:AVXAVX룬ʱCPUIDȷCPUϵͳֺ֧ŵ
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define FRUSTUM_CULLER_SSE
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define FRUSTUM_CULLER_AVX
+#define FRUSTUM_CULLER_AVX_TARGET
+#elif defined(__GNUC__) || defined(__clang__)
+#define FRUSTUM_CULLER_AVX
+#define FRUSTUM_CULLER_AVX_TARGET __attribute__((target("avx")))
+#endif
+#endif
+
+// SoAֵռΧ(+볤)ĩβಹ8SIMDλöȡ
+// λúûаΧе볤Ϊ-FLT_MAXκƽ涼޳
+struct BoundsSoA {
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+
+	size_t size() const { return count; }
+	void resize(size_t n);
+	void erase(size_t idx);
+	void set(size_t idx, const glm::vec3& center, const glm::vec3& extent);
+	void setEmpty(size_t idx);
+	glm::vec3 center(size_t idx) const { return glm::vec3(centerX[idx], centerY[idx], centerZ[idx]); }
+	glm::vec3 extent(size_t idx) const { return glm::vec3(extentX[idx], extentY[idx], extentZ[idx]); }
+private:
+	size_t count = 0;
+};
+
+void BoundsSoA::resize(size_t n) {
+	count = n;
+	size_t padded = ((n + 7) & ~size_t(7)) + 8;
+	centerX.resize(padded, 0.0f);
+	centerY.resize(padded, 0.0f);
+	centerZ.resize(padded, 0.0f);
+	extentX.resize(padded, -FLT_MAX);
+	extentY.resize(padded, -FLT_MAX);
+	extentZ.resize(padded, -FLT_MAX);
+}
+
+void BoundsSoA::erase(size_t idx) {
+	if (idx >= count) return;
+	centerX.erase(centerX.begin() + idx);
+	centerY.erase(centerY.begin() + idx);
+	centerZ.erase(centerZ.begin() + idx);
+	extentX.erase(extentX.begin() + idx);
+	extentY.erase(extentY.begin() + idx);
+	extentZ.erase(extentZ.begin() + idx);
+	// ɾһĩβһλ
+	centerX.push_back(0.0f);
+	centerY.push_back(0.0f);
+	centerZ.push_back(0.0f);
+	extentX.push_back(-FLT_MAX);
+	extentY.push_back(-FLT_MAX);
+	extentZ.push_back(-FLT_MAX);
+	resize(count - 1);
+}
+
+void BoundsSoA::set(size_t idx, const glm::vec3& center, const glm::vec3& extent) {
+	centerX[idx] = center.x;
+	centerY[idx] = center.y;
+	centerZ[idx] = center.z;
+	extentX[idx] = extent.x;
+	extentY[idx] = extent.y;
+	extentZ[idx] = extent.z;
+}
+
+void BoundsSoA::setEmpty(size_t idx) {
+	set(idx, glm::vec3(0.0f), glm::vec3(-FLT_MAX));
+}
+
+// Χ-׶޳һβ4(SSE)8(AVXʱ)Χж6ƽ
+class FrustumCuller {
+public:
+	// ѿɼΧе±дvisible()
+	static void cull(const Frustum& frustum, const BoundsSoA& bounds, std::vector<unsigned int>& visible);
+	static void cullScalar(const Frustum& frustum, const BoundsSoA& bounds, std::vector<unsigned int>& visible);
+	// ֻ[begin, end)Χ׷ӵvisibleĩβBVHҶ
+	static void cullRange(const Frustum& frustum, const BoundsSoA& bounds, size_t begin, size_t end, std::vector<unsigned int>& visible);
+	static const char* instructionSet();
+	// 10k~1MΧУȽϱSIMDͬʱ̨
+	static std::string benchmark();
+private:
+	// һεʱһ
+	static bool hasAvx();
+#if defined(FRUSTUM_CULLER_AVX)
+	FRUSTUM_CULLER_AVX_TARGET static void cullRangeAvx(const Frustum& frustum, const BoundsSoA& bounds, size_t begin, size_t end, std::vector<unsigned int>& visible);
+#endif
+#if defined(FRUSTUM_CULLER_SSE)
+	static void cullRangeSse(const Frustum& frustum, const BoundsSoA& bounds, size_t begin, size_t end, std::vector<unsigned int>& visible);
+#endif
+	static void cullRangeScalar(const Frustum& frustum, const BoundsSoA& bounds, size_t begin, size_t end, std::vector<unsigned int>& visible);
+};
+
+void FrustumCuller::cull(const Frustum& frustum, const BoundsSoA& bounds, std::vector<unsigned int>& visible) {
+	visible.clear();
+	cullRange(frustum, bounds, 0, bounds.size(), visible);
+}
+
+void FrustumCuller::cullScalar(const Frustum& frustum, const BoundsSoA& bounds, std::vector<unsigned int>& visible) {
+	const glm::vec4 planes[6] = {
+		frustum.leftPlane, frustum.rightPlane,
+		frustum.bottomPlane, frustum.topPlane,
+		frustum.nearPlane, frustum.farPlane
+	};
+	size_t count = bounds.size();
+	visible.resize(count);
+	size_t visibleCount = 0;
+	for (size_t i = 0; i < count; i++) {
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; p++) {
+			float distance = planes[p].x * bounds.centerX[i] + planes[p].y * bounds.centerY[i] + planes[p].z * bounds.centerZ[i] + planes[p].w;
+			float radius = glm::abs(planes[p].x) * bounds.extentX[i] + glm::abs(planes[p].y) * bounds.extentY[i] + glm::abs(planes[p].z) * bounds.extentZ[i];
+			inside = distance + radius >= 0.0f;
+		}
+		visible[visibleCount] = (unsigned int)i;
+		visibleCount += inside ? 1 : 0;
+	}
+	visible.resize(visibleCount);
+}
+
+bool FrustumCuller::hasAvx() {
+#if defined(FRUSTUM_CULLER_AVX) && defined(_MSC_VER)
+	static const bool supported = []() {
+		int info[4];
+		__cpuid(info, 1);
+		// AVXλOSXSAVEλȷϵͳYMMĴ״̬
+		bool cpuAvx = (info[2] & (1 << 28)) != 0 && (info[2] & (1 << 27)) != 0;
+		return cpuAvx && (_xgetbv(0) & 0x6) == 0x6;
+	}();
+	return supported;
+#elif defined(FRUSTUM_CULLER_AVX)
+	// ͬʱϵͳǷ֧YMM״̬
+	static const bool supported = __builtin_cpu_supports("avx");
+	return supported;
+#else
+	return false;
+#endif
+}
+
+void FrustumCuller::cullRange(const Frustum& frustum, const BoundsSoA& bounds, size_t begin, size_t end, std::vector<unsigned int>& visible) {
+#if defined(FRUSTUM_CULLER_AVX)
+	if (hasAvx()) {
+		cullRangeAvx(frustum, bounds, begin, end, visible);
+		return;
+	}
+#endif
+#if defined(FRUSTUM_CULLER_SSE)
+	cullRangeSse(frustum, bounds, begin, end, visible);
+#else
+	cullRangeScalar(frustum, bounds, begin, end, visible);
+#endif
+}
+
+#if defined(FRUSTUM_CULLER_AVX)
+FRUSTUM_CULLER_AVX_TARGET void FrustumCuller::cullRangeAvx(const Frustum& frustum, const BoundsSoA& bounds, size_t begin, size_t end, std::vector<unsigned int>& visible) {
+	const glm::vec4 planes[6] = {
+		frustum.leftPlane, frustum.rightPlane,
+		frustum.bottomPlane, frustum.topPlane,
+		frustum.nearPlane, frustum.farPlane
+	};
+	__m256 px[6], py[6], pz[6], pw[6], apx[6], apy[6], apz[6];
+	for (int p = 0; p < 6; p++) {
+		px[p] = _mm256_set1_ps(planes[p].x);
+		py[p] = _mm256_set1_ps(planes[p].y);
+		pz[p] = _mm256_set1_ps(planes[p].z);
+		pw[p] = _mm256_set1_ps(planes[p].w);
+		apx[p] = _mm256_set1_ps(glm::abs(planes[p].x));
+		apy[p] = _mm256_set1_ps(glm::abs(planes[p].y));
+		apz[p] = _mm256_set1_ps(glm::abs(planes[p].z));
+	}
+	size_t base = visible.size();
+	visible.resize(base + (end - begin) + 8);
+	size_t visibleCount = base;
+	const __m256 zero = _mm256_setzero_ps();
+	for (size_t i = begin; i < end; i += 8) {
+		__m256 cx = _mm256_loadu_ps(&bounds.centerX[i]);
+		__m256 cy = _mm256_loadu_ps(&bounds.centerY[i]);
+		__m256 cz = _mm256_loadu_ps(&bounds.centerZ[i]);
+		__m256 ex = _mm256_loadu_ps(&bounds.extentX[i]);
+		__m256 ey = _mm256_loadu_ps(&bounds.extentY[i]);
+		__m256 ez = _mm256_loadu_ps(&bounds.extentZ[i]);
+		// endͨ
+		int mask = end - i >= 8 ? 0xFF : (1 << (end - i)) - 1;
+		for (int p = 0; p < 6 && mask; p++) {
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px[p], cx), _mm256_mul_ps(py[p], cy)), _mm256_add_ps(_mm256_mul_ps(pz[p], cz), pw[p]));
+			__m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(apx[p], ex), _mm256_mul_ps(apy[p], ey)), _mm256_mul_ps(apz[p], ez));
+			mask &= _mm256_movemask_ps(_mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+		}
+		for (int lane = 0; lane < 8; lane++) {
+			visible[visibleCount] = (unsigned int)(i + lane);
+			visibleCount += (mask >> lane) & 1;
+		}
+	}
+	visible.resize(visibleCount);
+}
+#endif
+
+#if defined(FRUSTUM_CULLER_SSE)
+void FrustumCuller::cullRangeSse(const Frustum& frustum, const BoundsSoA& bounds, size_t begin, size_t end, std::vector<unsigned int>& visible) {
+	const glm::vec4 planes[6] = {
+		frustum.leftPlane, frustum.rightPlane,
+		frustum.bottomPlane, frustum.topPlane,
+		frustum.nearPlane, frustum.farPlane
+	};
+	__m128 px[6], py[6], pz[6], pw[6], apx[6], apy[6], apz[6];
+	for (int p = 0; p < 6; p++) {
+		px[p] = _mm_set1_ps(planes[p].x);
+		py[p] = _mm_set1_ps(planes[p].y);
+		pz[p] = _mm_set1_ps(planes[p].z);
+		pw[p] = _mm_set1_ps(planes[p].w);
+		apx[p] = _mm_set1_ps(glm::abs(planes[p].x));
+		apy[p] = _mm_set1_ps(glm::abs(planes[p].y));
+		apz[p] = _mm_set1_ps(glm::abs(planes[p].z));
+	}
+	size_t base = visible.size();
+	visible.resize(base + (end - begin) + 8);
+	size_t visibleCount = base;
+	const __m128 zero = _mm_setzero_ps();
+	for (size_t i = begin; i < end; i += 4) {
+		__m128 cx = _mm_loadu_ps(&bounds.centerX[i]);
+		__m128 cy = _mm_loadu_ps(&bounds.centerY[i]);
+		__m128 cz = _mm_loadu_ps(&bounds.centerZ[i]);
+		__m128 ex = _mm_loadu_ps(&bounds.extentX[i]);
+		__m128 ey = _mm_loadu_ps(&bounds.extentY[i]);
+		__m128 ez = _mm_loadu_ps(&bounds.extentZ[i]);
+		// endͨ
+		int mask = end - i >= 4 ? 0xF : (1 << (end - i)) - 1;
+		for (int p = 0; p < 6 && mask; p++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], cx), _mm_mul_ps(py[p], cy)), _mm_add_ps(_mm_mul_ps(pz[p], cz), pw[p]));
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(apx[p], ex), _mm_mul_ps(apy[p], ey)), _mm_mul_ps(apz[p], ez));
+			mask &= _mm_movemask_ps(_mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+		}
+		for (int lane = 0; lane < 4; lane++) {
+			visible[visibleCount] = (unsigned int)(i + lane);
+			visibleCount += (mask >> lane) & 1;
+		}
+	}
+	visible.resize(visibleCount);
+}
+#endif
+
+void FrustumCuller::cullRangeScalar(const Frustum& frustum, const BoundsSoA& bounds, size_t begin, size_t end, std::vector<unsigned int>& visible) {
+	const glm::vec4 planes[6] = {
+		frustum.leftPlane, frustum.rightPlane,
+		frustum.bottomPlane, frustum.topPlane,
+		frustum.nearPlane, frustum.farPlane
+	};
+	for (size_t i = begin; i < end; i++) {
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; p++) {
+			float distance = planes[p].x * bounds.centerX[i] + planes[p].y * bounds.centerY[i] + planes[p].z * bounds.centerZ[i] + planes[p].w;
+			float radius = glm::abs(planes[p].x) * bounds.extentX[i] + glm::abs(planes[p].y) * bounds.extentY[i] + glm::abs(planes[p].z) * bounds.extentZ[i];
+			inside = distance + radius >= 0.0f;
+		}
+		if (inside) {
+			visible.push_back((unsigned int)i);
+		}
+	}
+}
+
+const char* FrustumCuller::instructionSet() {
+	if (hasAvx()) return "AVX x8";
+#if defined(FRUSTUM_CULLER_SSE)
+	return "SSE x4";
+#else
+	return "scalar";
+#endif
+}
+
+std::string FrustumCuller::benchmark() {
+	std::ostringstream result;
+	result << "Frustum culling (" << instructionSet() << ")\n";
+
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 proj = glm::perspective(glm::radians(55.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+	Frustum frustum = extractFrustum(proj * view);
+
+	std::mt19937 rng(12345);
+	std::uniform_real_distribution<float> position(-150.0f, 150.0f);
+	std::uniform_real_distribution<float> size(0.1f, 5.0f);
+
+	const size_t counts[] = { 10000, 100000, 1000000 };
+	for (size_t count : counts) {
+		BoundsSoA bounds;
+		bounds.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			bounds.set(i, glm::vec3(position(rng), position(rng), position(rng)), glm::vec3(size(rng), size(rng), size(rng)));
+		}
+		// ÿٲ1ǧΧУʱ̫
+		size_t iterations = std::max<size_t>(1, 10000000 / count);
+		std::vector<unsigned int> visible;
+		visible.reserve(count + 8);
+
+		auto measure = [&](void (*kernel)(const Frustum&, const BoundsSoA&, std::vector<unsigned int>&)) {
+			auto start = std::chrono::high_resolution_clock::now();
+			for (size_t it = 0; it < iterations; it++) {
+				kernel(frustum, bounds, visible);
+			}
+			auto end = std::chrono::high_resolution_clock::now();
+			double seconds = std::chrono::duration<double>(end - start).count();
+			return (double)count * iterations / seconds;
+		};
+		double scalarRate = measure(&FrustumCuller::cullScalar);
+		size_t scalarVisible = visible.size();
+		double simdRate = measure(&FrustumCuller::cull);
+		size_t simdVisible = visible.size();
+
+		result << count << " boxes: scalar " << (int)(scalarRate / 1e6) << " M/s, simd " << (int)(simdRate / 1e6)
+			<< " M/s (x" << (simdRate / scalarRate) << "), visible " << simdVisible;
+		if (scalarVisible != simdVisible) {
+			result << " MISMATCH scalar " << scalarVisible;
+		}
+		result << "\n";
+	}
+	std::cout << result.str();
+	return result.str();
+}
+
+#endif // !FRUSTUMCULLER_HPP
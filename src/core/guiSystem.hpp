@@ -2,9 +2,12 @@
 #define GUISYSTEM_HPP
 #pragma once
 
-#include "../Input.hpp"
+#include "../input.hpp"
+#include "../camera.hpp"
 #include "../component.hpp"
 #include "../meshGenerator.hpp"
+#include "profiler.hpp"
+#include "renderSettings.hpp"
 #include "resourceManager.hpp"
 #include "imgui/imgui.h"
 #include "imgui/imgui_impl_glfw.h"
@@ -23,7 +26,7 @@ public:
 	~GuiSystem() = default;
 	void init(GLFWwindow* window);
 	void beginFrame();
-	void render(double deltaTime);
+	void render(double deltaTime, Camera& camera);
 	void shutDown();
 
 	// עȾƺȾ
@@ -47,6 +50,11 @@ private:
 	void showRightSideBar(double deltaTime);
 	void showBottomSideBar();
 	void registComponents();
+	// ӿеʱóBVHʰȡ
+	void pickObject(Camera& camera);
+
+	std::weak_ptr<GameObject> objectSelected;
+	int selected = -1;
 
 	float clamp(float value, float min, float max) { return std::max(min, std::min(value, max)); }
 };
@@ -76,7 +84,7 @@ void GuiSystem::beginFrame() {
 	ImGui::NewFrame();
 }
 
-void GuiSystem::render(double deltaTime) {
+void GuiSystem::render(double deltaTime, Camera& camera) {
 	ImGuiViewport* viewport = ImGui::GetMainViewport();
 	ImGui::SetNextWindowPos(viewport->Pos);
 	ImGui::SetNextWindowSize(viewport->Size);
@@ -86,6 +94,7 @@ void GuiSystem::render(double deltaTime) {
 	showLeftSideBar();
 	showRightSideBar(deltaTime);
 	showBottomSideBar();
+	pickObject(camera);
 	ImGui::End();
 	ImGui::Render();
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -99,8 +108,6 @@ void GuiSystem::shutDown() {
 
 void GuiSystem::showLeftSideBar()
 {
-	static std::weak_ptr<GameObject> objectSelected;
-
 	ImGuiViewport* viewport = ImGui::GetMainViewport();
 
 	ImGui::SetCursorPos({ 0, 0 });
@@ -188,7 +195,6 @@ void GuiSystem::showLeftSideBar()
 	}
 
 	ImGui::BeginChild(u8"sceneRegion", ImVec2(0, 0), true);
-	static int selected = -1;
 
 	auto renderObjectTreeNode = [&](const char* label, std::function<bool(GameObjectPtr)> predicate) {
 		if (ImGui::TreeNode(label)) {
@@ -348,6 +354,126 @@ void GuiSystem::showRightSideBar(double deltaTime)
 	}
 	ImGui::Separator();
 
+	RenderSettings& settings = RenderSettings::getInstance();
+	ImGui::SliderInt(u8"ԴӰ", &settings.pointShadowBudget, 0, 64);
+	ImGui::Text(u8"Դ: %d  Ӱ: %d/%d  ۹: %d", settings.stats.pointLights, settings.stats.shadowedPointLights,
+		settings.stats.pointShadowCapacity, settings.stats.spotLights);
+	if (ImGui::Checkbox(u8"ִع", &settings.clusteredShading)) {
+		if (settings.clusteredShading) {
+			Shader::changeSettings("USE_CLUSTERED_SHADING", true);
+		}
+		else {
+			Shader::changeSettings("USE_CLUSTERED_SHADING", false);
+		}
+		ResourceManager::getInstance().getShader("default")->reCompile();
+	}
+	if (settings.clusteredShading) {
+		ImGui::Text(u8"ÿعԴ ƽ: %.2f : %d", settings.stats.avgLightsPerCluster, settings.stats.maxLightsPerCluster);
+	}
+	ImGui::Checkbox(u8"ӻƺ", &settings.multiDrawIndirect);
+	if (settings.multiDrawIndirect) {
+		ImGui::Text(u8"ӻ: %d  : %d  : %d", settings.stats.drawCalls, settings.stats.indirectCommands, settings.stats.batchedMeshes);
+	}
+	const GLState::Counters& glState = settings.stats.glState;
+	ImGui::Text(u8"״̬л(ִ/) : %d/%d  : %d/%d  VAO: %d/%d", glState.programBinds, glState.programSkipped,
+		glState.textureBinds, glState.textureSkipped, glState.vaoBinds, glState.vaoSkipped);
+	ImGui::Checkbox(u8"LOD", &settings.lodEnabled);
+	if (settings.lodEnabled) {
+		ImGui::SliderFloat(u8"LOD0Ļռ", &settings.lodScreenSize, 0.05f, 2.0f);
+		ImGui::SliderInt(u8"ӰLODƫ", &settings.shadowLodBias, 0, MAX_LODS - 1);
+	}
+	ImGui::Text(u8": %d(ȫLOD0: %d)", settings.stats.triangles, settings.stats.fullDetailTriangles);
+	ImGui::Checkbox(u8"meshlet޳(GPU)", &settings.meshletCulling);
+	if (settings.meshletCulling) {
+		ImGui::SameLine();
+		ImGui::Checkbox(u8"׶", &settings.meshletConeCulling);
+		ImGui::SliderInt(u8"meshlet޳", &settings.meshletMinTriangles, 128, 65536);
+		ImGui::Text(u8"meshlet : %d  ɼ: %d", settings.stats.meshletsTested, settings.stats.meshletsVisible);
+	}
+	ImGui::Checkbox(u8"ڵ޳(Hi-Z)", &settings.occlusionCulling);
+	if (settings.occlusionCulling) {
+		ImGui::Text(u8"ڵ: %d", settings.stats.occludedObjects);
+	}
+	ImGui::Checkbox(u8"Ԥ", &settings.depthPrepass);
+	ImGui::Text(u8"Ԥ: %.2fms  ɫ: %.2fms", settings.stats.depthPrepassMs, settings.stats.colorPassMs);
+	ImGui::Checkbox(u8"ѹʽ(֮ص)", &settings.packedVertices);
+	size_t vertexBytes = 0, standardBytes = 0;
+	for (int i = 0; i < (int)VertexLayout::COUNT; i++) {
+		const MeshArena& arena = MeshArena::get((VertexLayout)i);
+		vertexBytes += arena.getVertexBytes();
+		standardBytes += (size_t)arena.getVertexCount() * sizeof(Vertex);
+	}
+	ImGui::Text(u8"㻺: %.1fMB(ѹ%.1fMB)  ̬/Ƥ/: %u/%u/%u", vertexBytes / 1048576.0f, standardBytes / 1048576.0f,
+		MeshArena::get(VertexLayout::PACKED_STATIC).getVertexCount(), MeshArena::get(VertexLayout::PACKED_SKINNED).getVertexCount(),
+		MeshArena::get(VertexLayout::STANDARD).getVertexCount());
+	const MaterialTable& materialTable = MaterialTable::getInstance();
+	ImGui::Text(u8"ʱ(%s): %d  : %d  δ: %d", materialTable.isBindless() ? "bindless" : u8"",
+		materialTable.getMaterialCount(), materialTable.getArrayCount(), materialTable.getRejectedCount());
+	TextureCache& textureCache = TextureCache::getInstance();
+	ImGui::Text(u8": %d  %.1fMB(δʹ%.1fMB)  /: %d/%d", textureCache.getTextureCount(),
+		textureCache.getTotalBytes() / 1048576.0f, textureCache.getUnusedBytes() / 1048576.0f, textureCache.getHits(), textureCache.getMisses());
+	if (ImGui::Button(u8"δʹ")) {
+		textureCache.evictUnused();
+	}
+	ImGui::SliderFloat(u8"ϴԤ(MB/֡)", &settings.textureUploadBudgetMB, 0.5f, 64.0f);
+	ImGui::Text(u8": %d  ֡ϴ: %.2fMB", textureCache.getLoadingCount(), textureCache.getUploadedBytes() / 1048576.0f);
+	ImGui::Separator();
+
+	static std::string benchmarkResult;
+	if (ImGui::Button(u8"޳ܲ")) {
+		benchmarkResult = FrustumCuller::benchmark();
+	}
+	ImGui::SameLine();
+	if (ImGui::Button(u8"BVHܲ")) {
+		benchmarkResult = BVH::benchmark();
+	}
+	ImGui::SameLine();
+	if (ImGui::Button(u8"ģͼز")) {
+		std::vector<std::string> paths;
+		for (const ModelPtr& model : ResourceManager::getInstance().getAllModels()) {
+			paths.push_back(model->getPath());
+		}
+		benchmarkResult = paths.empty() ? "No model loaded" : ModelCache::benchmark(paths);
+	}
+	if (!benchmarkResult.empty()) {
+		ImGui::TextWrapped("%s", benchmarkResult.c_str());
+	}
+	ImGui::Separator();
+
+	if (ImGui::CollapsingHeader(u8"ܷ")) {
+		Profiler& profiler = Profiler::getInstance();
+		ImGui::Checkbox(u8"¼", &profiler.enabled);
+		ImGui::SameLine();
+		static std::string exportResult;
+		if (ImGui::Button(u8"Chrome trace")) {
+			exportResult = profiler.exportChromeTrace("profile_trace.json") ? u8"ѵprofile_trace.json" : u8"ʧ";
+		}
+		if (!exportResult.empty()) {
+			ImGui::Text("%s", exportResult.c_str());
+		}
+		ImGui::Text(u8"%d֡(ms) ƽ/p95/p99  GPU: %d֡", Profiler::WINDOW, profiler.getDroppedFrames());
+		if (ImGui::BeginTable("profilerTable", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp)) {
+			ImGui::TableSetupColumn(u8"ֶ");
+			ImGui::TableSetupColumn("CPU");
+			ImGui::TableSetupColumn("GPU");
+			ImGui::TableHeadersRow();
+			for (int i = 0; i < profiler.getTimerCount(); i++) {
+				Profiler::Stats cpu = profiler.getCpuStats(i);
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%s", profiler.getTimerName(i));
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f/%.2f/%.2f", cpu.average, cpu.p95, cpu.p99);
+				ImGui::TableNextColumn();
+				if (profiler.hasGpu(i)) {
+					Profiler::Stats gpu = profiler.getGpuStats(i);
+					ImGui::Text("%.2f/%.2f/%.2f", gpu.average, gpu.p95, gpu.p99);
+				}
+			}
+			ImGui::EndTable();
+		}
+	}
+
 	ImGui::EndChild();
 	ImGui::EndChild();
 
@@ -367,6 +493,39 @@ void GuiSystem::showRightSideBar(double deltaTime)
 	draw->AddRectFilled(ImVec2(x0, 0), ImVec2(x1, viewport->Size.y - bottomSideBarHeight - SPLITTER_THICKNESS), IM_COL32(200, 200, 200, 180));
 }
 
+void GuiSystem::pickObject(Camera& camera)
+{
+	if (!ImGui::IsMouseClicked(ImGuiMouseButton_Left) || ImGui::IsAnyItemHovered() || ImGui::IsPopupOpen("", ImGuiPopupFlags_AnyPopup)) {
+		return;
+	}
+	ImGuiViewport* viewport = ImGui::GetMainViewport();
+	ImVec2 mouse = ImGui::GetIO().MousePos;
+	float viewWidth = viewport->Size.x - leftSideBarWidth - rightSideBarWidth;
+	float viewHeight = viewport->Size.y - bottomSideBarHeight;
+	float localX = mouse.x - leftSideBarWidth;
+	float localY = mouse.y;
+	if (localX < 0 || localY < 0 || localX > viewWidth || localY > viewHeight) {
+		return;
+	}
+
+	// Ļ귴ͶӰ/Զƽõռ
+	glm::vec2 ndc(localX / viewWidth * 2.0f - 1.0f, 1.0f - localY / viewHeight * 2.0f);
+	glm::mat4 invVP = glm::inverse(camera.getProjectionMat(viewWidth, viewHeight) * camera.getViewMat());
+	glm::vec4 nearPoint = invVP * glm::vec4(ndc, -1.0f, 1.0f);
+	glm::vec4 farPoint = invVP * glm::vec4(ndc, 1.0f, 1.0f);
+	glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+	glm::vec3 direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+
+	unsigned int hitIndex;
+	if (ResourceManager::getInstance().getRenderProxies().raycast(origin, direction, hitIndex)) {
+		auto gameObjects = ResourceManager::getInstance().getGameObjects();
+		if (hitIndex < gameObjects.size()) {
+			selected = (int)hitIndex;
+			objectSelected = gameObjects[hitIndex];
+		}
+	}
+}
+
 void GuiSystem::showBottomSideBar()
 {
 	ImGuiViewport* viewport = ImGui::GetMainViewport();
@@ -384,6 +543,31 @@ void GuiSystem::showBottomSideBar()
 		ImGui::EndMenuBar();
 	}
 
+	for (const ModelLoader::Progress& progress : ResourceManager::getInstance().getModelLoadProgress()) {
+		std::string fileName = std::filesystem::path(progress.path).filename().string();
+		switch (progress.stage) {
+			case ModelLoader::Stage::IMPORTING:
+				ImGui::Text(u8"%s   %.0fms", fileName.c_str(), progress.totalMs);
+				break;
+			case ModelLoader::Stage::PROCESSING:
+				ImGui::Text(u8"%s   %d/%d  ϴ %d/%d", fileName.c_str(), progress.meshesProcessed, progress.meshCount,
+					progress.meshesUploaded, progress.meshCount);
+				break;
+			case ModelLoader::Stage::DONE:
+				ImGui::Text(u8"%s   %.0fms (%s %.0f   %.0f  ϴ %.0f)", fileName.c_str(), progress.totalMs,
+					progress.cooked ? u8"ȡ" : u8"", progress.importMs, progress.processMs, progress.uploadMs);
+				// ATVR = δ / δ = ACMR * 
+				ImGui::Text(u8"     %d -> %d  ACMR %.2f -> %.2f  ATVR %.2f -> %.2f", progress.verticesBefore, progress.verticesAfter,
+					progress.acmrBefore, progress.acmrAfter,
+					progress.verticesBefore ? progress.acmrBefore * progress.triangles / progress.verticesBefore : 0.0f,
+					progress.verticesAfter ? progress.acmrAfter * progress.triangles / progress.verticesAfter : 0.0f);
+				break;
+			case ModelLoader::Stage::FAILED:
+				ImGui::Text(u8"%s  ʧ", fileName.c_str());
+				break;
+		}
+	}
+
 	static int itemsPerRow = 4;
 	const float itemWidth = 80.0f;
 	const float itemHeight = 80.0f;
@@ -454,9 +638,44 @@ void GuiSystem::registComponents()
 	registerComponentWidget<Transform>("Transform", [](std::shared_ptr<Transform> transform) {
 		ImGui::Text(u8"Transform");
 		ImGui::Separator();
-		ImGui::DragFloat3(u8"Translate", glm::value_ptr(transform->translate));
-		ImGui::DragFloat3(u8"Scale", glm::value_ptr(transform->scale));
-		ImGui::DragFloat3(u8"Rotate", glm::value_ptr(transform->rotate));
+		bool changed = false;
+		changed |= ImGui::DragFloat3(u8"Translate", glm::value_ptr(transform->translate));
+		changed |= ImGui::DragFloat3(u8"Scale", glm::value_ptr(transform->scale));
+		changed |= ImGui::DragFloat3(u8"Rotate", glm::value_ptr(transform->rotate));
+		if (changed) {
+			transform->markDirty();
+		}
+		auto parent = transform->getParent();
+		auto gameObjects = ResourceManager::getInstance().getGameObjects();
+		std::string parentName = u8"";
+		for (auto& object : gameObjects) {
+			if (parent && object->getComponent<Transform>() == parent) {
+				parentName = object->getName();
+			}
+		}
+		if (ImGui::BeginCombo(u8"Parent", parentName.c_str())) {
+			if (ImGui::Selectable(u8"", !parent)) {
+				transform->setParent(nullptr);
+			}
+			for (size_t i = 0; i < gameObjects.size(); i++) {
+				auto candidate = gameObjects[i]->getComponent<Transform>();
+				// ӽڵ㣬γɻ
+				bool isDescendant = false;
+				for (auto node = candidate; node; node = node->getParent()) {
+					if (node == transform) {
+						isDescendant = true;
+						break;
+					}
+				}
+				if (!candidate || isDescendant) continue;
+				ImGui::PushID((int)i);
+				if (ImGui::Selectable(gameObjects[i]->getName().c_str(), candidate == parent)) {
+					transform->setParent(candidate);
+				}
+				ImGui::PopID();
+			}
+			ImGui::EndCombo();
+		}
 		ImGui::Separator();
 		});
 
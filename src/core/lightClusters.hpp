@@ -0,0 +1,231 @@
+#ifndef LIGHTCLUSTERS_HPP
+#define LIGHTCLUSTERS_HPP
+#pragma once
+
+#include "../lightBuffer.hpp"
+#include "../shader.hpp"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+// ִǰգ׶ĻtileֲָƬֳɴأ
+// CPUÿ֡ѵԴӰ䵽ཻĴأƬԪɫֻڴصĹԴб
+class LightClusters {
+public:
+	static const int CLUSTER_X = 16;
+	static const int CLUSTER_Y = 9;
+	static const int CLUSTER_Z = 24;
+	static const int CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+
+	LightClusters() = default;
+	void init(GLuint gridBinding, GLuint indexBinding);
+	void destroy();
+	// lightsе±PointLightBufferе±һ
+	void build(const std::vector<GPUPointLight>& lights, const glm::mat4& view, const glm::mat4& projection,
+		float zNear, float zFar, float width, float height);
+	void upload();
+	// ɫҪĲ
+	void apply(const ShaderPtr& shader) const;
+
+	float getAverageLightsPerCluster() const { return (float)indices.size() / CLUSTER_COUNT; }
+	int getMaxLightsPerCluster() const { return maxLightsPerCluster; }
+
+	// ˥ڸֵĲֺԣȷԴӰ뾶
+	static float lightRadius(const GPUPointLight& light, float cutoff = 1.0f / 256.0f);
+private:
+	GLuint gridBuffer = 0, indexBuffer = 0;
+	GLuint gridBinding = 4, indexBinding = 5;
+
+	float zNear = 0.1f, zFar = 100.0f;
+	glm::vec2 tileSize = glm::vec2(1.0f);
+	// صӿռΧֻͶӰӿڴСйأʱ
+	glm::mat4 cachedProjection = glm::mat4(0.0f);
+	float cachedWidth = 0.0f, cachedHeight = 0.0f;
+	std::vector<glm::vec3> clusterMin, clusterMax;
+
+	std::vector<std::vector<unsigned int>> clusterLights;
+	std::vector<glm::uvec2> grid; // ÿindicesе(ƫ, )
+	std::vector<unsigned int> indices;
+	int maxLightsPerCluster = 0;
+
+	void buildClusterBounds(const glm::mat4& projection, float width, float height);
+	float sliceDepth(int slice) const { return zNear * std::pow(zFar / zNear, (float)slice / CLUSTER_Z); }
+	int depthSlice(float depth) const;
+	static int clusterIndex(int x, int y, int z) { return (z * CLUSTER_Y + y) * CLUSTER_X + x; }
+};
+
+void LightClusters::init(GLuint gridBinding, GLuint indexBinding) {
+	this->gridBinding = gridBinding;
+	this->indexBinding = indexBinding;
+	glGenBuffers(1, &gridBuffer);
+	glGenBuffers(1, &indexBuffer);
+	clusterLights.resize(CLUSTER_COUNT);
+	grid.resize(CLUSTER_COUNT);
+}
+
+void LightClusters::destroy() {
+	if (gridBuffer) {
+		glDeleteBuffers(1, &gridBuffer);
+		gridBuffer = 0;
+	}
+	if (indexBuffer) {
+		glDeleteBuffers(1, &indexBuffer);
+		indexBuffer = 0;
+	}
+}
+
+float LightClusters::lightRadius(const GPUPointLight& light, float cutoff) {
+	//  quadratic*d^2 + linear*d + constant = intensity / cutoff
+	float intensity = light.brightness * std::max(light.color.r, std::max(light.color.g, light.color.b));
+	float c = light.constant - intensity / cutoff;
+	if (c >= 0.0f) return 0.0f;
+	if (light.quadratic > 0.0f) {
+		return (-light.linear + std::sqrt(light.linear * light.linear - 4.0f * light.quadratic * c)) / (2.0f * light.quadratic);
+	}
+	if (light.linear > 0.0f) {
+		return -c / light.linear;
+	}
+	// ˥ĹԴӰд
+	return FLT_MAX;
+}
+
+int LightClusters::depthSlice(float depth) const {
+	int slice = (int)std::floor(std::log(depth / zNear) / std::log(zFar / zNear) * CLUSTER_Z);
+	return std::clamp(slice, 0, CLUSTER_Z - 1);
+}
+
+void LightClusters::buildClusterBounds(const glm::mat4& projection, float width, float height) {
+	cachedProjection = projection;
+	cachedWidth = width;
+	cachedHeight = height;
+	tileSize = glm::vec2(std::ceil(width / CLUSTER_X), std::ceil(height / CLUSTER_Y));
+	clusterMin.resize(CLUSTER_COUNT);
+	clusterMax.resize(CLUSTER_COUNT);
+
+	glm::mat4 invProjection = glm::inverse(projection);
+	auto unproject = [&](float px, float py) {
+		glm::vec4 p = invProjection * glm::vec4(px / width * 2.0f - 1.0f, py / height * 2.0f - 1.0f, -1.0f, 1.0f);
+		return glm::vec3(p) / p.w;
+	};
+	for (int y = 0; y < CLUSTER_Y; y++) {
+		for (int x = 0; x < CLUSTER_X; x++) {
+			// tileĸڽƽϵĵ㣬ŵƬǰ
+			glm::vec3 corners[4] = {
+				unproject(x * tileSize.x, y * tileSize.y),
+				unproject((x + 1) * tileSize.x, y * tileSize.y),
+				unproject(x * tileSize.x, (y + 1) * tileSize.y),
+				unproject((x + 1) * tileSize.x, (y + 1) * tileSize.y)
+			};
+			for (int z = 0; z < CLUSTER_Z; z++) {
+				float depths[2] = { sliceDepth(z), sliceDepth(z + 1) };
+				glm::vec3 minPoint(FLT_MAX), maxPoint(-FLT_MAX);
+				for (float depth : depths) {
+					for (const glm::vec3& corner : corners) {
+						glm::vec3 p = corner * (depth / -corner.z);
+						minPoint = glm::min(minPoint, p);
+						maxPoint = glm::max(maxPoint, p);
+					}
+				}
+				int idx = clusterIndex(x, y, z);
+				clusterMin[idx] = minPoint;
+				clusterMax[idx] = maxPoint;
+			}
+		}
+	}
+}
+
+void LightClusters::build(const std::vector<GPUPointLight>& lights, const glm::mat4& view, const glm::mat4& projection,
+	float zNear, float zFar, float width, float height) {
+	if (zNear != this->zNear || zFar != this->zFar || projection != cachedProjection || width != cachedWidth || height != cachedHeight) {
+		this->zNear = zNear;
+		this->zFar = zFar;
+		buildClusterBounds(projection, width, height);
+	}
+	for (std::vector<unsigned int>& list : clusterLights) {
+		list.clear();
+	}
+
+	for (size_t i = 0; i < lights.size(); i++) {
+		float radius = lightRadius(lights[i]);
+		if (radius <= 0.0f) continue;
+		glm::vec3 center = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+		float depth = -center.z;
+		if (depth + radius < zNear || depth - radius > zFar) continue;
+		int z0 = depthSlice(std::max(depth - radius, zNear));
+		int z1 = depthSlice(std::min(depth + radius, zFar));
+
+		// ȫڽƽǰʱӿռΧа˸ǵͶӰȷtileΧ򸲸Ļ
+		int x0 = 0, x1 = CLUSTER_X - 1, y0 = 0, y1 = CLUSTER_Y - 1;
+		if (depth - radius > zNear) {
+			glm::vec2 ndcMin(FLT_MAX), ndcMax(-FLT_MAX);
+			for (int c = 0; c < 8; c++) {
+				glm::vec3 corner = center + glm::vec3(c & 1 ? radius : -radius, c & 2 ? radius : -radius, c & 4 ? radius : -radius);
+				glm::vec4 clip = projection * glm::vec4(corner, 1.0f);
+				glm::vec2 ndc = glm::vec2(clip) / clip.w;
+				ndcMin = glm::min(ndcMin, ndc);
+				ndcMax = glm::max(ndcMax, ndc);
+			}
+			if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f) continue;
+			x0 = std::clamp((int)std::floor((ndcMin.x * 0.5f + 0.5f) * width / tileSize.x), 0, CLUSTER_X - 1);
+			x1 = std::clamp((int)std::floor((ndcMax.x * 0.5f + 0.5f) * width / tileSize.x), 0, CLUSTER_X - 1);
+			y0 = std::clamp((int)std::floor((ndcMin.y * 0.5f + 0.5f) * height / tileSize.y), 0, CLUSTER_Y - 1);
+			y1 = std::clamp((int)std::floor((ndcMax.y * 0.5f + 0.5f) * height / tileSize.y), 0, CLUSTER_Y - 1);
+		}
+
+		float radiusSq = radius * radius;
+		for (int z = z0; z <= z1; z++) {
+			for (int y = y0; y <= y1; y++) {
+				for (int x = x0; x <= x1; x++) {
+					int idx = clusterIndex(x, y, z);
+					// ĵذΧе
+					glm::vec3 closest = glm::clamp(center, clusterMin[idx], clusterMax[idx]);
+					glm::vec3 d = closest - center;
+					if (glm::dot(d, d) <= radiusSq) {
+						clusterLights[idx].push_back((unsigned int)i);
+					}
+				}
+			}
+		}
+	}
+
+	indices.clear();
+	maxLightsPerCluster = 0;
+	for (int i = 0; i < CLUSTER_COUNT; i++) {
+		const std::vector<unsigned int>& list = clusterLights[i];
+		grid[i] = glm::uvec2((unsigned int)indices.size(), (unsigned int)list.size());
+		indices.insert(indices.end(), list.begin(), list.end());
+		maxLightsPerCluster = std::max(maxLightsPerCluster, (int)list.size());
+	}
+}
+
+void LightClusters::upload() {
+	// ÿ֡дglBufferData´洢Ҫȴһ֡
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, gridBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, grid.size() * sizeof(glm::uvec2), grid.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, indexBuffer);
+	// յSSBOܰ󶨣ٷһԪ
+	unsigned int empty = 0;
+	if (indices.empty()) {
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int), &empty, GL_STREAM_DRAW);
+	}
+	else {
+		glBufferData(GL_SHADER_STORAGE_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, gridBinding, gridBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, indexBinding, indexBuffer);
+}
+
+void LightClusters::apply(const ShaderPtr& shader) const {
+	// slice = log(depth) * scale + biasdepthSliceһ
+	float logRatio = std::log(zFar / zNear);
+	shader->setIVec3("clusterDims", glm::ivec3(CLUSTER_X, CLUSTER_Y, CLUSTER_Z));
+	shader->setVec2("clusterTileSize", tileSize);
+	shader->setFloat("clusterScale", CLUSTER_Z / logRatio);
+	shader->setFloat("clusterBias", -CLUSTER_Z * std::log(zNear) / logRatio);
+}
+
+#endif // !LIGHTCLUSTERS_HPP
@@ -0,0 +1,312 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+#pragma once
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// ֡CPU/GPUֶμʱCPUsteady_clockGPUڷֶ˸дһGL_TIMESTAMPѯ
+// GPUѯֳ֡FRAME_LATENCYʹãһFRAME_LATENCY֮֡Ŷȡû׼ʱһ֡ȴGPU
+// ֶͬһ֡ڶγʱۼӣÿֶαWINDOW֡ĺʱƽֵp95/p99
+// TRACE_FRAMES֡ÿһηֶζԵΪChrome trace(chrome://tracingPerfetto)
+class Profiler {
+public:
+	static constexpr int FRAME_LATENCY = 3;
+	static constexpr int WINDOW = 240;
+	static constexpr int TRACE_FRAMES = 300;
+
+	static Profiler& getInstance() {
+		static Profiler instance;
+		return instance;
+	}
+
+	struct Stats {
+		float last = 0.0f, average = 0.0f, p95 = 0.0f, p99 = 0.0f; // 
+		int samples = 0;
+	};
+
+	// GLʼ֮
+	void init();
+	void beginFrame();
+	void endFrame();
+	// nameַָݲƣgpuΪtrueʱͬʱ¼GPUʱ
+	// صľֻڱ֡ЧenabledΪfalseʱ-1
+	int begin(const char* name, bool gpu = false);
+	void end(int scope);
+	// GPUɲȡлûȡ֡нʱãFRAME_LATENCY֡ʧ
+	void flush();
+
+	// һγֵ˳
+	int getTimerCount() const { return (int)timers.size(); }
+	const char* getTimerName(int index) const { return timers[index].name; }
+	bool hasGpu(int index) const { return timers[index].gpu.count > 0; }
+	Stats getCpuStats(int index) const { return timers[index].cpu.stats(); }
+	Stats getGpuStats(int index) const { return timers[index].gpu.stats(); }
+	// ûгֹʱ0
+	float getLastGpuMs(const char* name) const;
+	int getDroppedFrames() const { return droppedFrames; }
+
+	bool exportChromeTrace(const std::string& path) const;
+	// ÿֶһУWINDOW֡CPU/GPUƽֵp95/p99
+	bool exportCsv(const std::string& path) const;
+
+	bool enabled = true;
+private:
+	Profiler() = default;
+	~Profiler() = default;
+
+	struct Ring {
+		float values[WINDOW] = {};
+		int count = 0, next = 0;
+		void push(float value);
+		Stats stats() const;
+	};
+	struct Timer {
+		const char* name;
+		Ring cpu, gpu;
+		float cpuFrame = 0.0f, gpuFrame = 0.0f;
+		bool cpuUsed = false, gpuUsed = false;
+	};
+	struct OpenScope {
+		int timer;
+		double startUs;
+		int beginQuery; // -1ʾֻ¼CPU
+	};
+	struct GpuEvent {
+		int timer;
+		int beginQuery, endQuery;
+	};
+	// һ֡GPUѯqueriesֻһֵһʱ
+	struct FrameQueries {
+		std::vector<GLuint> queries;
+		int used = 0;
+		std::vector<GpuEvent> events;
+		long long frame = 0;
+		double gpuOffsetUs = 0.0; // GPUʱõCPUʱϵ΢
+		bool pending = false;
+	};
+	struct TraceEvent {
+		int timer;
+		bool gpu;
+		long long frame;
+		double startUs, durationUs;
+	};
+
+	std::vector<Timer> timers;
+	std::unordered_map<std::string_view, int> timerIndices;
+	std::vector<OpenScope> openScopes;
+	FrameQueries frames[FRAME_LATENCY];
+	std::deque<TraceEvent> trace;
+	long long frameIndex = 0;
+	int droppedFrames = 0;
+	bool initialized = false;
+	std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+	double nowUs() const { return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count(); }
+	int findTimer(const char* name);
+	int allocateQuery(FrameQueries& frame);
+	void collect(FrameQueries& frame);
+};
+
+void Profiler::Ring::push(float value) {
+	values[next] = value;
+	next = (next + 1) % WINDOW;
+	count = std::min(count + 1, WINDOW);
+}
+
+Profiler::Stats Profiler::Ring::stats() const {
+	Stats result;
+	result.samples = count;
+	if (count == 0) return result;
+	result.last = values[(next + WINDOW - 1) % WINDOW];
+	float sorted[WINDOW];
+	float sum = 0.0f;
+	for (int i = 0; i < count; i++) {
+		sorted[i] = values[i];
+		sum += values[i];
+	}
+	std::sort(sorted, sorted + count);
+	result.average = sum / count;
+	result.p95 = sorted[std::min(count - 1, (int)(count * 0.95f))];
+	result.p99 = sorted[std::min(count - 1, (int)(count * 0.99f))];
+	return result;
+}
+
+void Profiler::init() {
+	initialized = true;
+	origin = std::chrono::steady_clock::now();
+}
+
+int Profiler::findTimer(const char* name) {
+	auto it = timerIndices.find(name);
+	if (it != timerIndices.end()) return it->second;
+	timers.push_back(Timer());
+	timers.back().name = name;
+	timerIndices[name] = (int)timers.size() - 1;
+	return (int)timers.size() - 1;
+}
+
+int Profiler::allocateQuery(FrameQueries& frame) {
+	if (frame.used == (int)frame.queries.size()) {
+		GLuint query = 0;
+		glGenQueries(1, &query);
+		frame.queries.push_back(query);
+	}
+	return frame.used++;
+}
+
+void Profiler::beginFrame() {
+	frameIndex++;
+	openScopes.clear();
+	while (!trace.empty() && trace.front().frame <= frameIndex - TRACE_FRAMES) {
+		trace.pop_front();
+	}
+	if (!initialized) return;
+	FrameQueries& frame = frames[frameIndex % FRAME_LATENCY];
+	if (frame.pending) {
+		collect(frame);
+	}
+	frame.used = 0;
+	frame.events.clear();
+	frame.frame = frameIndex;
+	frame.pending = false;
+	// ÿ֡¶һGPUCPUʱᣬGL_TIMESTAMPصGPUʱʱ䣬ֻtraceеĴλ
+	GLint64 gpuNow = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+	frame.gpuOffsetUs = nowUs() - gpuNow / 1000.0;
+}
+
+void Profiler::endFrame() {
+	for (Timer& timer : timers) {
+		if (timer.cpuUsed) {
+			timer.cpu.push(timer.cpuFrame);
+		}
+		timer.cpuFrame = 0.0f;
+		timer.cpuUsed = false;
+	}
+	if (initialized) {
+		frames[frameIndex % FRAME_LATENCY].pending = !frames[frameIndex % FRAME_LATENCY].events.empty();
+	}
+}
+
+int Profiler::begin(const char* name, bool gpu) {
+	if (!enabled) return -1;
+	OpenScope scope;
+	scope.timer = findTimer(name);
+	scope.beginQuery = -1;
+	if (gpu && initialized) {
+		FrameQueries& frame = frames[frameIndex % FRAME_LATENCY];
+		scope.beginQuery = allocateQuery(frame);
+		glQueryCounter(frame.queries[scope.beginQuery], GL_TIMESTAMP);
+	}
+	scope.startUs = nowUs();
+	openScopes.push_back(scope);
+	return (int)openScopes.size() - 1;
+}
+
+void Profiler::end(int scope) {
+	if (scope < 0 || scope >= (int)openScopes.size()) return;
+	const OpenScope& open = openScopes[scope];
+	double endUs = nowUs();
+	Timer& timer = timers[open.timer];
+	timer.cpuFrame += (float)((endUs - open.startUs) / 1000.0);
+	timer.cpuUsed = true;
+	trace.push_back({ open.timer, false, frameIndex, open.startUs, endUs - open.startUs });
+	if (open.beginQuery >= 0) {
+		FrameQueries& frame = frames[frameIndex % FRAME_LATENCY];
+		int endQuery = allocateQuery(frame);
+		glQueryCounter(frame.queries[endQuery], GL_TIMESTAMP);
+		frame.events.push_back({ open.timer, open.beginQuery, endQuery });
+	}
+}
+
+void Profiler::flush() {
+	if (!initialized) return;
+	glFinish();
+	// һ֡ʼÿֶε֡˳
+	for (int i = 1; i <= FRAME_LATENCY; i++) {
+		FrameQueries& frame = frames[(frameIndex + i) % FRAME_LATENCY];
+		if (frame.pending) {
+			collect(frame);
+			frame.pending = false;
+		}
+	}
+}
+
+void Profiler::collect(FrameQueries& frame) {
+	// ʱύ˳ɣһʱǰĶ
+	GLint available = 0;
+	glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		droppedFrames++;
+		return;
+	}
+	for (Timer& timer : timers) {
+		timer.gpuFrame = 0.0f;
+		timer.gpuUsed = false;
+	}
+	for (const GpuEvent& event : frame.events) {
+		GLuint64 beginNs = 0, endNs = 0;
+		glGetQueryObjectui64v(frame.queries[event.beginQuery], GL_QUERY_RESULT, &beginNs);
+		glGetQueryObjectui64v(frame.queries[event.endQuery], GL_QUERY_RESULT, &endNs);
+		double durationUs = endNs > beginNs ? (endNs - beginNs) / 1000.0 : 0.0;
+		Timer& timer = timers[event.timer];
+		timer.gpuFrame += (float)(durationUs / 1000.0);
+		timer.gpuUsed = true;
+		trace.push_back({ event.timer, true, frame.frame, beginNs / 1000.0 + frame.gpuOffsetUs, durationUs });
+	}
+	for (Timer& timer : timers) {
+		if (timer.gpuUsed) {
+			timer.gpu.push(timer.gpuFrame);
+		}
+	}
+}
+
+float Profiler::getLastGpuMs(const char* name) const {
+	auto it = timerIndices.find(name);
+	if (it == timerIndices.end()) return 0.0f;
+	return timers[it->second].gpu.stats().last;
+}
+
+bool Profiler::exportChromeTrace(const std::string& path) const {
+	std::ofstream out(path, std::ios::trunc);
+	if (!out) return false;
+	// CPUGPUֳߣtsdurĵλ΢
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+	out.setf(std::ios::fixed);
+	out.precision(3);
+	for (const TraceEvent& event : trace) {
+		out << ",\n{\"name\":\"" << timers[event.timer].name << "\",\"cat\":\"" << (event.gpu ? "gpu" : "cpu")
+			<< "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (event.gpu ? 2 : 1) << ",\"ts\":" << event.startUs
+			<< ",\"dur\":" << event.durationUs << ",\"args\":{\"frame\":" << event.frame << "}}";
+	}
+	out << "\n]}\n";
+	return (bool)out;
+}
+
+bool Profiler::exportCsv(const std::string& path) const {
+	std::ofstream out(path, std::ios::trunc);
+	if (!out) return false;
+	out << "name,cpu_avg_ms,cpu_p95_ms,cpu_p99_ms,cpu_samples,gpu_avg_ms,gpu_p95_ms,gpu_p99_ms,gpu_samples\n";
+	out.setf(std::ios::fixed);
+	out.precision(4);
+	for (const Timer& timer : timers) {
+		Stats cpu = timer.cpu.stats();
+		Stats gpu = timer.gpu.stats();
+		out << timer.name << ',' << cpu.average << ',' << cpu.p95 << ',' << cpu.p99 << ',' << cpu.samples << ','
+			<< gpu.average << ',' << gpu.p95 << ',' << gpu.p99 << ',' << gpu.samples << '\n';
+	}
+	return (bool)out;
+}
+
+#endif // !PROFILER_HPP
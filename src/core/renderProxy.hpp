@@ -0,0 +1,162 @@
+#ifndef RENDERPROXY_HPP
+#define RENDERPROXY_HPP
+#pragma once
+
+#include "../camera.hpp"
+#include "../component.hpp"
+#include "../gameObject.hpp"
+#include "bvh.hpp"
+#include "frustumCuller.hpp"
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+// SceneManagerж±һһӦıƽݣȾʱֱӱ飬
+// ÿpassÿ嶼getComponent
+class RenderProxyStore {
+public:
+	RenderProxyStore() = default;
+
+	void add(const GameObjectPtr& obj);
+	void removeAt(size_t idx);
+	void update();
+	size_t size() const { return objects.size(); }
+	bool isOnFrustum(size_t idx, const Frustum& frustum) const;
+	// ĳͼһ޳ѿɼָ±дvisible
+	void cullFrustum(const Frustum& frustum, GameObject::Type type, std::vector<unsigned int>& visible) const;
+	void cullSphere(const glm::vec3& center, float radius, GameObject::Type type, std::vector<unsigned int>& visible) const;
+	// ༭ʰȡ±
+	bool raycast(const glm::vec3& origin, const glm::vec3& direction, unsigned int& hitIndex) const;
+
+	std::vector<GameObject::Type> types;
+	std::vector<GameObject*> objects;
+	std::vector<Transform*> transforms;
+	std::vector<const AABB*> localBounds;
+	std::vector<const unsigned int*> boundsSources; // еboundsVersionģͻʱı
+	std::vector<unsigned int> transformVersions;
+	std::vector<unsigned int> boundsVersions;
+	std::vector<glm::mat4> worldMatrices;
+	BoundsSoA worldBounds; // ûаΧеΪպУ޳ʱǲɼ
+	std::vector<unsigned char> hasBounds;
+private:
+	BVH bvh;
+	bool bvhDirty = true; // ɾ±仯Ҫؽ
+	std::vector<unsigned int> moved;
+	void filterByType(GameObject::Type type, std::vector<unsigned int>& visible) const;
+};
+
+void RenderProxyStore::add(const GameObjectPtr& obj) {
+	const AABB* bounds = nullptr;
+	const unsigned int* boundsSource = nullptr;
+	if (auto renderComponent = obj->getComponent<RenderComponent>()) {
+		bounds = &renderComponent->aabb;
+		boundsSource = &renderComponent->boundsVersion;
+	}
+	else if (auto staticMeshComponent = obj->getComponent<StaticMeshComponent>()) {
+		bounds = &staticMeshComponent->aabb;
+		boundsSource = &staticMeshComponent->boundsVersion;
+	}
+	auto transform = obj->getComponent<Transform>();
+
+	types.push_back(obj->getType());
+	objects.push_back(obj.get());
+	transforms.push_back(transform.get());
+	localBounds.push_back(bounds);
+	boundsSources.push_back(boundsSource);
+	transformVersions.push_back(0);
+	boundsVersions.push_back(0);
+	worldMatrices.push_back(glm::mat4(1.0f));
+	worldBounds.resize(objects.size());
+	hasBounds.push_back(bounds && transform ? 1 : 0);
+	bvhDirty = true;
+}
+
+void RenderProxyStore::removeAt(size_t idx) {
+	if (idx >= objects.size()) return;
+	types.erase(types.begin() + idx);
+	objects.erase(objects.begin() + idx);
+	transforms.erase(transforms.begin() + idx);
+	localBounds.erase(localBounds.begin() + idx);
+	boundsSources.erase(boundsSources.begin() + idx);
+	transformVersions.erase(transformVersions.begin() + idx);
+	boundsVersions.erase(boundsVersions.begin() + idx);
+	worldMatrices.erase(worldMatrices.begin() + idx);
+	worldBounds.erase(idx);
+	hasBounds.erase(hasBounds.begin() + idx);
+	bvhDirty = true;
+}
+
+void RenderProxyStore::update() {
+	moved.clear();
+	for (size_t i = 0; i < objects.size(); i++) {
+		Transform* transform = transforms[i];
+		if (!transform) continue;
+		// ֻб任򱾵ذΧиı¼Χ
+		unsigned int version = transform->getVersion();
+		unsigned int boundsVersion = boundsSources[i] ? *boundsSources[i] : 0;
+		if (version == transformVersions[i] && boundsVersion == boundsVersions[i]) continue;
+		transformVersions[i] = version;
+		boundsVersions[i] = boundsVersion;
+		const glm::mat4& model = transform->getWorldMatrix();
+		worldMatrices[i] = model;
+
+		if (!hasBounds[i]) continue;
+		// /볤ʽ任ΧУǱصռAABB
+		glm::vec3 center = (localBounds[i]->max + localBounds[i]->min) * 0.5f;
+		glm::vec3 extent = (localBounds[i]->max - localBounds[i]->min) * 0.5f;
+		glm::mat3 absRotScale = glm::mat3(model);
+		for (int c = 0; c < 3; c++) {
+			absRotScale[c] = glm::abs(absRotScale[c]);
+		}
+		worldBounds.set(i, glm::vec3(model * glm::vec4(center, 1.0f)), absRotScale * extent);
+		moved.push_back((unsigned int)i);
+	}
+	if (bvhDirty || !bvh.refit(worldBounds, moved)) {
+		bvh.build(worldBounds);
+		bvhDirty = false;
+	}
+}
+
+bool RenderProxyStore::isOnFrustum(size_t idx, const Frustum& frustum) const {
+	if (!hasBounds[idx]) return false;
+	glm::vec3 center = worldBounds.center(idx);
+	glm::vec3 extent = worldBounds.extent(idx);
+	const glm::vec4 planes[6] = {
+		frustum.leftPlane, frustum.rightPlane,
+		frustum.bottomPlane, frustum.topPlane,
+		frustum.nearPlane, frustum.farPlane
+	};
+	for (int p = 0; p < 6; p++) {
+		float distance = planes[p].x * center.x + planes[p].y * center.y + planes[p].z * center.z + planes[p].w;
+		float radius = glm::abs(planes[p].x) * extent.x + glm::abs(planes[p].y) * extent.y + glm::abs(planes[p].z) * extent.z;
+		if (distance + radius < 0) return false;
+	}
+	return true;
+}
+
+void RenderProxyStore::cullFrustum(const Frustum& frustum, GameObject::Type type, std::vector<unsigned int>& visible) const {
+	bvh.queryFrustum(frustum, visible);
+	filterByType(type, visible);
+}
+
+void RenderProxyStore::cullSphere(const glm::vec3& center, float radius, GameObject::Type type, std::vector<unsigned int>& visible) const {
+	bvh.querySphere(center, radius, visible);
+	filterByType(type, visible);
+}
+
+bool RenderProxyStore::raycast(const glm::vec3& origin, const glm::vec3& direction, unsigned int& hitIndex) const {
+	float hitDistance;
+	return bvh.raycast(origin, direction, hitIndex, hitDistance);
+}
+
+void RenderProxyStore::filterByType(GameObject::Type type, std::vector<unsigned int>& visible) const {
+	size_t count = 0;
+	for (unsigned int i : visible) {
+		if (types[i] == type) {
+			visible[count++] = i;
+		}
+	}
+	visible.resize(count);
+}
+
+#endif // !RENDERPROXY_HPP
@@ -0,0 +1,64 @@
+#ifndef RENDERSETTINGS_HPP
+#define RENDERSETTINGS_HPP
+#pragma once
+
+#include "../glState.hpp"
+
+// ȾúͳƣGuiSystem޸áʾͳƣRenderSystemȡáдͳ
+class RenderSettings {
+public:
+	static RenderSettings& getInstance() {
+		static RenderSettings instance;
+		return instance;
+	}
+
+	// ͬʱӵӰĵԴޣĵԴͶӰ
+	int pointShadowBudget = 10;
+	// ִعգʱлʱдsettings.glslеUSE_CLUSTERED_SHADING
+	bool clusteredShading = false;
+	// ̬񰴲ʺϲΪӻƣرʱdrawڶԱ
+	bool multiDrawIndirect = true;
+	// ÿ֡ͨPBOϴ
+	float textureUploadBudgetMB = 8.0f;
+	// ϴʱʹѹʽֻӰ֮ص
+	bool packedVertices = true;
+	// ΧͶӰСѡLODͶӰֱռĻ߶ȵıÿ뽵һlodScreenSizeLOD0
+	bool lodEnabled = true;
+	float lodScreenSize = 0.5f;
+	// ӰpassͼLODĻٽ
+	int shadowLodBias = 1;
+	// passmeshletMinTrianglesľ̬ɼɫmeshlet޳
+	bool meshletCulling = true;
+	int meshletMinTriangles = 4096;
+	// passûп޳˫ʾĿӱ濴ȱ飬ʱԹرշ׶
+	bool meshletConeCulling = true;
+	// һ֡ȹHi-Z޳ס(CPU)meshlet(GPU)ڵʱһ֡
+	bool occlusionCulling = true;
+	// pass֮ǰֻдȣɫpassGL_EQUALԣÿֻƬԪպӰ
+	bool depthPrepass = false;
+
+	struct Stats {
+		int pointLights = 0;
+		int spotLights = 0;
+		int shadowedPointLights = 0;
+		int pointShadowCapacity = 0;
+		float avgLightsPerCluster = 0.0f;
+		int maxLightsPerCluster = 0;
+		int drawCalls = 0; // ύļӻƴ
+		int indirectCommands = 0; // ϲʵ
+		int batchedMeshes = 0;
+		int triangles = 0; // ֡ύ(pass)
+		int fullDetailTriangles = 0; // ȫʹLOD0ʱ
+		int meshletsTested = 0;
+		int meshletsVisible = 0; // GPUأmeshletsTestedһ֡
+		int occludedObjects = 0; // ͨ׶޳Hi-Z޳
+		float depthPrepassMs = 0.0f; // ProfilerGPUʱ֡
+		float colorPassMs = 0.0f;
+		GLState::Counters glState; // ִкİ󶨴
+	} stats;
+private:
+	RenderSettings() = default;
+	~RenderSettings() = default;
+};
+
+#endif // !RENDERSETTINGS_HPP
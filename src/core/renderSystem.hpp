@@ -3,7 +3,11 @@
 #pragma once
 
 #include "guiSystem.hpp"
+#include "lightClusters.hpp"
+#include "profiler.hpp"
+#include "renderSettings.hpp"
 #include "resourceManager.hpp"
+#include "../depthPyramid.hpp"
 #include "../glBuffer.hpp"
 #include <glad/glad.h>
 #include <glm/gtc/type_ptr.hpp>
@@ -16,16 +20,36 @@ public:
 	void init();
 	void update(double deltaTime);
 	void render(Camera& camera);
+	// պϳɸΪдһRGBA8Ĭ֡壬޴ʱĬ֡岻һڻɶ
+	void enableOffscreenOutput();
+	// offscreenдµеRGB
+	bool readOutput(std::vector<unsigned char>& pixels, int& outWidth, int& outHeight);
 private:
 	float x, y, width, height; //viewport width and height
 	UniformBuffer uboMatrices;
-	ShaderStorageBuffer ssboPointLights, ssboDirectionLight, ssboSpotLights;
-	FrameBuffer directionLightDepthFBO, pointLightDepthFBO, hdrFBO, pingpongFBO[2], afterEffectFBO;
-	Texture2D directionLightDepthTexture, hdrTexture, brightTexture, pingpongTexture[2], afterEffectTexture, hdrDepthTexture;
+	LightBuffer lightBuffer;
+	LightClusters lightClusters;
+	DrawBatcher drawBatcher;
+	DepthPyramid depthPyramid;
+	FrameBuffer directionLightDepthFBO, pointLightDepthFBO, hdrFBO, pingpongFBO[2], afterEffectFBO, outputFBO;
+	Texture2D directionLightDepthTexture, hdrTexture, brightTexture, pingpongTexture[2], afterEffectTexture, hdrDepthTexture, outputTexture;
+	bool offscreenOutput = false;
 	Texture2D weatherMapTexture;
 	Texture3D worleyNoiseTexture3D;
 	Texture3D perlinNoiseTexture3D;
 	CubeMapArray pointLightDepthTexture;
+	// ÿͼ޳һεõĿɼбpassֱӱ
+	std::vector<unsigned int> cameraVisibleObjects, cameraVisiblePointLights;
+	std::vector<std::vector<unsigned int>> shadowVisibleObjects; // proxies±ţӰĹԴ
+	std::vector<int> pointShadowIndices; // proxies±ŵԴӰеλã-1ʾûӰ
+	std::vector<int> objectLods; // proxies±ţӰpassڴ˻ϼƫ
+	Frustum cameraFrustum;
+	void cullViews(const Frustum& frustum);
+	void cullOccluded();
+	void selectLods(Camera& camera);
+	void assignPointShadows();
+	void drawObjects(const std::vector<unsigned int>& visible, DrawBatcher::Pass pass, const ShaderPtr& shader,
+		const glm::vec3& viewPosition = glm::vec3(0.0f), float maxDistance = 0.0f);
 	void drawScreenQuad();
 };
 
@@ -43,29 +67,19 @@ void RenderSystem::init() {
 	glDepthFunc(GL_LEQUAL);
 
 	uboMatrices.init();
-	ssboPointLights.init();
-	ssboDirectionLight.init();
-	ssboSpotLights.init();
-
 	uboMatrices.bind();
 	uboMatrices.bufferBase(0);
 	uboMatrices.bufferData(2 * sizeof(glm::mat4), NULL);
 	uboMatrices.unbind();
 
-	ssboPointLights.bind();
-	ssboPointLights.bufferBase(1);
-	ssboPointLights.bufferData(100 * PointLightObject::glslSize, NULL);
-	ssboPointLights.unbind();
-
-	ssboDirectionLight.bind();
-	ssboDirectionLight.bufferBase(2);
-	ssboDirectionLight.bufferData(DirectionLightObject::glslSize, NULL);
-	ssboDirectionLight.unbind();
-	
-	ssboSpotLights.bind();
-	ssboSpotLights.bufferBase(3);
-	ssboSpotLights.bufferData(50 * SpotLightObject::glslSize, NULL);
-	ssboSpotLights.unbind();
+	lightBuffer.init(1, 2, 3, 100, 50);
+	lightClusters.init(4, 5);
+	drawBatcher.init(6);
+	depthPyramid.init();
+	// ҪResourceManagerɫ֮ǰȷǷʹbindless
+	MaterialTable::getInstance().init(7);
+	// settings.glslᱣϴʱлɫǰǰøдɫ߷ִ·ػûй
+	Shader::changeSettings("USE_CLUSTERED_SHADING", RenderSettings::getInstance().clusteredShading);
 
 	directionLightDepthFBO.init();
 	GLenum attachments1[1] = { GL_NONE };
@@ -78,7 +92,7 @@ void RenderSystem::init() {
 	GLenum attachments2[1] = { GL_NONE };
 	pointLightDepthFBO.drawBuffers(attachments2);
 	pointLightDepthFBO.readBuffer(GL_NONE);
-	pointLightDepthTexture = CubeMapArray(1024, 1024, 10, GL_CLAMP_TO_BORDER, GL_NEAREST, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT);
+	pointLightDepthTexture = CubeMapArray(1024, 1024, 4, GL_CLAMP_TO_BORDER, GL_NEAREST, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT);
 
 	hdrFBO.init();
 	hdrTexture = Texture2D(width, height, GL_CLAMP_TO_BORDER, GL_LINEAR, GL_RGBA16F, GL_RGBA, GL_FLOAT);
@@ -124,6 +138,9 @@ void RenderSystem::update(double deltaTime) {
 		pingpongTexture[0].resetSize(width, height);
 		pingpongTexture[1].resetSize(width, height);
 		afterEffectTexture.resetSize(width, height);
+		if (offscreenOutput) {
+			outputTexture.resetSize(width, height);
+		}
 	}
 	if (Input::getInstance().isUiResized()) {
 		x = GuiSystem::leftSideBarWidth;
@@ -136,11 +153,14 @@ void RenderSystem::update(double deltaTime) {
 		pingpongTexture[0].resetSize(width, height);
 		pingpongTexture[1].resetSize(width, height);
 		afterEffectTexture.resetSize(width, height);	
+		if (offscreenOutput) {
+			outputTexture.resetSize(width, height);
+		}
 	}
-	for(int i = 0; i < ResourceManager::getInstance().getGameObjectCount(); i++){
-		auto object = ResourceManager::getInstance().getGameObjectAt(i);
-		if (object->getType() == GameObject::Type::RENDEROBJECT) {
-			auto animator = object->getComponent<AnimatorComponent>();
+	const RenderProxyStore& proxies = ResourceManager::getInstance().getRenderProxies();
+	for (size_t i = 0; i < proxies.size(); i++) {
+		if (proxies.types[i] == GameObject::Type::RENDEROBJECT) {
+			auto animator = proxies.objects[i]->getComponent<AnimatorComponent>();
 			if (animator) {
 				if (animator->playing) {
 					animator->update(deltaTime);
@@ -150,13 +170,139 @@ void RenderSystem::update(double deltaTime) {
 	}
 }
 
+void RenderSystem::assignPointShadows() {
+	const RenderProxyStore& proxies = ResourceManager::getInstance().getRenderProxies();
+	RenderSettings& settings = RenderSettings::getInstance();
+	pointShadowIndices.assign(proxies.size(), -1);
+	int shadowCount = 0;
+	int pointLightCount = 0;
+	for (size_t i = 0; i < proxies.size(); i++) {
+		if (proxies.types[i] != GameObject::Type::POINTLIGHTOBJECT) continue;
+		pointLightCount++;
+		auto shadowCaster = proxies.objects[i]->getComponent<ShadowCasterCube>();
+		if (shadowCaster->enabled && shadowCount < settings.pointShadowBudget) {
+			pointShadowIndices[i] = shadowCount++;
+		}
+	}
+	// Ӱ鲻ʱݣԤ
+	int capacity = pointLightDepthTexture.getLength();
+	if (shadowCount > capacity) {
+		while (capacity < shadowCount) capacity *= 2;
+		pointLightDepthTexture.resetLength(std::min(capacity, std::max(settings.pointShadowBudget, shadowCount)));
+	}
+	settings.stats.pointLights = pointLightCount;
+	settings.stats.shadowedPointLights = shadowCount;
+	settings.stats.pointShadowCapacity = pointLightDepthTexture.getLength();
+}
+
+void RenderSystem::cullViews(const Frustum& frustum) {
+	const RenderProxyStore& proxies = ResourceManager::getInstance().getRenderProxies();
+	proxies.cullFrustum(frustum, GameObject::Type::RENDEROBJECT, cameraVisibleObjects);
+	proxies.cullFrustum(frustum, GameObject::Type::POINTLIGHTOBJECT, cameraVisiblePointLights);
+
+	if (shadowVisibleObjects.size() < proxies.size()) {
+		shadowVisibleObjects.resize(proxies.size());
+	}
+	for (size_t i = 0; i < proxies.size(); i++) {
+		std::vector<unsigned int>& visible = shadowVisibleObjects[i];
+		visible.clear();
+		GameObject* object = proxies.objects[i];
+		if (proxies.types[i] == GameObject::Type::DIRECTIONLIGHTOBJECT) {
+			auto shadowCaster = object->getComponent<ShadowCaster2D>();
+			if (shadowCaster->enabled) {
+				// ùԴԼ޳Ļ⵫ӰӿɼҲᱻ
+				proxies.cullFrustum(extractFrustum(object->getLightMatrices()), GameObject::Type::RENDEROBJECT, visible);
+			}
+		}
+		else if (proxies.types[i] == GameObject::Type::POINTLIGHTOBJECT) {
+			auto shadowCaster = object->getComponent<ShadowCasterCube>();
+			if (pointShadowIndices[i] >= 0) {
+				// ڼɫһλ꣬ȰԴľ/farPlane洢
+				// farPlaneĲֲӰð뾶ΪfarPlaneѯ
+				glm::vec3 lightPos = proxies.transforms[i]->getWorldPosition();
+				proxies.cullSphere(lightPos, shadowCaster->farPlane, GameObject::Type::RENDEROBJECT, visible);
+			}
+		}
+	}
+}
+
+void RenderSystem::cullOccluded() {
+	const RenderProxyStore& proxies = ResourceManager::getInstance().getRenderProxies();
+	RenderSettings& settings = RenderSettings::getInstance();
+	settings.stats.occludedObjects = 0;
+	if (!settings.occlusionCulling) return;
+	depthPyramid.fetchReadback();
+	// ֻ޳ͼӰpassӽǲͬ
+	size_t kept = 0;
+	for (unsigned int i : cameraVisibleObjects) {
+		if (proxies.hasBounds[i] && depthPyramid.isOccluded(proxies.worldBounds.center(i), proxies.worldBounds.extent(i))) {
+			settings.stats.occludedObjects++;
+			continue;
+		}
+		cameraVisibleObjects[kept++] = i;
+	}
+	cameraVisibleObjects.resize(kept);
+}
+
+void RenderSystem::selectLods(Camera& camera) {
+	const RenderProxyStore& proxies = ResourceManager::getInstance().getRenderProxies();
+	const RenderSettings& settings = RenderSettings::getInstance();
+	objectLods.assign(proxies.size(), 0);
+	if (!settings.lodEnabled) return;
+	glm::vec3 cameraPos = camera.getPos();
+	float tanHalfFov = std::tan(glm::radians(camera.getFov()) * 0.5f);
+	for (size_t i = 0; i < proxies.size(); i++) {
+		if (!proxies.hasBounds[i]) continue;
+		// ΧͶӰֱռĻ߶ȵıڰΧʱΪLOD0
+		float radius = glm::length(proxies.worldBounds.extent(i));
+		float distance = glm::length(proxies.worldBounds.center(i) - cameraPos);
+		if (distance <= radius) continue;
+		float screenSize = radius / (distance * tanHalfFov);
+		if (screenSize >= settings.lodScreenSize) continue;
+		int lod = (int)std::floor(std::log2(settings.lodScreenSize / std::max(screenSize, 1e-6f)));
+		objectLods[i] = std::min(lod, MAX_LODS - 1);
+	}
+}
+
+void RenderSystem::drawObjects(const std::vector<unsigned int>& visible, DrawBatcher::Pass pass, const ShaderPtr& shader,
+	const glm::vec3& viewPosition, float maxDistance) {
+	const RenderProxyStore& proxies = ResourceManager::getInstance().getRenderProxies();
+	const RenderSettings& settings = RenderSettings::getInstance();
+	bool multiDrawIndirect = settings.multiDrawIndirect;
+	bool cameraPass = pass == DrawBatcher::Pass::MAIN || pass == DrawBatcher::Pass::DEPTH_PREPASS;
+	int lodBias = cameraPass || !settings.lodEnabled ? 0 : settings.shadowLodBias;
+	drawBatcher.begin(pass, shader, viewPosition, maxDistance);
+	if (cameraPass && settings.meshletCulling) {
+		// ԤʱԤ޳ɫpassػͬmeshletGL_EQUALŲ©
+		if (pass == DrawBatcher::Pass::MAIN && settings.depthPrepass) {
+			drawBatcher.reuseMeshletCulling(settings.meshletMinTriangles);
+		}
+		else {
+			drawBatcher.enableMeshletCulling(ResourceManager::getInstance().getShader("meshletCull"), cameraFrustum, viewPosition,
+				settings.meshletConeCulling, settings.meshletMinTriangles, settings.occlusionCulling ? &depthPyramid : nullptr);
+		}
+	}
+	for (unsigned int i : visible) {
+		drawBatcher.setLod(std::min(objectLods[i] + lodBias, MAX_LODS - 1));
+		if (!multiDrawIndirect || !proxies.objects[i]->addToBatch(drawBatcher)) {
+			proxies.objects[i]->draw(shader);
+		}
+	}
+	drawBatcher.submit();
+}
+
 void RenderSystem::render(Camera& camera) {
+	Profiler& profiler = Profiler::getInstance();
+	int renderScope = profiler.begin("RenderSystem::render", true);
+	// ImGuiֱ޸İ״̬
+	GLState::getInstance().invalidate();
+	GLState::getInstance().resetCounters();
 	uboMatrices.bind();
 	uboMatrices.bufferSubdata(0, sizeof(glm::mat4), glm::value_ptr(camera.getViewMat()));
 	uboMatrices.bufferSubdata(sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(camera.getProjectionMat((float)width, (float)height)));
 	uboMatrices.unbind();
 
-	Frustum frustum = camera.getFrustum((float)width, (float)height);
+	cameraFrustum = camera.getFrustum((float)width, (float)height);
 
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -164,6 +310,7 @@ void RenderSystem::render(Camera& camera) {
 	ShaderPtr defaultShader = ResourceManager::getInstance().getShader("default");
 	ShaderPtr skyboxShader = ResourceManager::getInstance().getShader("skybox");
 	ShaderPtr depthShader = ResourceManager::getInstance().getShader("depth");
+	ShaderPtr depthPrepassShader = ResourceManager::getInstance().getShader("depthPrepass");
 	ShaderPtr screenQuadShader = ResourceManager::getInstance().getShader("screenQuad");
 	ShaderPtr depthCubeShader = ResourceManager::getInstance().getShader("depthCube");
 	ShaderPtr lightCubeShader = ResourceManager::getInstance().getShader("lightCube");
@@ -171,12 +318,25 @@ void RenderSystem::render(Camera& camera) {
 	ShaderPtr boneShader = ResourceManager::getInstance().getShader("bone");
 	ShaderPtr volumeShader = ResourceManager::getInstance().getShader("volume");
 
+	const RenderProxyStore& proxies = ResourceManager::getInstance().getRenderProxies();
+	int cullScope = profiler.begin("cull");
+	assignPointShadows();
+	// ӰʱֱӰ󶨹
+	GLState::getInstance().invalidate();
+	cullViews(cameraFrustum);
+	cullOccluded();
+	selectLods(camera);
+	drawBatcher.resetStats();
+	RenderSettings::getInstance().stats.triangles = 0;
+	RenderSettings::getInstance().stats.fullDetailTriangles = 0;
+	profiler.end(cullScope);
+
 	glViewport(0, 0, 1024, 1024);
 	//shadowmapPass
-	int pointLightIndex = 0;
-	for (int i = 0; i < ResourceManager::getInstance().getGameObjectCount(); i++) {
-		GameObjectPtr object = ResourceManager::getInstance().getGameObjectAt(i);
-		if (object->getType() == GameObject::Type::DIRECTIONLIGHTOBJECT) {
+	int shadowScope = profiler.begin("shadowPass", true);
+	for (size_t i = 0; i < proxies.size(); i++) {
+		GameObject* object = proxies.objects[i];
+		if (proxies.types[i] == GameObject::Type::DIRECTIONLIGHTOBJECT) {
 			depthShader->use();
 			auto shadowCaster = object->getComponent<ShadowCaster2D>();
 			if (shadowCaster->enabled) {
@@ -187,12 +347,7 @@ void RenderSystem::render(Camera& camera) {
 				glClear(GL_DEPTH_BUFFER_BIT);
 				glEnable(GL_CULL_FACE);
 				glCullFace(GL_FRONT);
-				for (int j = 0; j < ResourceManager::getInstance().getGameObjectCount(); j++) {
-					GameObjectPtr object = ResourceManager::getInstance().getGameObjectAt(j);
-					if (object->getType() == GameObject::Type::RENDEROBJECT && object->isOnFrustum(frustum)) {
-						object->draw(depthShader);
-					}
-				}
+				drawObjects(shadowVisibleObjects[i], DrawBatcher::Pass::DIRECTION_SHADOW, depthShader);
 				glDisable(GL_CULL_FACE);
 				directionLightDepthFBO.unbind();
 			}
@@ -203,109 +358,131 @@ void RenderSystem::render(Camera& camera) {
 				directionLightDepthFBO.unbind();
 			}
 		}
-		else if (object->getType() == GameObject::Type::POINTLIGHTOBJECT) {
+		else if (proxies.types[i] == GameObject::Type::POINTLIGHTOBJECT && pointShadowIndices[i] >= 0) {
+			// ûз䵽ӰĵԴɫshadowIndexΪ-1ҪնӦĲ
+			int shadowIndex = pointShadowIndices[i];
 			depthCubeShader->use();
 			auto shadowCaster = object->getComponent<ShadowCasterCube>();
-			if (shadowCaster->enabled) {
-				auto transform = object->getComponent<Transform>();
-				depthCubeShader->setVec3("lightPos", transform->translate);
-				depthCubeShader->setFloat("farPlane", shadowCaster->farPlane);
-				depthCubeShader->setInt("lightIndex", pointLightIndex);
-				std::vector<glm::mat4> lightMatrices = object->getLightMatricesCube();
-				for (int j = 0; j < 6; j++) {
-					depthCubeShader->setMat4(("lightMatrices[" + std::to_string(j) + "]").c_str(), lightMatrices[j]);
-				}
-				pointLightDepthFBO.bind();
-				for (int j = 0; j < 6; j++) {
-					pointLightDepthFBO.attachTextureLayer(pointLightDepthTexture, GL_DEPTH_ATTACHMENT, pointLightIndex * 6 + j);
-					glClear(GL_DEPTH_BUFFER_BIT);
-				}
-				pointLightDepthFBO.attachTexture(pointLightDepthTexture, GL_DEPTH_ATTACHMENT);
-				glEnable(GL_CULL_FACE);
-				glCullFace(GL_FRONT);
-				for (int k = 0; k < ResourceManager::getInstance().getGameObjectCount(); k++) {
-					GameObjectPtr object = ResourceManager::getInstance().getGameObjectAt(k);
-					if (object->getType() == GameObject::Type::RENDEROBJECT && object->isOnFrustum(frustum)) {
-						object->draw(depthCubeShader);
-					}
-				}
-				glDisable(GL_CULL_FACE);
-				pointLightDepthFBO.unbind();
-			}
-			else {
-				pointLightDepthFBO.bind();				
-				for (int j = 0; j < 6; j++) {
-					pointLightDepthFBO.attachTextureLayer(pointLightDepthTexture, GL_DEPTH_ATTACHMENT, pointLightIndex * 6 + j);
-					glClear(GL_DEPTH_BUFFER_BIT);
-				}
-				pointLightDepthFBO.unbind();
+			depthCubeShader->setVec3("lightPos", proxies.transforms[i]->getWorldPosition());
+			depthCubeShader->setFloat("farPlane", shadowCaster->farPlane);
+			depthCubeShader->setInt("lightIndex", shadowIndex);
+			std::vector<glm::mat4> lightMatrices = object->getLightMatricesCube();
+			depthCubeShader->setMat4Array("lightMatrices", lightMatrices.data(), 6);
+			pointLightDepthFBO.bind();
+			for (int j = 0; j < 6; j++) {
+				pointLightDepthFBO.attachTextureLayer(pointLightDepthTexture, GL_DEPTH_ATTACHMENT, shadowIndex * 6 + j);
+				glClear(GL_DEPTH_BUFFER_BIT);
 			}
-			pointLightIndex++;
+			pointLightDepthFBO.attachTexture(pointLightDepthTexture, GL_DEPTH_ATTACHMENT);
+			glEnable(GL_CULL_FACE);
+			glCullFace(GL_FRONT);
+			drawObjects(shadowVisibleObjects[i], DrawBatcher::Pass::POINT_SHADOW, depthCubeShader);
+			glDisable(GL_CULL_FACE);
+			pointLightDepthFBO.unbind();
 		}
 	}
 
+	profiler.end(shadowScope);
+
 	// lightProcessingPass
+	int lightScope = profiler.begin("lightProcessing", true);
 	defaultShader->use();
-	pointLightIndex = 0;
-	int spotLightIndex = 0;
-	for (int i = 0; i < ResourceManager::getInstance().getGameObjectCount(); i++) {
-		GameObjectPtr object = ResourceManager::getInstance().getGameObjectAt(i);
-		if (object->getType() == GameObject::Type::POINTLIGHTOBJECT) {
-			object->sendToSSBO(pointLightIndex, ssboPointLights);
-			pointLightIndex++;
+	lightBuffer.clear();
+	for (size_t i = 0; i < proxies.size(); i++) {
+		GameObject* object = proxies.objects[i];
+		if (proxies.types[i] == GameObject::Type::POINTLIGHTOBJECT) {
+			GPUPointLight& light = lightBuffer.addPointLight();
+			object->packPointLight(light);
+			light.shadowIndex = pointShadowIndices[i];
 		}
-		else if (object->getType() == GameObject::Type::SPOTLIGHTOBJECT) {
-			object->sendToSSBO(spotLightIndex, ssboSpotLights);
-			spotLightIndex++;
+		else if (proxies.types[i] == GameObject::Type::SPOTLIGHTOBJECT) {
+			object->packSpotLight(lightBuffer.addSpotLight());
 		}
-		else if (object->getType() == GameObject::Type::DIRECTIONLIGHTOBJECT) {
-			object->sendToSSBO(0, ssboDirectionLight);
+		else if (proxies.types[i] == GameObject::Type::DIRECTIONLIGHTOBJECT) {
+			object->packDirectionLight(lightBuffer.setDirectionLight());
 			auto shadowCaster = object->getComponent<ShadowCaster2D>();
 			if (shadowCaster->enabled) {
 				defaultShader->setMat4("lightSpaceMatrix", object->getLightMatrices());
 			}
 		}
 	}
-	defaultShader->setInt("pointLightNum", ResourceManager::getInstance().getPointLightCount());
-	defaultShader->setInt("directionLightNum", ResourceManager::getInstance().getDirectionLightCount());
-	defaultShader->setInt("spotLightNum", ResourceManager::getInstance().getSpotLightCount());
+	lightBuffer.upload();
+	defaultShader->setInt("pointLightNum", lightBuffer.getPointLightCount());
+	defaultShader->setInt("directionLightNum", lightBuffer.getDirectionLightCount());
+	defaultShader->setInt("spotLightNum", lightBuffer.getSpotLightCount());
+	RenderSettings& settings = RenderSettings::getInstance();
+	settings.stats.spotLights = lightBuffer.getSpotLightCount();
+	if (settings.clusteredShading) {
+		lightClusters.build(lightBuffer.getPointLights(), camera.getViewMat(), camera.getProjectionMat((float)width, (float)height),
+			camera.getNear(), camera.getFar(), (float)width, (float)height);
+		lightClusters.upload();
+		lightClusters.apply(defaultShader);
+		settings.stats.avgLightsPerCluster = lightClusters.getAverageLightsPerCluster();
+		settings.stats.maxLightsPerCluster = lightClusters.getMaxLightsPerCluster();
+	}
 	directionLightDepthTexture.use(GL_TEXTURE6);
 	pointLightDepthTexture.use(GL_TEXTURE7);
+	MaterialTable::getInstance().bind();
+	profiler.end(lightScope);
 
 	glViewport(0, 0, width, height);
 	// normalPass
 	hdrFBO.bind();
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	if (settings.depthPrepass) {
+		// depthPrepassֻдȣ֮ɫpassֻƬԪͨGL_EQUAL
+		int prepassScope = profiler.begin("depthPrepass", true);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		depthPrepassShader->use();
+		drawObjects(cameraVisibleObjects, DrawBatcher::Pass::DEPTH_PREPASS, depthPrepassShader, camera.getPos(), camera.getFar());
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		profiler.end(prepassScope);
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+	}
+	int colorScope = profiler.begin("colorPass", true);
 	defaultShader->use();
 	defaultShader->setVec3("cameraPos", camera.getPos());
-	for (int i = 0; i < ResourceManager::getInstance().getGameObjectCount(); i++) {
-		GameObjectPtr object = ResourceManager::getInstance().getGameObjectAt(i);
-		if (object->getType() == GameObject::Type::RENDEROBJECT && object->isOnFrustum(frustum)) {
-			object->draw(defaultShader);
-		}
-		else if (object->getType() == GameObject::Type::SKYBOXOBJECT) {
-			object->useCubeMap(defaultShader);
+	for (size_t i = 0; i < proxies.size(); i++) {
+		if (proxies.types[i] == GameObject::Type::SKYBOXOBJECT) {
+			proxies.objects[i]->useCubeMap(defaultShader);
 		}
 	}
+	// ΰɫʡֻλֻͬһʵ֮ӽԶ
+	drawObjects(cameraVisibleObjects, DrawBatcher::Pass::MAIN, defaultShader, camera.getPos(), camera.getFar());
+	if (settings.depthPrepass) {
+		// ԴպûвԤ
+		glDepthFunc(GL_LEQUAL);
+		glDepthMask(GL_TRUE);
+	}
 
 	lightCubeShader->use();
-	for (int i = 0; i < ResourceManager::getInstance().getGameObjectCount(); i++) {
-		GameObjectPtr object = ResourceManager::getInstance().getGameObjectAt(i);
-		if (object->getType() == GameObject::Type::POINTLIGHTOBJECT && object->isOnFrustum(frustum)) {
-			object->draw(lightCubeShader);
-		}
+	for (unsigned int i : cameraVisiblePointLights) {
+		proxies.objects[i]->draw(lightCubeShader);
 	}
 
 	skyboxShader->use();
-	for (int i = 0; i < ResourceManager::getInstance().getGameObjectCount(); i++) {
-		GameObjectPtr object = ResourceManager::getInstance().getGameObjectAt(i);
-		if (object->getType() == GameObject::Type::SKYBOXOBJECT) {
-			object->draw(skyboxShader);
+	for (size_t i = 0; i < proxies.size(); i++) {
+		if (proxies.types[i] == GameObject::Type::SKYBOXOBJECT) {
+			proxies.objects[i]->draw(skyboxShader);
 		}
 	}
+	profiler.end(colorScope);
 	hdrFBO.unbind();
 
+	// hiZPassһ֡ڵ޳ʹһ֡
+	if (settings.occlusionCulling) {
+		int hiZScope = profiler.begin("hiZBuild", true);
+		depthPyramid.build(ResourceManager::getInstance().getShader("hiZBuild"), hdrDepthTexture.ID, (int)width, (int)height,
+			camera.getProjectionMat((float)width, (float)height) * camera.getViewMat());
+		profiler.end(hiZScope);
+	}
+	else if (depthPyramid.isValid()) {
+		depthPyramid.reset();
+	}
+
 	glViewport(0, 0, width, height);
+	int volumeScope = profiler.begin("volumePass", true);
 	afterEffectFBO.bind();
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 	glClear(GL_COLOR_BUFFER_BIT);
@@ -320,17 +497,10 @@ void RenderSystem::render(Camera& camera) {
 	glm::mat4 invVP = glm::inverse(camera.getProjectionMat((float)width, (float)height) * camera.getViewMat());
 	volumeShader->setMat4("invVP", invVP);
 	bool foundDirLight = false;
-	for (int i = 0; i < ResourceManager::getInstance().getGameObjectCount(); i++) {
-		GameObjectPtr object = ResourceManager::getInstance().getGameObjectAt(i);
-		if (object->getType() == GameObject::Type::DIRECTIONLIGHTOBJECT) {
-			auto transform = object->getComponent<Transform>();
-			auto dirLight = object->getComponent<DirectionLightComponent>();
-			glm::mat4 rotation(1.0);
-			rotation = glm::rotate(rotation, glm::radians(transform->rotate.z), glm::vec3(0, 0, 1));
-			rotation = glm::rotate(rotation, glm::radians(transform->rotate.y), glm::vec3(0, 1, 0));
-			rotation = glm::rotate(rotation, glm::radians(transform->rotate.x), glm::vec3(1, 0, 0));
-			glm::vec3 direction(1.0, 0.0, 0.0);
-			direction = glm::mat3(rotation) * direction;
+	for (size_t i = 0; i < proxies.size(); i++) {
+		if (proxies.types[i] == GameObject::Type::DIRECTIONLIGHTOBJECT) {
+			auto dirLight = proxies.objects[i]->getComponent<DirectionLightComponent>();
+			glm::vec3 direction = proxies.transforms[i]->getWorldDirection(glm::vec3(1.0f, 0.0f, 0.0f));
 
 			volumeShader->setVec3("lightDir", -direction);
 			volumeShader->setVec3("lightColor", dirLight->color * dirLight->brightness);
@@ -346,34 +516,26 @@ void RenderSystem::render(Camera& camera) {
 	worleyNoiseTexture3D.use(GL_TEXTURE1);
 	weatherMapTexture.use(GL_TEXTURE2);
 	perlinNoiseTexture3D.use(GL_TEXTURE3);
-	for (int i = 0; i < ResourceManager::getInstance().getGameObjectCount(); i++) {
-		GameObjectPtr object = ResourceManager::getInstance().getGameObjectAt(i);
-		if (object->getType() == GameObject::Type::VOLUMEOBJECT) {
-			auto staticMesh = object->getComponent<StaticMeshComponent>();
-			auto transform = object->getComponent<Transform>();
-			if (staticMesh && transform) {
-				glm::mat4 model = glm::mat4(1.0f);
-				model = glm::translate(model, transform->translate);
-				model = glm::scale(model, transform->scale);
-				glm::vec3 minAABB = glm::vec3(model * glm::vec4(staticMesh->aabb.min, 1.0f));
-				glm::vec3 maxAABB = glm::vec3(model * glm::vec4(staticMesh->aabb.max, 1.0f));
-				volumeShader->setVec3("aabbMin", minAABB);
-				volumeShader->setVec3("aabbMax", maxAABB);
-				drawScreenQuad();
-			}
+	for (size_t i = 0; i < proxies.size(); i++) {
+		if (proxies.types[i] == GameObject::Type::VOLUMEOBJECT && proxies.hasBounds[i]) {
+			// ռвֱôѾת͸ڵΧ
+			glm::vec3 center = proxies.worldBounds.center(i);
+			glm::vec3 extent = proxies.worldBounds.extent(i);
+			volumeShader->setVec3("aabbMin", center - extent);
+			volumeShader->setVec3("aabbMax", center + extent);
+			drawScreenQuad();
 		}
 	}
 
 	boneShader->use();
-	for (int i = 0; i < ResourceManager::getInstance().getGameObjectCount(); i++) {
-		GameObjectPtr object = ResourceManager::getInstance().getGameObjectAt(i);
-		if (object->getType() == GameObject::Type::RENDEROBJECT && object->isOnFrustum(frustum)) {
-			object->drawSkeleton(boneShader);
-		}
+	for (unsigned int i : cameraVisibleObjects) {
+		proxies.objects[i]->drawSkeleton(boneShader);
 	}
 
 	afterEffectFBO.unbind();
+	profiler.end(volumeScope);
 
+	int bloomScope = profiler.begin("bloomBlur", true);
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	gaussianBlurShader->use();
 	for (int i = 0; i < 10; i++) {
@@ -390,12 +552,65 @@ void RenderSystem::render(Camera& camera) {
 		pingpongFBO[i % 2].unbind();
 	}
 
-	glViewport(x, y, width, height);
+	profiler.end(bloomScope);
+
+	int compositeScope = profiler.begin("composite", true);
+	if (offscreenOutput) {
+		outputFBO.bind();
+		glViewport(0, 0, width, height);
+	}
+	else {
+		glViewport(x, y, width, height);
+	}
 	screenQuadShader->use();
 	hdrTexture.use(GL_TEXTURE0);
 	pingpongTexture[1].use(GL_TEXTURE1);
 	afterEffectTexture.use(GL_TEXTURE2);
 	drawScreenQuad();
+	if (offscreenOutput) {
+		outputFBO.unbind();
+	}
+	profiler.end(compositeScope);
+
+	settings.stats.drawCalls = drawBatcher.getDrawCalls();
+	settings.stats.indirectCommands = drawBatcher.getCommandCount();
+	settings.stats.glState = GLState::getInstance().counters;
+	settings.stats.batchedMeshes = drawBatcher.getBatchedMeshes();
+	settings.stats.meshletsTested = settings.meshletCulling ? drawBatcher.getMeshletCuller().getTestedMeshlets() : 0;
+	settings.stats.meshletsVisible = settings.meshletCulling ? drawBatcher.getMeshletCuller().getVisibleMeshlets() : 0;
+	settings.stats.depthPrepassMs = settings.depthPrepass ? profiler.getLastGpuMs("depthPrepass") : 0.0f;
+	settings.stats.colorPassMs = profiler.getLastGpuMs("colorPass");
+	// Mesh::drawֱۼӵƵĲ
+	settings.stats.triangles += drawBatcher.getTriangles();
+	settings.stats.fullDetailTriangles += drawBatcher.getFullDetailTriangles();
+	lightBuffer.endFrame();
+	profiler.end(renderScope);
+}
+
+void RenderSystem::enableOffscreenOutput() {
+	if (offscreenOutput) return;
+	offscreenOutput = true;
+	outputFBO.init();
+	outputTexture = Texture2D(width, height, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+	outputFBO.bind();
+	outputFBO.attachTexture2D(outputTexture, GL_COLOR_ATTACHMENT0);
+	GLenum attachments[1] = { GL_COLOR_ATTACHMENT0 };
+	outputFBO.drawBuffers(attachments);
+	outputFBO.readBuffer(GL_COLOR_ATTACHMENT0);
+	outputFBO.unbind();
+}
+
+bool RenderSystem::readOutput(std::vector<unsigned char>& pixels, int& outWidth, int& outHeight) {
+	if (!offscreenOutput) return false;
+	outWidth = (int)width;
+	outHeight = (int)height;
+	pixels.resize((size_t)outWidth * outHeight * 3);
+	outputFBO.bind();
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, outWidth, outHeight, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	outputFBO.unbind();
+	return true;
 }
 
 void RenderSystem::drawScreenQuad()
@@ -412,7 +627,7 @@ void RenderSystem::drawScreenQuad()
 		};
 		glGenVertexArrays(1, &quadVAO);
 		glGenBuffers(1, &quadVBO);
-		glBindVertexArray(quadVAO);
+		GLState::getInstance().bindVertexArray(quadVAO);
 		glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
 		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
@@ -420,10 +635,10 @@ void RenderSystem::drawScreenQuad()
 		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
 		glEnableVertexAttribArray(1);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+		GLState::getInstance().bindVertexArray(0);
 	}
-	glBindVertexArray(quadVAO);
+	GLState::getInstance().bindVertexArray(quadVAO);
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-	glBindVertexArray(0);
+	GLState::getInstance().bindVertexArray(0);
 }
 #endif // !RENDERSYSTEM_HPP
\ No newline at end of file
@@ -5,25 +5,49 @@
 #include "../glBuffer.hpp"
 #include "../shader.hpp"
 #include "../model.hpp"
+#include "../modelCache.hpp"
 #include "../gameObject.hpp"
+#include "../textureCache.hpp"
+#include "../threadPool.hpp"
+#include "renderProxy.hpp"
+#include "renderSettings.hpp"
+#include <chrono>
+#include <deque>
+#include <future>
 #include <iostream>
+#include <memory>
 #include <queue>
 #include <unordered_map>
 
 
+// ģ͵ˮߣģͬʱ̳߳е룬ÿģ͵ɶ㣬
+// ɺõ˳߳ϴÿ֡ϴԤƣȫϴŷ뻺
+// ԤʱAssimpֱӶȡûʱɺ̳߳д뻺
 class ModelLoader{
 public:
-	ModelLoader() = default;
+	enum class Stage {
+		IMPORTING,
+		PROCESSING,
+		DONE,
+		FAILED
+	};
+	// ׶κʱ()processMsڹ߳ϵĺʱ֮
+	struct Progress {
+		std::string path;
+		Stage stage = Stage::IMPORTING;
+		int meshCount = 0, meshesProcessed = 0, meshesUploaded = 0;
+		// ǷԤȡ
+		bool cooked = false;
+		// ŻǰĶͰȨACMR
+		int verticesBefore = 0, verticesAfter = 0;
+		float acmrBefore = 0.0f, acmrAfter = 0.0f;
+		int triangles = 0;
+		double importMs = 0.0, processMs = 0.0, uploadMs = 0.0, totalMs = 0.0;
+	};
 
-	std::future<ModelPtr> loadAsync(const std::string& path){
-		return Model::LoadAsync(path.c_str());
-	}
+	ModelLoader() = default;
 
-	void loadFromPath(const std::string& path) {
-		if (!isLoaded(path)) {
-			asyncQueue.push(path);
-		}
-	}
+	void loadFromPath(const std::string& path);
 
 	bool isLoaded(const std::string& key) const{
 		return cache.find(key) != cache.end();
@@ -42,39 +66,194 @@ public:
 		return models;
 	}
 
-	void addToCache(const std::string& key, ModelPtr model) {
-		if (model && model->initGLResources()) {
-			cache[key] = model;
-		}
+	// ڽеĵɵĵ
+	std::vector<Progress> getProgress() const;
+	// ûн(ʧ)ĵ
+	int getPendingCount() const { return (int)jobs.size(); }
+
+	void update();
+	// ȴ߳ϵģ֮ͣ󲻻̳߳ģ
+	void clear();
+
+private:
+	using Clock = std::chrono::steady_clock;
+	static const size_t MESH_UPLOAD_BUDGET = 32 << 20;
+	static const size_t HISTORY_SIZE = 8;
+
+	struct ImportResult {
+		ModelPtr model;
+		bool cooked = false;
+		double ms = 0.0;
+	};
+	struct MeshResult {
+		MeshPtr mesh;
+		double ms = 0.0;
+	};
+	struct Job {
+		Progress progress;
+		Clock::time_point start;
+		std::future<ImportResult> importFuture;
+		ModelPtr model;
+		std::vector<std::future<MeshResult>> meshFutures;
+		std::vector<bool> meshTaken;
+		std::future<bool> saveFuture;
+	};
+
+	std::unordered_map<std::string, ModelPtr> cache;
+	std::vector<std::unique_ptr<Job>> jobs;
+	std::deque<Progress> history;
+	// ʱȵȹ߳̽
+	ThreadPool pool;
+
+	static double elapsedMs(Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+	template <typename T>
+	static bool isReady(const std::future<T>& future) {
+		return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
 	}
+	// trueʾѾ
+	bool updateJob(Job& job, size_t& uploadBudget);
+};
 
-	void update() {
-		// 첽
-		if (asyncFuture.valid() && asyncFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
-			auto model = asyncFuture.get();
-			if (!asyncQueue.empty()) {
-				auto path = asyncQueue.front();
-				asyncQueue.pop();
-				addToCache(path, model);
-			}
+void ModelLoader::clear() {
+	for (const auto& job : jobs) {
+		if (job->importFuture.valid()) job->importFuture.wait();
+		for (const auto& future : job->meshFutures) {
+			if (future.valid()) future.wait();
 		}
-		// µ첽
-		if ((!asyncFuture.valid() || asyncFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) 
-			&& !asyncQueue.empty()) {
-			auto path = asyncQueue.front();
-			if (!isLoaded(path)) {
-				asyncFuture = loadAsync(path);
-			} else {
-				asyncQueue.pop();
-			}
+		if (job->saveFuture.valid()) job->saveFuture.wait();
+	}
+	jobs.clear();
+	cache.clear();
+}
+
+void ModelLoader::loadFromPath(const std::string& path) {
+	if (isLoaded(path)) return;
+	for (const auto& job : jobs) {
+		if (job->progress.path == path) return;
+	}
+	auto job = std::make_unique<Job>();
+	job->progress.path = path;
+	job->start = Clock::now();
+	job->importFuture = pool.submit([path]() {
+		Clock::time_point start = Clock::now();
+		ImportResult result;
+		result.model = ModelCache::load(path);
+		result.cooked = result.model != nullptr;
+		if (!result.model) {
+			result.model = Model::import(path);
+		}
+		result.ms = elapsedMs(start);
+		return result;
+	});
+	jobs.push_back(std::move(job));
+}
+
+std::vector<ModelLoader::Progress> ModelLoader::getProgress() const {
+	std::vector<Progress> progress;
+	for (const auto& job : jobs) {
+		progress.push_back(job->progress);
+		progress.back().totalMs = elapsedMs(job->start);
+	}
+	progress.insert(progress.end(), history.begin(), history.end());
+	return progress;
+}
+
+bool ModelLoader::updateJob(Job& job, size_t& uploadBudget) {
+	Progress& progress = job.progress;
+	if (progress.stage == Stage::IMPORTING) {
+		if (!isReady(job.importFuture)) return false;
+		ImportResult result = job.importFuture.get();
+		progress.importMs = result.ms;
+		progress.cooked = result.cooked;
+		if (!result.model) {
+			progress.stage = Stage::FAILED;
+			return true;
+		}
+		// ͽڵѾÿ񵥶ύһ
+		job.model = result.model;
+		progress.stage = Stage::PROCESSING;
+		progress.meshCount = (int)job.model->getMeshCount();
+		job.meshTaken.assign(job.model->getMeshCount(), false);
+		for (size_t i = 0; i < job.model->getMeshCount(); i++) {
+			ModelPtr model = job.model;
+			job.meshFutures.push_back(pool.submit([model, i]() {
+				Clock::time_point start = Clock::now();
+				MeshResult result;
+				result.mesh = model->buildMesh(i);
+				result.ms = elapsedMs(start);
+				return result;
+			}));
 		}
 	}
 
-private:
-	std::unordered_map<std::string, ModelPtr> cache;
-	std::future<ModelPtr> asyncFuture;
-	std::queue<std::string> asyncQueue;
-};
+	// ˳ϴԤһ֡
+	for (size_t i = 0; i < job.meshFutures.size() && uploadBudget > 0; i++) {
+		if (job.meshTaken[i] || !isReady(job.meshFutures[i])) continue;
+		MeshResult result = job.meshFutures[i].get();
+		job.meshTaken[i] = true;
+		progress.meshesProcessed++;
+		progress.processMs += result.ms;
+		const MeshOptimizer::Stats& stats = result.mesh->getOptimizeStats();
+		int triangles = progress.triangles + (int)stats.triangleCount;
+		if (triangles > 0) {
+			progress.acmrBefore = (progress.acmrBefore * progress.triangles + stats.acmrBefore * stats.triangleCount) / triangles;
+			progress.acmrAfter = (progress.acmrAfter * progress.triangles + stats.acmrAfter * stats.triangleCount) / triangles;
+		}
+		progress.triangles = triangles;
+		progress.verticesBefore += (int)stats.vertexCountBefore;
+		progress.verticesAfter += (int)stats.vertexCountAfter;
+		Clock::time_point start = Clock::now();
+		job.model->setMesh(i, result.mesh);
+		progress.uploadMs += elapsedMs(start);
+		progress.meshesUploaded++;
+		size_t bytes = result.mesh->vertices.size() * sizeof(Vertex) + result.mesh->indices.size() * sizeof(GLuint);
+		uploadBudget = bytes < uploadBudget ? uploadBudget - bytes : 0;
+	}
+	if (progress.meshesUploaded < progress.meshCount) return false;
+
+	if (!job.saveFuture.valid()) {
+		Clock::time_point start = Clock::now();
+		bool initialized = job.model->initGLResources();
+		progress.uploadMs += elapsedMs(start);
+		if (!initialized) {
+			progress.stage = Stage::FAILED;
+			return true;
+		}
+		if (progress.cooked) {
+			cache[progress.path] = job.model;
+			progress.stage = Stage::DONE;
+			return true;
+		}
+		// дʱȡڵ㣬޸Ľڵ㣬д֮ŷ뻺
+		ModelPtr model = job.model;
+		job.saveFuture = pool.submit([model]() { return ModelCache::save(*model); });
+	}
+	if (!isReady(job.saveFuture)) return false;
+	if (!job.saveFuture.get()) {
+		std::cerr << "Failed to write model cache: " << progress.path << std::endl;
+	}
+	cache[progress.path] = job.model;
+	progress.stage = Stage::DONE;
+	return true;
+}
+
+void ModelLoader::update() {
+	size_t uploadBudget = MESH_UPLOAD_BUDGET;
+	for (size_t i = 0; i < jobs.size();) {
+		if (!updateJob(*jobs[i], uploadBudget)) {
+			i++;
+			continue;
+		}
+		jobs[i]->progress.totalMs = elapsedMs(jobs[i]->start);
+		history.push_front(jobs[i]->progress);
+		if (history.size() > HISTORY_SIZE) {
+			history.pop_back();
+		}
+		jobs.erase(jobs.begin() + i);
+	}
+}
 
 class ShaderLoader{
 public:
@@ -101,6 +280,12 @@ public:
 		}
 	}
 
+	void registerComputeShader(const std::string& key, const char* comp) {
+		if (!isLoaded(key)) {
+			cache[key] = std::make_shared<Shader>(comp);
+		}
+	}
+
 private:
 	std::unordered_map<std::string, ShaderPtr> cache;
 };
@@ -112,14 +297,14 @@ public:
 	void addObject(GameObjectPtr obj) {
 		if (!obj) return;
 		objects.push_back(obj);
+		proxies.add(obj);
 		updateLightCount(obj, 1);
 	}
 
 	void removeObject(GameObjectPtr obj) {
 		auto it = std::find(objects.begin(), objects.end(), obj);
 		if (it != objects.end()) {
-			updateLightCount(*it, -1);
-			objects.erase(it);
+			removeObjectByIndex(it - objects.begin());
 		}
 	}
 
@@ -127,7 +312,15 @@ public:
 		if (idx < objects.size()) {
 			updateLightCount(objects[idx], -1);
 			objects.erase(objects.begin() + idx);
+			proxies.removeAt(idx);
+		}
+	}
+
+	void clear() {
+		while (!objects.empty()) {
+			removeObjectByIndex(objects.size() - 1);
 		}
+		removalQueue = {};
 	}
 
 	void queueRemoval(size_t idx) {
@@ -166,8 +359,12 @@ public:
 	int getDirectionLightCount() const { return directionLightCount; }
 	int getSpotLightCount() const { return spotLightCount; }
 
+	void updateProxies() { proxies.update(); }
+	const RenderProxyStore& getProxies() const { return proxies; }
+
 private:
 	std::vector<GameObjectPtr> objects;
+	RenderProxyStore proxies;
 	std::queue<size_t> removalQueue;
 	int pointLightCount = 0;
 	int directionLightCount = 0;
@@ -202,17 +399,28 @@ public:
 		shaderLoader.registerShader("default", "data/shader/test.vert", "data/shader/test.frag");
 		shaderLoader.registerShader("skybox", "data/shader/skybox.vert", "data/shader/skybox.frag");
 		shaderLoader.registerShader("depth", "data/shader/depth.vert", "data/shader/depth.frag");
+		shaderLoader.registerShader("depthPrepass", "data/shader/depthPrepass.vert", "data/shader/depth.frag");
 		shaderLoader.registerShader("depthCube", "data/shader/depthCube.vert", "data/shader/depthCube.geom", "data/shader/depthCube.frag");
 		shaderLoader.registerShader("screenQuad", "data/shader/screenQuad.vert", "data/shader/screenQuad.frag");
 		shaderLoader.registerShader("lightCube", "data/shader/lightCube.vert", "data/shader/lightCube.frag");
 		shaderLoader.registerShader("gaussianBlur", "data/shader/gaussianBlur.vert", "data/shader/gaussianBlur.frag");
 		shaderLoader.registerShader("bone", "data/shader/bone.vert", "data/shader/bone.frag");
 		shaderLoader.registerShader("volume", "data/shader/volume.vert", "data/shader/volume.frag");
+		shaderLoader.registerComputeShader("meshletCull", "data/shader/meshletCull.comp");
+		shaderLoader.registerComputeShader("hiZBuild", "data/shader/hiZBuild.comp");
+	}
+
+	// GL֮ǰãʱҪ黹Ͳʱ
+	void shutDown() {
+		sceneManager.clear();
+		modelLoader.clear();
 	}
 
 	void update() {
 		modelLoader.update();
+		TextureCache::getInstance().update((size_t)(RenderSettings::getInstance().textureUploadBudgetMB * 1048576.0f));
 		sceneManager.processRemovals();
+		sceneManager.updateProxies();
 	}
 
 	void queueModelLoad(const std::string& path) {
@@ -223,6 +431,14 @@ public:
 		return modelLoader.get(key);
 	}
 
+	std::vector<ModelLoader::Progress> getModelLoadProgress() const {
+		return modelLoader.getProgress();
+	}
+
+	int getPendingModelLoads() const {
+		return modelLoader.getPendingCount();
+	}
+
 	std::vector<ModelPtr> getAllModels() const {
 		return modelLoader.getAllLoadedModels();
 	}
@@ -251,6 +467,10 @@ public:
 		return sceneManager.getObjectCount();
 	}
 
+	const RenderProxyStore& getRenderProxies() const {
+		return sceneManager.getProxies();
+	}
+
 	int getPointLightCount() const { return sceneManager.getPointLightCount(); }
 	int getDirectionLightCount() const { return sceneManager.getDirectionLightCount(); }
 	int getSpotLightCount() const { return sceneManager.getSpotLightCount(); }
@@ -2,7 +2,7 @@
 #define WINDOWSYSTEM_HPP
 #pragma once
 
-#include "../Input.hpp"
+#include "../input.hpp"
 #include <iostream>
 #include <GLFW/glfw3.h>
 
@@ -11,6 +11,8 @@ public:
 	WindowSystem() = default;
 	~WindowSystem() = default;
 	void init(int width, int height);
+	// ɼڣcontextApiΪGLFW_EGL_CONTEXT_API/GLFW_OSMESA_CONTEXT_APIʱûʾGPUĻ
+	void initHeadless(int width, int height, int contextApi);
 	void swapBuffers();
 	void update();
 	GLFWwindow* getWindow();
@@ -44,6 +46,29 @@ void WindowSystem::init(int width, int height) {
 	connectInputToWindow(window);
 }
 
+void WindowSystem::initHeadless(int width, int height, int contextApi) {
+	// ֧nullƽ̨ʱκʾֻ
+	if (contextApi != GLFW_NATIVE_CONTEXT_API && glfwPlatformSupported(GLFW_PLATFORM_NULL)) {
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+	}
+	if (!glfwInit()) {
+		std::cerr << "Failed to initialize GLFW" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+	glfwWindowHint(GLFW_CONTEXT_CREATION_API, contextApi);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	window = glfwCreateWindow(width, height, "TinyOpenglRenderer", NULL, NULL);
+	if (!window) {
+		std::cerr << "Failed to create headless context" << std::endl;
+		glfwTerminate();
+		exit(EXIT_FAILURE);
+	}
+	glfwMakeContextCurrent(window);
+	setVsync(false);
+}
+
 void WindowSystem::swapBuffers() {
 	glfwSwapBuffers(window);
 }
@@ -0,0 +1,219 @@
+#ifndef DEPTHPYRAMID_HPP
+#define DEPTHPYRAMID_HPP
+#pragma once
+
+#include "glState.hpp"
+#include "shader.hpp"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// һ֡ȵֵ(Hi-Z)0Ȼһ֮ÿȡһ2x2еֵ
+// ߶һ/вһtexelpڵLmin(p >> L, ߴ - 1)
+// ΧȱȸȻԶʱͱȫס
+// GPUֱӲ(meshlet޳)CPUͨPBO첽ؽСһGPUɺʹã
+class DepthPyramid {
+public:
+	// CPUؿȲֵĵһ
+	static const int READBACK_WIDTH = 128;
+
+	DepthPyramid() = default;
+	void init();
+	void destroy();
+	// viewProjȾʱľ
+	void build(const ShaderPtr& buildShader, GLuint depthTexture, int width, int height, const glm::mat4& viewProj);
+	// ÿ֡޳֮ǰãȡѾɵĶأûʱʹ֮ǰĽ
+	void fetchReadback();
+	// رڵ޳н¿ʱõܾǰ
+	void reset();
+
+	bool isValid() const { return valid; }
+	GLuint getTexture() const { return texture; }
+	glm::vec2 getSize() const { return glm::vec2((float)width, (float)height); }
+	const glm::mat4& getViewProj() const { return viewProj; }
+	// ռAABBǷ񱻶صȫסûжؽʱfalse
+	bool isOccluded(const glm::vec3& center, const glm::vec3& extent) const;
+private:
+	struct Readback {
+		GLuint pbo = 0;
+		GLsizeiptr capacity = 0;
+		GLsync fence = 0;
+		glm::mat4 viewProj = glm::mat4(1.0f);
+		int level = 0, width = 0, height = 0, levelWidth = 0, levelHeight = 0;
+	};
+
+	GLuint texture = 0;
+	int width = 0, height = 0, levels = 0;
+	glm::mat4 viewProj = glm::mat4(1.0f);
+	bool valid = false;
+
+	Readback readbacks[2];
+	int nextReadback = 0;
+	// һɵĶ
+	std::vector<float> cpuDepth;
+	glm::mat4 cpuViewProj = glm::mat4(1.0f);
+	int cpuLevel = 0, cpuWidth = 0, cpuHeight = 0, cpuLevelWidth = 0, cpuLevelHeight = 0;
+
+	void allocate(int width, int height);
+	void requestReadback();
+};
+
+void DepthPyramid::init() {
+	for (Readback& readback : readbacks) {
+		glGenBuffers(1, &readback.pbo);
+	}
+}
+
+void DepthPyramid::destroy() {
+	reset();
+	for (Readback& readback : readbacks) {
+		glDeleteBuffers(1, &readback.pbo);
+		readback.pbo = 0;
+		readback.capacity = 0;
+	}
+	if (texture) {
+		glDeleteTextures(1, &texture);
+		texture = 0;
+	}
+}
+
+void DepthPyramid::reset() {
+	valid = false;
+	cpuDepth.clear();
+	for (Readback& readback : readbacks) {
+		if (readback.fence) {
+			glDeleteSync(readback.fence);
+			readback.fence = 0;
+		}
+	}
+}
+
+void DepthPyramid::allocate(int width, int height) {
+	if (texture) {
+		glDeleteTextures(1, &texture);
+	}
+	this->width = width;
+	this->height = height;
+	levels = 1;
+	while ((std::max(width, height) >> levels) > 0) levels++;
+	// 洢ɱ䣬ߴ仯ʱ´texelFetchˣҪ
+	glGenTextures(1, &texture);
+	GLState::getInstance().bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, texture);
+	glTexStorage2D(GL_TEXTURE_2D, levels, GL_R32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void DepthPyramid::build(const ShaderPtr& buildShader, GLuint depthTexture, int width, int height, const glm::mat4& viewProj) {
+	if (width <= 0 || height <= 0) return;
+	if (width != this->width || height != this->height || !texture) {
+		allocate(width, height);
+		cpuDepth.clear();
+	}
+	GLState::getInstance().bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, depthTexture);
+	buildShader->use();
+	buildShader->setInt("depthMap", 0);
+	for (int level = 0; level < levels; level++) {
+		int levelWidth = std::max(1, width >> level);
+		int levelHeight = std::max(1, height >> level);
+		if (level > 0) {
+			glBindImageTexture(0, texture, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		}
+		glBindImageTexture(1, texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		buildShader->setBool("firstLevel", level == 0);
+		glDispatchCompute((levelWidth + 7) / 8, (levelHeight + 7) / 8, 1);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+	this->viewProj = viewProj;
+	valid = true;
+	requestReadback();
+}
+
+void DepthPyramid::requestReadback() {
+	Readback& readback = readbacks[nextReadback];
+	// һλûбȡ˵GPU֡ζ
+	if (readback.fence) return;
+	int level = 0;
+	while (level + 1 < levels && (width >> level) > READBACK_WIDTH) level++;
+	readback.level = level;
+	readback.width = width;
+	readback.height = height;
+	readback.levelWidth = std::max(1, width >> level);
+	readback.levelHeight = std::max(1, height >> level);
+	readback.viewProj = viewProj;
+	GLsizeiptr size = (GLsizeiptr)readback.levelWidth * readback.levelHeight * sizeof(float);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+	if (size > readback.capacity) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		readback.capacity = size;
+	}
+	GLState::getInstance().bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, texture);
+	glGetTexImage(GL_TEXTURE_2D, level, GL_RED, GL_FLOAT, (void*)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	nextReadback = (nextReadback + 1) % 2;
+}
+
+void DepthPyramid::fetchReadback() {
+	// ӽһοʼζʱµĽ
+	for (int i = 0; i < 2; i++) {
+		Readback& readback = readbacks[(nextReadback + i) % 2];
+		if (!readback.fence) continue;
+		GLenum result = glClientWaitSync(readback.fence, 0, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) continue;
+		glDeleteSync(readback.fence);
+		readback.fence = 0;
+		size_t count = (size_t)readback.levelWidth * readback.levelHeight;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+		const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, count * sizeof(float), GL_MAP_READ_BIT);
+		if (mapped) {
+			cpuDepth.resize(count);
+			std::memcpy(cpuDepth.data(), mapped, count * sizeof(float));
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			cpuViewProj = readback.viewProj;
+			cpuLevel = readback.level;
+			cpuWidth = readback.width;
+			cpuHeight = readback.height;
+			cpuLevelWidth = readback.levelWidth;
+			cpuLevelHeight = readback.levelHeight;
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+}
+
+bool DepthPyramid::isOccluded(const glm::vec3& center, const glm::vec3& extent) const {
+	if (cpuDepth.empty()) return false;
+	glm::vec2 minNdc(1.0f), maxNdc(-1.0f);
+	float minDepth = 1.0f;
+	for (int i = 0; i < 8; i++) {
+		glm::vec3 corner = center + extent * glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+		glm::vec4 clip = cpuViewProj * glm::vec4(corner, 1.0f);
+		// нǵڽƽʱͶӰΧɿɼ
+		if (clip.w <= 1e-4f) return false;
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		minNdc = glm::min(minNdc, glm::vec2(ndc));
+		maxNdc = glm::max(maxNdc, glm::vec2(ndc));
+		minDepth = std::min(minDepth, ndc.z * 0.5f + 0.5f);
+	}
+	// ȫĻĲֽ׶޳
+	if (maxNdc.x < -1.0f || maxNdc.y < -1.0f || minNdc.x > 1.0f || minNdc.y > 1.0f) return false;
+	glm::vec2 minPixel = (glm::clamp(minNdc, -1.0f, 1.0f) * 0.5f + 0.5f) * glm::vec2((float)cpuWidth, (float)cpuHeight);
+	glm::vec2 maxPixel = (glm::clamp(maxNdc, -1.0f, 1.0f) * 0.5f + 0.5f) * glm::vec2((float)cpuWidth, (float)cpuHeight);
+	int x0 = std::min(std::min((int)minPixel.x, cpuWidth - 1) >> cpuLevel, cpuLevelWidth - 1);
+	int y0 = std::min(std::min((int)minPixel.y, cpuHeight - 1) >> cpuLevel, cpuLevelHeight - 1);
+	int x1 = std::min(std::min((int)maxPixel.x, cpuWidth - 1) >> cpuLevel, cpuLevelWidth - 1);
+	int y1 = std::min(std::min((int)maxPixel.y, cpuHeight - 1) >> cpuLevel, cpuLevelHeight - 1);
+	for (int y = y0; y <= y1; y++) {
+		for (int x = x0; x <= x1; x++) {
+			if (cpuDepth[(size_t)y * cpuLevelWidth + x] >= minDepth) return false;
+		}
+	}
+	return true;
+}
+
+#endif // !DEPTHPYRAMID_HPP
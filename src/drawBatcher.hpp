@@ -0,0 +1,288 @@
+#ifndef DRAWBATCHER_HPP
+#define DRAWBATCHER_HPP
+#pragma once
+
+#include "material.hpp"
+#include "mesh.hpp"
+#include "meshArena.hpp"
+#include "meshletCuller.hpp"
+#include "shader.hpp"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// ռһpassо̬Ļƣÿ64λ
+// ͬһͬһʵĻڣϲһʵٰʷ飬ÿύһμӻ
+// ģ;дSSBOÿʵζȡʵе(±, ʱ)(location 7, 8)
+// ѽMaterialTableĲʹһ飬ͬʵͬһҲܺϲһ
+// ͬʽڲͬVAOУٰʽ
+// meshlet޳ʹLOD0Ĵ񽻸MeshletCullerGPU޳ͻ
+class DrawBatcher {
+public:
+	enum class Pass {
+		DIRECTION_SHADOW,
+		POINT_SHADOW,
+		DEPTH_PREPASS,
+		MAIN
+	};
+
+	DrawBatcher() = default;
+	void init(GLuint modelMatrixBinding);
+	// ֻMAIN pass󶨲ʣpassֻϲ
+	// maxDistance0ʱͬһʵviewPositionľӽԶ
+	void begin(Pass pass, const ShaderPtr& shader, const glm::vec3& viewPosition = glm::vec3(0.0f), float maxDistance = 0.0f);
+	// ؾ±꣬ͬһ
+	unsigned int addTransform(const glm::mat4& model);
+	// ֮addʹõLODûô༶ʱֵһ
+	void setLod(int level) { lodLevel = level; }
+	// begin֮ãpassminTrianglesΪmeshlet޳
+	void enableMeshletCulling(const ShaderPtr& cullShader, const Frustum& frustum, const glm::vec3& cameraPos, bool coneCulling, int minTriangles,
+		const DepthPyramid* occlusion = nullptr);
+	// һmeshlet޳passͬʱãֱػһε޳passȫһ
+	void reuseMeshletCulling(int minTriangles);
+	// materialΪʱʹĬϲ
+	void add(const Mesh& mesh, Material* material, unsigned int transformIndex);
+	void submit();
+
+	// Ӹߵ: pass(4λ) | shader(8λ) | (16λ) | ʽ(2λ) + LOD(2λ) + (16λ) | (16λ)
+	// λֻͬһͬһLODʵ֮˳
+	static uint64_t makeSortKey(unsigned int pass, unsigned int shader, unsigned int material, unsigned int mesh, unsigned int depth);
+
+	void resetStats() { drawCalls = 0; commandCount = 0; batchedMeshes = 0; triangles = 0; fullDetailTriangles = 0; }
+	int getDrawCalls() const { return drawCalls; }
+	int getTriangles() const { return triangles; }
+	int getFullDetailTriangles() const { return fullDetailTriangles; }
+	int getCommandCount() const { return commandCount; }
+	int getBatchedMeshes() const { return batchedMeshes; }
+	const MeshletCuller& getMeshletCuller() const { return meshletCuller; }
+private:
+	struct DrawItem {
+		Material* material; // ҪʰʱΪ
+		MeshArena::Range range;
+		unsigned int transformIndex;
+		unsigned int materialIndex; // MaterialTableеı
+	};
+	GLuint modelMatrixBuffer = 0, instanceBuffer = 0, indirectBuffer = 0;
+	GLuint modelMatrixBinding = 6;
+
+	Pass pass = Pass::MAIN;
+	ShaderPtr shader;
+	bool bindMaterials = true;
+	glm::vec3 viewPosition = glm::vec3(0.0f);
+	float maxDistance = 0.0f;
+	int lodLevel = 0;
+	MeshletCuller meshletCuller;
+	bool meshletCulling = false;
+	bool reuseMeshlets = false;
+	int meshletMinTriangles = 0;
+
+	std::vector<glm::mat4> modelMatrices;
+	std::vector<unsigned int> transformDepths;
+	std::vector<DrawItem> items;
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> order, scratch;
+	std::vector<glm::uvec2> instanceData;
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<Material*> commandMaterials;
+	std::vector<VertexLayout> commandLayouts;
+	int drawCalls = 0, commandCount = 0, batchedMeshes = 0;
+	int triangles = 0, fullDetailTriangles = 0;
+
+	void radixSort();
+};
+
+void DrawBatcher::init(GLuint modelMatrixBinding) {
+	this->modelMatrixBinding = modelMatrixBinding;
+	glGenBuffers(1, &modelMatrixBuffer);
+	glGenBuffers(1, &instanceBuffer);
+	glGenBuffers(1, &indirectBuffer);
+	meshletCuller.init();
+}
+
+void DrawBatcher::begin(Pass pass, const ShaderPtr& shader, const glm::vec3& viewPosition, float maxDistance) {
+	this->pass = pass;
+	this->shader = shader;
+	this->bindMaterials = pass == Pass::MAIN;
+	this->viewPosition = viewPosition;
+	this->maxDistance = maxDistance;
+	this->lodLevel = 0;
+	this->meshletCulling = false;
+	this->reuseMeshlets = false;
+	modelMatrices.clear();
+	transformDepths.clear();
+	items.clear();
+	keys.clear();
+}
+
+void DrawBatcher::enableMeshletCulling(const ShaderPtr& cullShader, const Frustum& frustum, const glm::vec3& cameraPos, bool coneCulling, int minTriangles,
+	const DepthPyramid* occlusion) {
+	meshletCulling = true;
+	meshletMinTriangles = minTriangles;
+	meshletCuller.begin(cullShader, frustum, cameraPos, coneCulling, occlusion);
+}
+
+void DrawBatcher::reuseMeshletCulling(int minTriangles) {
+	meshletCulling = true;
+	reuseMeshlets = true;
+	meshletMinTriangles = minTriangles;
+}
+
+unsigned int DrawBatcher::addTransform(const glm::mat4& model) {
+	unsigned int depth = 0;
+	if (maxDistance > 0.0f) {
+		float distance = glm::length(glm::vec3(model[3]) - viewPosition);
+		depth = (unsigned int)(std::min(distance / maxDistance, 1.0f) * 0xFFFF);
+	}
+	modelMatrices.push_back(model);
+	transformDepths.push_back(depth);
+	return (unsigned int)modelMatrices.size() - 1;
+}
+
+void DrawBatcher::add(const Mesh& mesh, Material* material, unsigned int transformIndex) {
+	MeshArena::Range range = mesh.getRange().getLod(lodLevel);
+	triangles += range.indexCount / 3;
+	fullDetailTriangles += mesh.getRange().indexCount / 3;
+	// ĬϲMaterialTableе0ţĲŶΪ0ֻʰ󶨵Ĳʷֿ
+	unsigned int materialIndex = 0;
+	if (material && !material->updateReady()) {
+		// ڼأĬϲռλ
+		material = nullptr;
+	}
+	else if (material && material->getTableIndex() >= 0) {
+		materialIndex = (unsigned int)material->getTableIndex();
+		material = nullptr;
+	}
+	// meshletֻLOD0ʰ󶨵ߺ
+	// ʱpassҲҪԤ޳Ľᱻɫpassֱػ
+	if (meshletCulling && !material && range.meshletCount > 0 && range.firstIndex == mesh.getRange().firstIndex
+		&& range.indexCount / 3 >= (GLuint)meshletMinTriangles) {
+		if (!reuseMeshlets) {
+			meshletCuller.add(range, transformIndex, materialIndex);
+		}
+		return;
+	}
+	if (!bindMaterials) {
+		material = nullptr;
+	}
+	unsigned int materialId = material ? material->getSortId() + 1 : 0;
+	// LODһţLODҲŽֶΣͬһʵںϲ
+	static_assert(MAX_LODS <= 4, "LOD level must fit in 2 bits of the sort key");
+	unsigned int lod = (unsigned int)std::clamp(lodLevel, 0, range.lodCount - 1);
+	unsigned int meshId = ((unsigned int)range.layout << 18) | (lod << 16) | (range.id & 0xFFFF);
+	keys.push_back(makeSortKey((unsigned int)pass, shader->getSortId(), materialId, meshId, transformDepths[transformIndex]));
+	items.push_back({ material, range, transformIndex, materialIndex });
+}
+
+uint64_t DrawBatcher::makeSortKey(unsigned int pass, unsigned int shader, unsigned int material, unsigned int mesh, unsigned int depth) {
+	return ((uint64_t)(pass & 0xF) << 60) | ((uint64_t)(shader & 0xFF) << 52) | ((uint64_t)(material & 0xFFFF) << 36)
+		| ((uint64_t)(mesh & 0xFFFFF) << 16) | (uint64_t)(depth & 0xFFFF);
+}
+
+void DrawBatcher::radixSort() {
+	// ֽڵLSD򣬽ȶмĳһֽڶͬʱһ(passshader)
+	size_t n = keys.size();
+	order.resize(n);
+	scratch.resize(n);
+	for (size_t i = 0; i < n; i++) {
+		order[i] = (uint32_t)i;
+	}
+	size_t counts[8][256] = {};
+	for (uint64_t key : keys) {
+		for (int d = 0; d < 8; d++) {
+			counts[d][(key >> (d * 8)) & 0xFF]++;
+		}
+	}
+	for (int d = 0; d < 8; d++) {
+		if (counts[d][(keys[0] >> (d * 8)) & 0xFF] == n) continue;
+		size_t offsets[256];
+		size_t sum = 0;
+		for (int b = 0; b < 256; b++) {
+			offsets[b] = sum;
+			sum += counts[d][b];
+		}
+		for (uint32_t index : order) {
+			scratch[offsets[(keys[index] >> (d * 8)) & 0xFF]++] = index;
+		}
+		order.swap(scratch);
+	}
+}
+
+void DrawBatcher::submit() {
+	bool culledMeshes = meshletCulling && !meshletCuller.empty();
+	if (items.empty() && !culledMeshes) return;
+	// ÿpassݲֱͬglBufferData·䣬ȴһύ
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, modelMatrixBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, modelMatrices.size() * sizeof(glm::mat4), modelMatrices.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, modelMatrixBinding, modelMatrixBuffer);
+	if (culledMeshes) {
+		drawCalls += reuseMeshlets ? meshletCuller.redraw(shader) : meshletCuller.submit(shader);
+		batchedMeshes += meshletCuller.getInstanceCount();
+	}
+	if (items.empty()) {
+		shader->setBool("useDrawData", false);
+		return;
+	}
+	radixSort();
+	instanceData.resize(items.size());
+	commands.clear();
+	commandMaterials.clear();
+	commandLayouts.clear();
+	for (size_t i = 0; i < order.size(); i++) {
+		const DrawItem& item = items[order[i]];
+		instanceData[i] = glm::uvec2(item.transformIndex, item.materialIndex);
+		bool sameCommand = !commands.empty() && commandMaterials.back() == item.material && commandLayouts.back() == item.range.layout
+			&& commands.back().firstIndex == item.range.firstIndex && commands.back().baseVertex == item.range.baseVertex
+			&& commands.back().count == item.range.indexCount;
+		if (sameCommand) {
+			commands.back().instanceCount++;
+			continue;
+		}
+		DrawElementsIndirectCommand command;
+		command.count = item.range.indexCount;
+		command.instanceCount = 1;
+		command.firstIndex = item.range.firstIndex;
+		command.baseVertex = item.range.baseVertex;
+		command.baseInstance = (GLuint)i;
+		commands.push_back(command);
+		commandMaterials.push_back(item.material);
+		commandLayouts.push_back(item.range.layout);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(glm::uvec2), instanceData.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STREAM_DRAW);
+
+	shader->use();
+	shader->setBool("useDrawData", true);
+	size_t groupBegin = 0;
+	while (groupBegin < commands.size()) {
+		size_t groupEnd = groupBegin + 1;
+		while (groupEnd < commands.size() && commandMaterials[groupEnd] == commandMaterials[groupBegin]
+			&& commandLayouts[groupEnd] == commandLayouts[groupBegin]) groupEnd++;
+		MeshArena::get(commandLayouts[groupBegin]).setInstanceBuffer(instanceBuffer);
+		if (bindMaterials) {
+			if (commandMaterials[groupBegin]) {
+				commandMaterials[groupBegin]->bind(shader);
+			}
+			else {
+				// ĲʺĬϲʶӲSSBOȡ
+				shader->setBool("useMaterialTable", true);
+			}
+		}
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(groupBegin * sizeof(DrawElementsIndirectCommand)),
+			(GLsizei)(groupEnd - groupBegin), 0);
+		drawCalls++;
+		groupBegin = groupEnd;
+	}
+	commandCount += (int)commands.size();
+	batchedMeshes += (int)items.size();
+	shader->setBool("useDrawData", false);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+#endif // !DRAWBATCHER_HPP
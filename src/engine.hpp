@@ -3,17 +3,26 @@
 #pragma once
 
 #include "camera.hpp"
+#include "headless.hpp"
 #include "core/windowSystem.hpp"
 #include "core/guiSystem.hpp"
 #include "core/resourceManager.hpp"
 #include "core/renderSystem.hpp"
+#include <glm/gtc/constants.hpp>
 #include <GLFW/glfw3.h>
+#include <cfloat>
+#include <chrono>
+#include <filesystem>
+#include <thread>
 
 class Engine {
 public:
 	static Engine& getInstance();
 	void init();
 	void run();
+	// GuiSystem·֡ǹ̶ģ͸ֶκʱ
+	void initHeadless(const HeadlessConfig& config);
+	bool runHeadless();
 private:
 	Engine() = default;
 	~Engine() = default;
@@ -21,7 +30,10 @@ private:
 	WindowSystem windowSystem;
 	RenderSystem renderSystem;
 	GuiSystem guiSystem;
+	HeadlessConfig headlessConfig;
 	double getDeltaTime();
+	void buildHeadlessScene();
+	void waitForLoads();
 };
 
 Engine& Engine::getInstance() {
@@ -33,27 +45,215 @@ void Engine::init() {
 	Input::getInstance().init();
 	windowSystem.init(1280, 720);
 	renderSystem.init();
+	Profiler::getInstance().init();
 	ResourceManager::getInstance().init();
 	guiSystem.init(windowSystem.getWindow());
 }
 
 void Engine::run() {
+	Profiler& profiler = Profiler::getInstance();
 	while (!windowSystem.getShouldClose()) {
+		profiler.beginFrame();
 		double deltaTime = getDeltaTime();
 		Input::getInstance().update();
 		windowSystem.update();
+		int scope = profiler.begin("ResourceManager::update");
 		ResourceManager::getInstance().update();
+		profiler.end(scope);
 		camera.update(deltaTime);
+		scope = profiler.begin("RenderSystem::update");
 		renderSystem.update(deltaTime);
+		profiler.end(scope);
 		guiSystem.beginFrame();
 		renderSystem.render(camera);
-		guiSystem.render(deltaTime);
+		scope = profiler.begin("GuiSystem::render", true);
+		guiSystem.render(deltaTime, camera);
+		profiler.end(scope);
+		scope = profiler.begin("swapBuffers");
 		windowSystem.swapBuffers();
+		profiler.end(scope);
+		profiler.endFrame();
 	}
 	guiSystem.shutDown();
+	ResourceManager::getInstance().shutDown();
 	windowSystem.shutDown();
 }
 
+void Engine::initHeadless(const HeadlessConfig& config) {
+	headlessConfig = config;
+	Input::getInstance().init();
+	Input::getInstance().onWindowResized(config.width, config.height);
+	// ûвȾ
+	GuiSystem::leftSideBarWidth = 0.0f;
+	GuiSystem::rightSideBarWidth = 0.0f;
+	GuiSystem::bottomSideBarHeight = 0.0f;
+	windowSystem.initHeadless(config.width, config.height, config.contextApi);
+	renderSystem.init();
+	renderSystem.enableOffscreenOutput();
+	Profiler::getInstance().init();
+	ResourceManager::getInstance().init();
+	buildHeadlessScene();
+}
+
+void Engine::buildHeadlessScene() {
+	ResourceManager& resources = ResourceManager::getInstance();
+
+	auto addStaticMesh = [&](const char* name, MeshPtr mesh, const glm::vec3& translate, const glm::vec3& scale) {
+		auto gameObject = std::make_shared<StaticMeshObject>(name);
+		gameObject->addComponent<Transform>();
+		gameObject->getComponent<Transform>()->translate = translate;
+		gameObject->getComponent<Transform>()->scale = scale;
+		gameObject->addComponent<StaticMeshComponent>();
+		gameObject->getComponent<StaticMeshComponent>()->setMesh(mesh);
+		gameObject->addComponent<DynamicMaterialComponent>();
+		resources.addGameObject(gameObject);
+	};
+	addStaticMesh("Plane", MeshGenerator::generatePlane(), glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(20.0f, 1.0f, 20.0f));
+	// 5x5彻УһȦʱڵ
+	for (int z = -2; z <= 2; z++) {
+		for (int x = -2; x <= 2; x++) {
+			bool cube = ((x + z) & 1) == 0;
+			addStaticMesh(cube ? "Cube" : "Sphere", cube ? MeshGenerator::generateCube() : MeshGenerator::generateSphere(),
+				glm::vec3(x * 2.5f, 0.0f, z * 2.5f), glm::vec3(1.0f));
+		}
+	}
+
+	auto directionLight = std::make_shared<DirectionLightObject>("DirectionLight");
+	directionLight->addComponent<Transform>();
+	directionLight->getComponent<Transform>()->rotate = glm::vec3(-50.0f, 30.0f, 0.0f);
+	directionLight->addComponent<DirectionLightComponent>();
+	directionLight->addComponent<ShadowCaster2D>();
+	resources.addGameObject(directionLight);
+
+	const glm::vec3 pointLightPositions[] = { glm::vec3(-4.0f, 2.0f, -4.0f), glm::vec3(4.0f, 2.0f, 4.0f) };
+	const glm::vec3 pointLightColors[] = { glm::vec3(1.0f, 0.6f, 0.3f), glm::vec3(0.3f, 0.6f, 1.0f) };
+	for (int i = 0; i < 2; i++) {
+		auto pointLight = std::make_shared<PointLightObject>("PointLight");
+		pointLight->addComponent<Transform>();
+		pointLight->getComponent<Transform>()->translate = pointLightPositions[i];
+		pointLight->getComponent<Transform>()->scale = glm::vec3(0.2f);
+		pointLight->addComponent<PointLightComponent>();
+		pointLight->getComponent<PointLightComponent>()->color = pointLightColors[i];
+		pointLight->addComponent<ShadowCasterCube>();
+		pointLight->addComponent<StaticMeshComponent>();
+		pointLight->getComponent<StaticMeshComponent>()->setMesh(MeshGenerator::generateCube());
+		resources.addGameObject(pointLight);
+	}
+
+	for (const std::string& path : headlessConfig.models) {
+		resources.queueModelLoad(path);
+	}
+	waitForLoads();
+	for (const std::string& path : headlessConfig.models) {
+		ModelPtr model = resources.getModel(path);
+		if (!model) {
+			std::cerr << "Failed to load model: " << path << std::endl;
+			continue;
+		}
+		auto gameObject = std::make_shared<RenderObject>(model->getName());
+		gameObject->addComponent<Transform>();
+		gameObject->addComponent<RenderComponent>();
+		gameObject->getComponent<RenderComponent>()->setModel(model);
+		gameObject->addComponent<SkeletonViewerComponent>(model->getNodes());
+		if (model->getAnimations().size() > 0) {
+			gameObject->addComponent<AnimatorComponent>(gameObject->getComponent<SkeletonViewerComponent>()->getNodes());
+			gameObject->getComponent<AnimatorComponent>()->setAnimation(&model->getAnimations());
+			gameObject->getComponent<AnimatorComponent>()->playAnimation(model->getAnimations()[0].getName());
+			gameObject->getComponent<AnimatorComponent>()->update(0.0);
+		}
+		resources.addGameObject(gameObject);
+	}
+	// ģ͵ڼ볡ſʼϴ
+	waitForLoads();
+}
+
+void Engine::waitForLoads() {
+	// һ֮֡ǰģͺѾϴ治ܼٶӰ
+	ResourceManager& resources = ResourceManager::getInstance();
+	resources.update();
+	while (resources.getPendingModelLoads() > 0 || TextureCache::getInstance().getLoadingCount() > 0) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		resources.update();
+	}
+}
+
+bool Engine::runHeadless() {
+	const HeadlessConfig& config = headlessConfig;
+	std::error_code error;
+	std::filesystem::create_directories(config.outputDir, error);
+	if (error) {
+		std::cerr << "Failed to create output directory: " << config.outputDir << std::endl;
+		ResourceManager::getInstance().shutDown();
+		windowSystem.shutDown();
+		return false;
+	}
+	std::filesystem::path outputDir(config.outputDir);
+
+	// ƳΧתһȦ뾶ΧӽǼ
+	const RenderProxyStore& proxies = ResourceManager::getInstance().getRenderProxies();
+	glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+	for (size_t i = 0; i < proxies.size(); i++) {
+		if (!proxies.hasBounds[i]) continue;
+		boundsMin = glm::min(boundsMin, proxies.worldBounds.center(i) - proxies.worldBounds.extent(i));
+		boundsMax = glm::max(boundsMax, proxies.worldBounds.center(i) + proxies.worldBounds.extent(i));
+	}
+	glm::vec3 target(0.0f);
+	float radius = 10.0f;
+	if (boundsMin.x <= boundsMax.x) {
+		target = (boundsMin + boundsMax) * 0.5f;
+		float boundsRadius = glm::length(boundsMax - boundsMin) * 0.5f;
+		radius = boundsRadius / std::sin(glm::radians(camera.getFov() * 0.5f));
+	}
+	radius = glm::clamp(radius, 2.0f, camera.getFar() * 0.5f);
+
+	Profiler& profiler = Profiler::getInstance();
+	RenderSettings& settings = RenderSettings::getInstance();
+	std::ofstream frameLog(outputDir / "frames.csv", std::ios::trunc);
+	frameLog << "frame,draw_calls,triangles,meshlets_visible,occluded_objects\n";
+	std::vector<unsigned char> pixels;
+	int captured = 0;
+	for (int frame = 0; frame < config.frames; frame++) {
+		profiler.beginFrame();
+		// ̶ȡglfwGetTimeֻ֡й
+		glfwSetTime(frame * config.frameTime);
+		Input::getInstance().update();
+		int scope = profiler.begin("ResourceManager::update");
+		ResourceManager::getInstance().update();
+		profiler.end(scope);
+		float angle = glm::two_pi<float>() * frame / config.frames;
+		glm::vec3 offset(std::cos(angle) * radius, radius * 0.4f, std::sin(angle) * radius);
+		camera.lookAt(target + offset, target);
+		scope = profiler.begin("RenderSystem::update");
+		renderSystem.update(config.frameTime);
+		profiler.end(scope);
+		renderSystem.render(camera);
+		if (config.captureEvery > 0 && frame % config.captureEvery == 0) {
+			scope = profiler.begin("capture");
+			int width = 0, height = 0;
+			char name[32];
+			std::snprintf(name, sizeof(name), "frame_%05d.ppm", frame);
+			if (renderSystem.readOutput(pixels, width, height) && writePPM((outputDir / name).string(), width, height, pixels)) {
+				captured++;
+			}
+			profiler.end(scope);
+		}
+		// ÿ֡GPUɣHi-ZغGPUʱڹ̶֡Ͽã޹
+		glFinish();
+		profiler.endFrame();
+		frameLog << frame << ',' << settings.stats.drawCalls << ',' << settings.stats.triangles << ','
+			<< settings.stats.meshletsVisible << ',' << settings.stats.occludedObjects << '\n';
+	}
+	profiler.flush();
+	bool ok = profiler.exportCsv((outputDir / "timings.csv").string());
+	ok &= profiler.exportChromeTrace((outputDir / "profile_trace.json").string());
+	ok &= (bool)frameLog;
+	std::cout << "Headless: " << config.frames << " frames, " << captured << " captured, GPU dropped "
+		<< profiler.getDroppedFrames() << " frames, output in " << outputDir.string() << std::endl;
+	ResourceManager::getInstance().shutDown();
+	windowSystem.shutDown();
+	return ok;
+}
+
 double Engine::getDeltaTime()
 {
 	static float lastFrame = 0.0f;
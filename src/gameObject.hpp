@@ -3,7 +3,9 @@
 #pragma once
 
 #include "glBuffer.hpp"
+#include "lightBuffer.hpp"
 #include "component.hpp"
+#include "drawBatcher.hpp"
 #include "model.hpp"
 #include "shader.hpp"
 
@@ -22,12 +24,16 @@ public:
 	virtual ~GameObject() = default;
 	std::string getName() { return name; }
 	Type getType() { return type; }
-	virtual void draw(ShaderPtr shader) {}
-	virtual void drawSkeleton(ShaderPtr shader) {}
-	virtual void sendToSSBO(int index, ShaderStorageBuffer ssbo) {}
+	virtual void draw(const ShaderPtr& shader) {}
+	// ԺϲƵβtrueɵߵdraw
+	virtual bool addToBatch(DrawBatcher& batcher) { return false; }
+	virtual void drawSkeleton(const ShaderPtr& shader) {}
+	virtual void packPointLight(GPUPointLight& light) {}
+	virtual void packDirectionLight(GPUDirectionLight& light) {}
+	virtual void packSpotLight(GPUSpotLight& light) {}
 	virtual glm::mat4 getLightMatrices() { return glm::mat4(1.0f); }
 	virtual std::vector<glm::mat4> getLightMatricesCube() { return std::vector<glm::mat4>(); }
-	virtual void useCubeMap(ShaderPtr shader) {}
+	virtual void useCubeMap(const ShaderPtr& shader) {}
 	virtual bool isOnFrustum(Frustum& frustum) { return false; }
 
 	template<typename T, typename... Args>
@@ -76,20 +82,17 @@ public:
 	RenderObject(std::string name) : GameObject(name) {
 		type = GameObject::Type::RENDEROBJECT;
 	}
-	void draw(ShaderPtr shader) override;
-	void drawSkeleton(ShaderPtr shader) override;
+	void draw(const ShaderPtr& shader) override;
+	void drawSkeleton(const ShaderPtr& shader) override;
+	bool addToBatch(DrawBatcher& batcher) override;
 	bool isOnFrustum(Frustum& frustum) override;
 };
 
-void RenderObject::draw(ShaderPtr shader) {
+void RenderObject::draw(const ShaderPtr& shader) {
 	if (auto renderComponent = getComponent<RenderComponent>()) {
 		glm::mat4 model = glm::mat4(1.0f);
 		if (auto transform = getComponent<Transform>()) {
-			model = glm::translate(model, transform->translate);
-			model = glm::rotate(model, glm::radians(transform->rotate.z), glm::vec3(0, 0, 1));
-			model = glm::rotate(model, glm::radians(transform->rotate.y), glm::vec3(0, 1, 0));
-			model = glm::rotate(model, glm::radians(transform->rotate.x), glm::vec3(1, 0, 0));
-			model = glm::scale(model, transform->scale);
+			model = transform->getWorldMatrix();
 			shader.get()->setMat4("model", model);
 		}
 		if (auto animator = getComponent<AnimatorComponent>()) {
@@ -102,15 +105,22 @@ void RenderObject::draw(ShaderPtr shader) {
 	}
 }
 
-void RenderObject::drawSkeleton(ShaderPtr shader) {
+bool RenderObject::addToBatch(DrawBatcher& batcher) {
+	auto renderComponent = getComponent<RenderComponent>();
+	auto transform = getComponent<Transform>();
+	// Ҫ󶨸ԵĹȻ
+	if (!renderComponent || !renderComponent->model || !transform || getComponent<AnimatorComponent>()) {
+		return false;
+	}
+	renderComponent->model->addToBatch(batcher, batcher.addTransform(transform->getWorldMatrix()));
+	return true;
+}
+
+void RenderObject::drawSkeleton(const ShaderPtr& shader) {
 	if (auto renderComponent = getComponent<RenderComponent>()) {
 		glm::mat4 model = glm::mat4(1.0f);
 		if (auto transform = getComponent<Transform>()) {
-			model = glm::translate(model, transform->translate);
-			model = glm::rotate(model, glm::radians(transform->rotate.z), glm::vec3(0, 0, 1));
-			model = glm::rotate(model, glm::radians(transform->rotate.y), glm::vec3(0, 1, 0));
-			model = glm::rotate(model, glm::radians(transform->rotate.x), glm::vec3(1, 0, 0));
-			model = glm::scale(model, transform->scale);
+			model = transform->getWorldMatrix();
 			shader.get()->setMat4("model", model);
 		}
 		if (auto skeletonViewer = getComponent<SkeletonViewerComponent>()) {
@@ -124,11 +134,7 @@ bool RenderObject::isOnFrustum(Frustum& frustum) {
 	if (auto renderComponent = getComponent<RenderComponent>()) {
 		glm::mat4 model = glm::mat4(1.0f);
 		if (auto transform = getComponent<Transform>()) {
-			model = glm::translate(model, transform->translate);
-			model = glm::rotate(model, glm::radians(transform->rotate.z), glm::vec3(0, 0, 1));
-			model = glm::rotate(model, glm::radians(transform->rotate.y), glm::vec3(0, 1, 0));
-			model = glm::rotate(model, glm::radians(transform->rotate.x), glm::vec3(1, 0, 0));
-			model = glm::scale(model, transform->scale);
+			model = transform->getWorldMatrix();
 
 			glm::vec3 minAABB = renderComponent->aabb.min;
 			glm::vec3 maxAABB = renderComponent->aabb.max;
@@ -180,33 +186,30 @@ public:
 	PointLightObject(std::string name) : GameObject(name) {
 		type = GameObject::Type::POINTLIGHTOBJECT;
 	}
-	void sendToSSBO(int index, ShaderStorageBuffer ssbo) override;
+	void packPointLight(GPUPointLight& light) override;
 	std::vector<glm::mat4> getLightMatricesCube() override;
-	void draw(ShaderPtr shader) override;
+	void draw(const ShaderPtr& shader) override;
 	bool isOnFrustum(Frustum& frustum) override;
 
-	static const int glslSize = 48;
 };
 
-void PointLightObject::sendToSSBO(int index, ShaderStorageBuffer ssbo) {
+void PointLightObject::packPointLight(GPUPointLight& light) {
 	auto transform = getComponent<Transform>();
 	auto pointLight = getComponent<PointLightComponent>();
 	auto shadowCaster = getComponent<ShadowCasterCube>();
-	ssbo.bind();
-	ssbo.bufferSubdata(index * glslSize, 12, glm::value_ptr(transform->translate));
-	ssbo.bufferSubdata(index * glslSize + 12, 4, nullptr);
-	ssbo.bufferSubdata(index * glslSize + 16, 12, glm::value_ptr(pointLight->color));
-	ssbo.bufferSubdata(index * glslSize + 28, 4, &pointLight->brightness);
-	ssbo.bufferSubdata(index * glslSize + 32, 4, &pointLight->constant);
-	ssbo.bufferSubdata(index * glslSize + 36, 4, &pointLight->linear);
-	ssbo.bufferSubdata(index * glslSize + 40, 4, &pointLight->quadratic);
-	ssbo.bufferSubdata(index * glslSize + 44, 4, &shadowCaster->farPlane);
-	ssbo.unbind();
+	light.position = transform->getWorldPosition();
+	light.shadowIndex = -1;
+	light.color = pointLight->color;
+	light.brightness = pointLight->brightness;
+	light.constant = pointLight->constant;
+	light.linear = pointLight->linear;
+	light.quadratic = pointLight->quadratic;
+	light.farPlane = shadowCaster->farPlane;
 }
 
 std::vector<glm::mat4> PointLightObject::getLightMatricesCube() {
 	auto transform = getComponent<Transform>();
-	glm::vec3 position = transform->translate;
+	glm::vec3 position = transform->getWorldPosition();
 	auto shadowCaster = getComponent<ShadowCasterCube>();
 	glm::mat4 lightProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, shadowCaster->farPlane);
 	std::vector<glm::mat4> lightViews;
@@ -219,15 +222,11 @@ std::vector<glm::mat4> PointLightObject::getLightMatricesCube() {
 	return lightViews;
 }
 
-void PointLightObject::draw(ShaderPtr shader) {
+void PointLightObject::draw(const ShaderPtr& shader) {
 	if (auto staticMeshComponent = getComponent<StaticMeshComponent>()) {
 		glm::mat4 model = glm::mat4(1.0f);
 		if (auto transform = getComponent<Transform>()) {
-			model = glm::translate(model, transform->translate);
-			model = glm::rotate(model, glm::radians(transform->rotate.z), glm::vec3(0, 0, 1));
-			model = glm::rotate(model, glm::radians(transform->rotate.y), glm::vec3(0, 1, 0));
-			model = glm::rotate(model, glm::radians(transform->rotate.x), glm::vec3(1, 0, 0));
-			model = glm::scale(model, transform->scale);
+			model = transform->getWorldMatrix();
 		}
 		shader->setMat4("model", model);
 		glm::vec3 color = glm::vec3(1.0f, 1.0f, 1.0f);
@@ -248,11 +247,7 @@ bool PointLightObject::isOnFrustum(Frustum& frustum) {
 	if (auto staticMeshComponent = getComponent<StaticMeshComponent>()) {
 		glm::mat4 model = glm::mat4(1.0f);
 		if (auto transform = getComponent<Transform>()) {
-			model = glm::translate(model, transform->translate);
-			model = glm::rotate(model, glm::radians(transform->rotate.z), glm::vec3(0, 0, 1));
-			model = glm::rotate(model, glm::radians(transform->rotate.y), glm::vec3(0, 1, 0));
-			model = glm::rotate(model, glm::radians(transform->rotate.x), glm::vec3(1, 0, 0));
-			model = glm::scale(model, transform->scale);
+			model = transform->getWorldMatrix();
 
 			glm::vec3 minAABB = staticMeshComponent->aabb.min;
 			glm::vec3 maxAABB = staticMeshComponent->aabb.max;
@@ -304,38 +299,23 @@ public:
 	DirectionLightObject(std::string name) : GameObject(name) {
 		type = GameObject::Type::DIRECTIONLIGHTOBJECT;
 	}
-	void sendToSSBO(int index, ShaderStorageBuffer ssbo) override;
+	void packDirectionLight(GPUDirectionLight& light) override;
 	glm::mat4 getLightMatrices() override;
 
-	static const int glslSize = 32;
 private:
 };
 
-void DirectionLightObject::sendToSSBO(int index, ShaderStorageBuffer ssbo) {
+void DirectionLightObject::packDirectionLight(GPUDirectionLight& light) {
 	auto transform = getComponent<Transform>();
 	auto directionLight = getComponent<DirectionLightComponent>();
-	glm::mat4 rotation(1.0);
-	rotation = glm::rotate(rotation, glm::radians(transform->rotate.z), glm::vec3(0, 0, 1));
-	rotation = glm::rotate(rotation, glm::radians(transform->rotate.y), glm::vec3(0, 1, 0));
-	rotation = glm::rotate(rotation, glm::radians(transform->rotate.x), glm::vec3(1, 0, 0));
-	glm::vec3 direction(1.0,0.0,0.0);
-	direction = glm::mat3(rotation) * direction;
-	ssbo.bind();
-	ssbo.bufferSubdata(0, 12, glm::value_ptr(direction));
-	ssbo.bufferSubdata(12, 4, nullptr);
-	ssbo.bufferSubdata(16, 12, glm::value_ptr(directionLight->color));
-	ssbo.bufferSubdata(28, 4, &directionLight->brightness);
-	ssbo.unbind();
+	light.direction = glm::vec4(transform->getWorldDirection(glm::vec3(1.0f, 0.0f, 0.0f)), 0.0f);
+	light.color = directionLight->color;
+	light.brightness = directionLight->brightness;
 }
 
 glm::mat4 DirectionLightObject::getLightMatrices() {
 	auto transform = getComponent<Transform>();
-	glm::mat4 rotation(1.0);
-	rotation = glm::rotate(rotation, glm::radians(transform->rotate.z), glm::vec3(0, 0, 1));
-	rotation = glm::rotate(rotation, glm::radians(transform->rotate.y), glm::vec3(0, 1, 0));
-	rotation = glm::rotate(rotation, glm::radians(transform->rotate.x), glm::vec3(1, 0, 0));
-	glm::vec3 direction(1.0, 0.0, 0.0);
-	direction = glm::mat3(rotation) * direction;
+	glm::vec3 direction = transform->getWorldDirection(glm::vec3(1.0f, 0.0f, 0.0f));
 	glm::mat4 lightProjection = glm::ortho(-100.0f, 100.0f, -100.0f, 100.0f, -100.0f, 100.0f);
 	glm::mat4 lightView = glm::lookAt(-direction, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 	return lightProjection * lightView;
@@ -346,33 +326,19 @@ public:
 	SpotLightObject(std::string name) : GameObject(name) {
 		type = GameObject::Type::SPOTLIGHTOBJECT;
 	}
-	void sendToSSBO(int index, ShaderStorageBuffer ssbo) override;
-
-	static const int glslSize = 64;
+	void packSpotLight(GPUSpotLight& light) override;
 };
 
-void SpotLightObject::sendToSSBO(int index, ShaderStorageBuffer ssbo) {
+void SpotLightObject::packSpotLight(GPUSpotLight& light) {
 	auto transform = getComponent<Transform>();
 	auto spotLight = getComponent<SpotLightComponent>();
-	glm::mat4 rotation(1.0);
-	rotation = glm::rotate(rotation, glm::radians(transform->rotate.z), glm::vec3(0, 0, 1));
-	rotation = glm::rotate(rotation, glm::radians(transform->rotate.y), glm::vec3(0, 1, 0));
-	rotation = glm::rotate(rotation, glm::radians(transform->rotate.x), glm::vec3(1, 0, 0));
-	glm::vec3 direction(1.0, 0.0, 0.0);
-	direction = glm::mat3(rotation) * direction;
-	float cutOff = glm::cos(glm::radians(spotLight->cutOff));
-	float outerCutOff = glm::cos(glm::radians(spotLight->outerCutOff));
-	ssbo.bind();
-	ssbo.bufferSubdata(index * glslSize, 12, glm::value_ptr(transform->translate));
-	ssbo.bufferSubdata(index * glslSize + 12, 4, nullptr);
-	ssbo.bufferSubdata(index * glslSize + 16, 12, glm::value_ptr(direction));
-	ssbo.bufferSubdata(index * glslSize + 28, 4, nullptr);
-	ssbo.bufferSubdata(index * glslSize + 32, 12, glm::value_ptr(spotLight->color));
-	ssbo.bufferSubdata(index * glslSize + 44, 4, &spotLight->brightness);
-	ssbo.bufferSubdata(index * glslSize + 48, 4, &cutOff);
-	ssbo.bufferSubdata(index * glslSize + 52, 4, &outerCutOff);
-	ssbo.bufferSubdata(index * glslSize + 56, 8, nullptr);
-	ssbo.unbind();
+	light.position = glm::vec4(transform->getWorldPosition(), 0.0f);
+	light.direction = glm::vec4(transform->getWorldDirection(glm::vec3(1.0f, 0.0f, 0.0f)), 0.0f);
+	light.color = spotLight->color;
+	light.brightness = spotLight->brightness;
+	light.cutOff = glm::cos(glm::radians(spotLight->cutOff));
+	light.outerCutOff = glm::cos(glm::radians(spotLight->outerCutOff));
+	light.padding = glm::vec2(0.0f);
 }
 
 class SkyBoxObject : public GameObject {
@@ -380,11 +346,11 @@ public:
 	SkyBoxObject(std::string name) : GameObject(name) {
 		type = GameObject::Type::SKYBOXOBJECT;
 	}
-	void draw(ShaderPtr shader) override;
-	void useCubeMap(ShaderPtr shader) override;
+	void draw(const ShaderPtr& shader) override;
+	void useCubeMap(const ShaderPtr& shader) override;
 };
 
-void SkyBoxObject::draw(ShaderPtr shader) {
+void SkyBoxObject::draw(const ShaderPtr& shader) {
 	shader->setInt("skybox", 5);
 	if (auto skyboxComponent = getComponent<SkyBoxComponent>()) {
 		if (skyboxComponent->skybox) {
@@ -393,7 +359,7 @@ void SkyBoxObject::draw(ShaderPtr shader) {
 	}
 }
 
-void SkyBoxObject::useCubeMap(ShaderPtr shader) {
+void SkyBoxObject::useCubeMap(const ShaderPtr& shader) {
 	shader->setInt("skybox", 5);
 	if (auto skyboxComponent = getComponent<SkyBoxComponent>()) {
 		if (skyboxComponent->skybox) {
@@ -407,26 +373,20 @@ public:
 	StaticMeshObject(std::string name) : GameObject(name) {
 		type = GameObject::Type::RENDEROBJECT;
 	}
-	void draw(ShaderPtr shader) override;
+	void draw(const ShaderPtr& shader) override;
+	bool addToBatch(DrawBatcher& batcher) override;
 	bool isOnFrustum(Frustum& frustum) override;
 };
 
-void StaticMeshObject::draw(ShaderPtr shader) {
+void StaticMeshObject::draw(const ShaderPtr& shader) {
 	if (auto staticMeshComponent = getComponent<StaticMeshComponent>()) {
 		if (auto dynamicMaterialComponent = getComponent<DynamicMaterialComponent>()) {
 			dynamicMaterialComponent->material.bind(shader);
 		}
 		glm::mat4 model = glm::mat4(1.0f);
 		if (auto transform = getComponent<Transform>()) {
-			model = glm::translate(model, transform->translate);
-			model = glm::rotate(model, glm::radians(transform->rotate.z), glm::vec3(0, 0, 1));
-			model = glm::rotate(model, glm::radians(transform->rotate.y), glm::vec3(0, 1, 0));
-			model = glm::rotate(model, glm::radians(transform->rotate.x), glm::vec3(1, 0, 0));
-			model = glm::scale(model, transform->scale);
+			model = transform->getWorldMatrix();
 			shader.get()->setMat4("model", model);
-			for (int i = 0; i < 100; i++) {
-				shader.get()->setMat4(("finalBoneMatrices[" + std::to_string(i) + "]").c_str(), glm::mat4(1.0f));
-			}
 			if (staticMeshComponent->mesh) {
 				staticMeshComponent->mesh->draw();
 			}
@@ -434,15 +394,25 @@ void StaticMeshObject::draw(ShaderPtr shader) {
 	}
 }
 
+bool StaticMeshObject::addToBatch(DrawBatcher& batcher) {
+	auto staticMeshComponent = getComponent<StaticMeshComponent>();
+	auto transform = getComponent<Transform>();
+	if (!staticMeshComponent || !staticMeshComponent->mesh || !staticMeshComponent->mesh->isReady() || !transform) {
+		return false;
+	}
+	Material* material = nullptr;
+	if (auto dynamicMaterialComponent = getComponent<DynamicMaterialComponent>()) {
+		material = &dynamicMaterialComponent->material;
+	}
+	batcher.add(*staticMeshComponent->mesh, material, batcher.addTransform(transform->getWorldMatrix()));
+	return true;
+}
+
 bool StaticMeshObject::isOnFrustum(Frustum& frustum) {
 	if (auto staticMeshComponent = getComponent<StaticMeshComponent>()) {
 		glm::mat4 model = glm::mat4(1.0f);
 		if (auto transform = getComponent<Transform>()) {
-			model = glm::translate(model, transform->translate);
-			model = glm::rotate(model, glm::radians(transform->rotate.z), glm::vec3(0, 0, 1));
-			model = glm::rotate(model, glm::radians(transform->rotate.y), glm::vec3(0, 1, 0));
-			model = glm::rotate(model, glm::radians(transform->rotate.x), glm::vec3(1, 0, 0));
-			model = glm::scale(model, transform->scale);
+			model = transform->getWorldMatrix();
 
 			glm::vec3 minAABB = staticMeshComponent->aabb.min;
 			glm::vec3 maxAABB = staticMeshComponent->aabb.max;
@@ -494,10 +464,10 @@ public:
 	RayMarchingVolumeObject(std::string name) : GameObject(name) {
 		type = GameObject::Type::VOLUMEOBJECT;
 	}
-	void draw(ShaderPtr shader) override;
+	void draw(const ShaderPtr& shader) override;
 };
 
-void RayMarchingVolumeObject::draw(ShaderPtr shader) {
+void RayMarchingVolumeObject::draw(const ShaderPtr& shader) {
 	if (auto staticMeshComponent = getComponent<StaticMeshComponent>()) {
 		glm::mat4 model = glm::mat4(1.0f);
 		if (auto transform = getComponent<Transform>()) {
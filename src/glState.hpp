@@ -0,0 +1,90 @@
+#ifndef GLSTATE_HPP
+#define GLSTATE_HPP
+#pragma once
+
+#include <glad/glad.h>
+
+// ¼ǰ󶨵ĳVAOһͬİֱ
+// ƹֱӵgl󶨺Ĵ(ImGui)ü¼ʧЧÿ֡ʼЩ֮Ҫinvalidate
+class GLState {
+public:
+	static GLState& getInstance() {
+		static GLState instance;
+		return instance;
+	}
+
+	void useProgram(GLuint program);
+	// textureUnitΪGL_TEXTURE0 + i
+	void bindTexture(GLenum textureUnit, GLenum target, GLuint texture);
+	void bindVertexArray(GLuint vao);
+	void invalidate();
+
+	struct Counters {
+		int programBinds = 0, programSkipped = 0;
+		int textureBinds = 0, textureSkipped = 0;
+		int vaoBinds = 0, vaoSkipped = 0;
+	} counters;
+	void resetCounters() { counters = Counters(); }
+private:
+	GLState() { invalidate(); }
+	~GLState() = default;
+
+	static const int MAX_TEXTURE_UNITS = 16;
+	static const GLuint UNKNOWN = 0xFFFFFFFFu;
+	GLuint program;
+	GLuint vao;
+	GLenum activeUnit;
+	GLenum textureTargets[MAX_TEXTURE_UNITS];
+	GLuint textures[MAX_TEXTURE_UNITS];
+};
+
+void GLState::useProgram(GLuint program) {
+	if (this->program == program) {
+		counters.programSkipped++;
+		return;
+	}
+	glUseProgram(program);
+	this->program = program;
+	counters.programBinds++;
+}
+
+void GLState::bindTexture(GLenum textureUnit, GLenum target, GLuint texture) {
+	int unit = (int)(textureUnit - GL_TEXTURE0);
+	bool tracked = unit >= 0 && unit < MAX_TEXTURE_UNITS;
+	if (tracked && textureTargets[unit] == target && textures[unit] == texture) {
+		counters.textureSkipped++;
+		return;
+	}
+	if (activeUnit != textureUnit) {
+		glActiveTexture(textureUnit);
+		activeUnit = textureUnit;
+	}
+	glBindTexture(target, texture);
+	if (tracked) {
+		textureTargets[unit] = target;
+		textures[unit] = texture;
+	}
+	counters.textureBinds++;
+}
+
+void GLState::bindVertexArray(GLuint vao) {
+	if (this->vao == vao) {
+		counters.vaoSkipped++;
+		return;
+	}
+	glBindVertexArray(vao);
+	this->vao = vao;
+	counters.vaoBinds++;
+}
+
+void GLState::invalidate() {
+	program = UNKNOWN;
+	vao = UNKNOWN;
+	activeUnit = UNKNOWN;
+	for (int i = 0; i < MAX_TEXTURE_UNITS; i++) {
+		textureTargets[i] = UNKNOWN;
+		textures[i] = UNKNOWN;
+	}
+}
+
+#endif // !GLSTATE_HPP
@@ -0,0 +1,108 @@
+#ifndef HEADLESS_HPP
+#define HEADLESS_HPP
+#pragma once
+
+#include <GLFW/glfw3.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// ޴еĲڻ׼ԺȾع飺
+// ̶̶·̶֡͹̶ʱ䲽ÿ֡GPUɣͬĲÿεõͬĻ
+struct HeadlessConfig {
+	bool enabled = false;
+	int width = 1280, height = 720;
+	int frames = 240;
+	// ÿ֡һŻ棬0ʾ
+	int captureEvery = 1;
+	double frameTime = 1.0 / 60.0;
+	int contextApi = GLFW_EGL_CONTEXT_API;
+	std::string outputDir = "headless_output";
+	std::vector<std::string> models;
+
+	// û--headlessʱenabledfalseʱӡ÷false
+	static bool parse(int argc, char** argv, HeadlessConfig& config);
+	static void printUsage(const char* program);
+};
+
+// PPM(P6)pixelsдµ(glReadPixels˳)дʱת
+bool writePPM(const std::string& path, int width, int height, const std::vector<unsigned char>& pixels);
+
+bool HeadlessConfig::parse(int argc, char** argv, HeadlessConfig& config) {
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(arg, "--headless") == 0) {
+			config.enabled = true;
+		}
+		else if (std::strcmp(arg, "--frames") == 0 && hasValue) {
+			config.frames = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(arg, "--size") == 0 && hasValue) {
+			if (std::sscanf(argv[++i], "%dx%d", &config.width, &config.height) != 2) {
+				printUsage(argv[0]);
+				return false;
+			}
+		}
+		else if (std::strcmp(arg, "--fps") == 0 && hasValue) {
+			double fps = std::atof(argv[++i]);
+			config.frameTime = fps > 0.0 ? 1.0 / fps : 0.0;
+		}
+		else if (std::strcmp(arg, "--capture-every") == 0 && hasValue) {
+			config.captureEvery = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(arg, "--out") == 0 && hasValue) {
+			config.outputDir = argv[++i];
+		}
+		else if (std::strcmp(arg, "--model") == 0 && hasValue) {
+			config.models.push_back(argv[++i]);
+		}
+		else if (std::strcmp(arg, "--context") == 0 && hasValue) {
+			std::string api = argv[++i];
+			if (api == "egl") config.contextApi = GLFW_EGL_CONTEXT_API;
+			else if (api == "osmesa") config.contextApi = GLFW_OSMESA_CONTEXT_API;
+			else if (api == "native") config.contextApi = GLFW_NATIVE_CONTEXT_API;
+			else {
+				printUsage(argv[0]);
+				return false;
+			}
+		}
+		else {
+			printUsage(argv[0]);
+			return false;
+		}
+	}
+	if (config.enabled && (config.width <= 0 || config.height <= 0 || config.frames <= 0 || config.frameTime <= 0.0)) {
+		printUsage(argv[0]);
+		return false;
+	}
+	return true;
+}
+
+void HeadlessConfig::printUsage(const char* program) {
+	std::cerr << "Usage: " << program << " [--headless [options]]\n"
+		<< "  --frames N          frames to render (default 240)\n"
+		<< "  --size WxH          render size (default 1280x720)\n"
+		<< "  --fps N             fixed simulation rate (default 60)\n"
+		<< "  --capture-every N   save every Nth frame as PPM, 0 saves none (default 1)\n"
+		<< "  --out DIR           output directory (default headless_output)\n"
+		<< "  --model PATH        add a model at the origin, may be repeated\n"
+		<< "  --context API       egl, osmesa or native (default egl)\n";
+}
+
+bool writePPM(const std::string& path, int width, int height, const std::vector<unsigned char>& pixels) {
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out) return false;
+	out << "P6\n" << width << ' ' << height << "\n255\n";
+	size_t rowSize = (size_t)width * 3;
+	for (int y = height - 1; y >= 0; y--) {
+		out.write((const char*)pixels.data() + y * rowSize, rowSize);
+	}
+	return (bool)out;
+}
+
+#endif // !HEADLESS_HPP
@@ -0,0 +1,228 @@
+#ifndef LIGHTBUFFER_HPP
+#define LIGHTBUFFER_HPP
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// test.fragstd430һһӦĹԴṹ
+struct GPUPointLight {
+	glm::vec3 position;
+	int shadowIndex; // ڵԴӰе±꣬-1ʾûӰ
+	glm::vec3 color;
+	float brightness;
+	float constant;
+	float linear;
+	float quadratic;
+	float farPlane;
+};
+static_assert(sizeof(GPUPointLight) == 48, "GPUPointLight must match std430 PointLight");
+
+struct GPUDirectionLight {
+	glm::vec4 direction;
+	glm::vec3 color;
+	float brightness;
+};
+static_assert(sizeof(GPUDirectionLight) == 32, "GPUDirectionLight must match std430 DirectionLight");
+
+struct GPUSpotLight {
+	glm::vec4 position;
+	glm::vec4 direction;
+	glm::vec3 color;
+	float brightness;
+	float cutOff;
+	float outerCutOff;
+	glm::vec2 padding;
+};
+static_assert(sizeof(GPUSpotLight) == 64, "GPUSpotLight must match std430 SpotLight");
+
+// йԴдCPU飬ÿ֡һԿGPU
+// ֧GL4.4ʱʹó־ӳλλ壬ÿfenceдʱGPUڶĶγͻ
+// Դʱݣÿ֡дݲҪ
+class LightBuffer {
+public:
+	LightBuffer() = default;
+	void init(GLuint pointBinding, GLuint directionBinding, GLuint spotBinding, int maxPointLights, int maxSpotLights);
+	void destroy();
+	void reserve(int maxPointLights, int maxSpotLights);
+
+	void clear();
+	GPUPointLight& addPointLight();
+	GPUDirectionLight& setDirectionLight();
+	GPUSpotLight& addSpotLight();
+
+	// ǰβ󶨵Եbinding
+	void upload();
+	// ֡ʹùԴݵĻύ֮
+	void endFrame();
+
+	int getPointLightCount() const { return (int)pointLights.size(); }
+	int getDirectionLightCount() const { return hasDirectionLight ? 1 : 0; }
+	int getSpotLightCount() const { return (int)spotLights.size(); }
+	const std::vector<GPUPointLight>& getPointLights() const { return pointLights; }
+private:
+	static const int SECTION_COUNT = 3;
+
+	GLuint ID = 0;
+	GLuint pointBinding = 1, directionBinding = 2, spotBinding = 3;
+	int maxPointLights = 0, maxSpotLights = 0;
+	GLsizeiptr pointOffset = 0, directionOffset = 0, spotOffset = 0, sectionSize = 0;
+	bool persistent = false;
+	char* mapped = nullptr;
+	GLsync fences[SECTION_COUNT] = {};
+	int section = 0;
+
+	std::vector<GPUPointLight> pointLights;
+	GPUDirectionLight directionLight = {};
+	bool hasDirectionLight = false;
+	std::vector<GPUSpotLight> spotLights;
+	std::vector<char> staging;
+
+	static GLsizeiptr alignUp(GLsizeiptr value, GLsizeiptr alignment) { return (value + alignment - 1) / alignment * alignment; }
+};
+
+void LightBuffer::init(GLuint pointBinding, GLuint directionBinding, GLuint spotBinding, int maxPointLights, int maxSpotLights) {
+	this->pointBinding = pointBinding;
+	this->directionBinding = directionBinding;
+	this->spotBinding = spotBinding;
+	this->maxPointLights = maxPointLights;
+	this->maxSpotLights = maxSpotLights;
+
+	// ÿηŵԴƽй⡢۹ƣƫSSBOҪ
+	GLint alignment = 16;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	pointOffset = 0;
+	directionOffset = alignUp(pointOffset + maxPointLights * sizeof(GPUPointLight), alignment);
+	spotOffset = alignUp(directionOffset + sizeof(GPUDirectionLight), alignment);
+	sectionSize = alignUp(spotOffset + maxSpotLights * sizeof(GPUSpotLight), alignment);
+	staging.assign(sectionSize, 0);
+
+	glGenBuffers(1, &ID);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ID);
+	persistent = GLAD_GL_VERSION_4_4 != 0;
+	if (persistent) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_SHADER_STORAGE_BUFFER, sectionSize * SECTION_COUNT, NULL, flags);
+		mapped = (char*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, sectionSize * SECTION_COUNT, flags);
+		if (!mapped) {
+			std::cout << "Failed to map light buffer, falling back to glBufferSubData" << std::endl;
+			glDeleteBuffers(1, &ID);
+			glGenBuffers(1, &ID);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, ID);
+			persistent = false;
+		}
+	}
+	if (!persistent) {
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sectionSize, NULL, GL_DYNAMIC_DRAW);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void LightBuffer::destroy() {
+	for (int i = 0; i < SECTION_COUNT; i++) {
+		if (fences[i]) {
+			glDeleteSync(fences[i]);
+			fences[i] = 0;
+		}
+	}
+	if (ID) {
+		if (mapped) {
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, ID);
+			glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+			mapped = nullptr;
+		}
+		glDeleteBuffers(1, &ID);
+		ID = 0;
+	}
+}
+
+void LightBuffer::reserve(int maxPointLights, int maxSpotLights) {
+	if (maxPointLights <= this->maxPointLights && maxSpotLights <= this->maxSpotLights) return;
+	// ɻԱGPUʹãglDeleteBuffersȵʹʱͷ
+	destroy();
+	section = 0;
+	init(pointBinding, directionBinding, spotBinding, std::max(maxPointLights, this->maxPointLights), std::max(maxSpotLights, this->maxSpotLights));
+}
+
+void LightBuffer::clear() {
+	pointLights.clear();
+	spotLights.clear();
+	hasDirectionLight = false;
+}
+
+GPUPointLight& LightBuffer::addPointLight() {
+	pointLights.emplace_back();
+	return pointLights.back();
+}
+
+GPUDirectionLight& LightBuffer::setDirectionLight() {
+	hasDirectionLight = true;
+	return directionLight;
+}
+
+GPUSpotLight& LightBuffer::addSpotLight() {
+	spotLights.emplace_back();
+	return spotLights.back();
+}
+
+void LightBuffer::upload() {
+	int pointCount = getPointLightCount();
+	int spotCount = getSpotLightCount();
+	if (pointCount > maxPointLights || spotCount > maxSpotLights) {
+		int newMaxPointLights = maxPointLights;
+		int newMaxSpotLights = maxSpotLights;
+		while (newMaxPointLights < pointCount) newMaxPointLights *= 2;
+		while (newMaxSpotLights < spotCount) newMaxSpotLights *= 2;
+		reserve(newMaxPointLights, newMaxSpotLights);
+	}
+
+	char* dst = staging.data();
+	if (persistent) {
+		// ȴGPU֡ǰдһ
+		if (fences[section]) {
+			GLenum result = glClientWaitSync(fences[section], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+			while (result == GL_TIMEOUT_EXPIRED) {
+				result = glClientWaitSync(fences[section], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			}
+			glDeleteSync(fences[section]);
+			fences[section] = 0;
+		}
+		dst = mapped + section * sectionSize;
+	}
+	if (pointCount) {
+		memcpy(dst + pointOffset, pointLights.data(), pointCount * sizeof(GPUPointLight));
+	}
+	memcpy(dst + directionOffset, &directionLight, sizeof(GPUDirectionLight));
+	if (spotCount) {
+		memcpy(dst + spotOffset, spotLights.data(), spotCount * sizeof(GPUSpotLight));
+	}
+
+	GLintptr base = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ID);
+	if (persistent) {
+		base = section * sectionSize;
+	}
+	else {
+		// ֻõĲ֣һε
+		GLsizeiptr used = spotCount ? spotOffset + spotCount * sizeof(GPUSpotLight) : directionOffset + sizeof(GPUDirectionLight);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, used, dst);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	// Ϊ0ķΧϷҲٰһԪ
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, pointBinding, ID, base + pointOffset, std::max(pointCount, 1) * sizeof(GPUPointLight));
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, directionBinding, ID, base + directionOffset, sizeof(GPUDirectionLight));
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, spotBinding, ID, base + spotOffset, std::max(spotCount, 1) * sizeof(GPUSpotLight));
+}
+
+void LightBuffer::endFrame() {
+	if (!persistent) return;
+	fences[section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	section = (section + 1) % SECTION_COUNT;
+}
+
+#endif // !LIGHTBUFFER_HPP
@@ -1,6 +1,14 @@
 #include "engine.hpp"
 
-int main() {
+int main(int argc, char** argv) {
+    HeadlessConfig headless;
+    if (!HeadlessConfig::parse(argc, argv, headless)) {
+        return 1;
+    }
+    if (headless.enabled) {
+        Engine::getInstance().initHeadless(headless);
+        return Engine::getInstance().runHeadless() ? 0 : 1;
+    }
     Engine::getInstance().init();
     Engine::getInstance().run();
     return 0;
@@ -2,7 +2,9 @@
 #define MATERIAL_HPP
 #pragma once
 
+#include "materialTable.hpp"
 #include "texture.hpp"
+#include "textureCache.hpp"
 #include "shader.hpp"
 #include <glad/glad.h>
 #include <iostream>
@@ -14,8 +16,21 @@ class Material
 public:
 	Material(){};
 	Material(unsigned int index, std::string albedoPath, std::string ambientPath, std::string specularPath, std::string normalPath, std::string shininessPath);
+	// ʳúͲʱеıţʱ黹ֻƶܿ
+	~Material();
+	Material(const Material&) = delete;
+	Material& operator=(const Material&) = delete;
+	Material(Material&& other) noexcept;
+	Material& operator=(Material&& other) noexcept;
 	void initGLResources();
-	void bind(ShaderPtr shader);
+	void bind(const ShaderPtr& shader);
+	// еĲʱţƶԭı
+	unsigned int getSortId() const { return sortId; }
+	unsigned int getIndex() const { return index; }
+	// MaterialTableеıţ-1ʾûҪʰ
+	int getTableIndex() const { return tableIndex; }
+	// ȫʱtrueں̨ʱfalseʱĬϲʻơɺ
+	bool updateReady();
 
 	std::string albedoPath;
 	std::string ambientPath;
@@ -23,9 +38,19 @@ public:
 	std::string normalPath;
 	std::string shininessPath;
 private:
-	unsigned int index;
+	unsigned int index = 0;
+	unsigned int sortId = nextSortId();
+	int tableIndex = -1;
+	bool pending = false;
 	std::vector<Texture2D> textures;
+	static unsigned int nextSortId() { static unsigned int counter = 0; return counter++; }
+	void loadTexture(const std::string& path, Texture2D::Type type);
 	void deleteTextures();
+	// 黹ʱź
+	void releaseGLResources();
+	void moveFrom(Material& other);
+	// 0~4ŵԪеûеΪ0
+	void getUnits(GLuint units[5], bool& hasNormalMap) const;
 };
 
 Material::Material(unsigned int index, std::string albedoPath, std::string ambientPath, std::string specularPath, std::string normalPath, std::string shininessPath)
@@ -38,71 +63,172 @@ Material::Material(unsigned int index, std::string albedoPath, std::string ambie
 	this->shininessPath = shininessPath;
 }
 
+Material::~Material()
+{
+	releaseGLResources();
+}
+
+Material::Material(Material&& other) noexcept
+{
+	moveFrom(other);
+}
+
+Material& Material::operator=(Material&& other) noexcept
+{
+	if (this != &other) {
+		releaseGLResources();
+		moveFrom(other);
+	}
+	return *this;
+}
+
+void Material::moveFrom(Material& other)
+{
+	albedoPath = std::move(other.albedoPath);
+	ambientPath = std::move(other.ambientPath);
+	specularPath = std::move(other.specularPath);
+	normalPath = std::move(other.normalPath);
+	shininessPath = std::move(other.shininessPath);
+	index = other.index;
+	sortId = other.sortId;
+	tableIndex = other.tableIndex;
+	pending = other.pending;
+	textures = std::move(other.textures);
+	// ԴѾתotherʱٹ黹
+	other.tableIndex = -1;
+	other.pending = false;
+	other.textures.clear();
+}
+
+void Material::releaseGLResources()
+{
+	if (tableIndex >= 0) {
+		MaterialTable::getInstance().remove(tableIndex);
+		tableIndex = -1;
+	}
+	deleteTextures();
+	pending = false;
+}
+
 void Material::initGLResources()
 {
+	MaterialTable& table = MaterialTable::getInstance();
+	if (tableIndex >= 0) {
+		table.release(tableIndex);
+	}
 	deleteTextures();
-	if (std::filesystem::is_regular_file(albedoPath))
-	{
-		textures.push_back(Texture2D(albedoPath.c_str(), Texture2D::Type::ALBEDO, GL_REPEAT, GL_LINEAR));
+	loadTexture(albedoPath, Texture2D::Type::ALBEDO);
+	loadTexture(ambientPath, Texture2D::Type::AMBIENT);
+	loadTexture(specularPath, Texture2D::Type::SPECULAR);
+	loadTexture(normalPath, Texture2D::Type::NORMAL);
+	loadTexture(shininessPath, Texture2D::Type::SHININESS);
+	pending = true;
+	updateReady();
+}
+
+bool Material::updateReady()
+{
+	if (!pending) return true;
+	TextureCache& cache = TextureCache::getInstance();
+	for (size_t i = 0; i < textures.size(); i++) {
+		if (cache.getState(textures[i].ID) == TextureCache::State::LOADING) return false;
 	}
-	if (std::filesystem::is_regular_file(ambientPath))
-	{
-		textures.push_back(Texture2D(ambientPath.c_str(), Texture2D::Type::AMBIENT, GL_REPEAT, GL_LINEAR));
+	// ʧܵû
+	for (int i = (int)textures.size() - 1; i >= 0; i--) {
+		if (cache.getState(textures[i].ID) == TextureCache::State::FAILED) {
+			cache.release(textures[i].ID);
+			textures.erase(textures.begin() + i);
+		}
 	}
-	if (std::filesystem::is_regular_file(specularPath))
-	{
-		textures.push_back(Texture2D(specularPath.c_str(), Texture2D::Type::SPECULAR, GL_REPEAT, GL_LINEAR));
+	pending = false;
+
+	MaterialTable& table = MaterialTable::getInstance();
+	GLuint units[5] = {};
+	bool hasNormalMap = false;
+	getUnits(units, hasNormalMap);
+	if (tableIndex < 0) {
+		tableIndex = table.add(units);
 	}
-	if (std::filesystem::is_regular_file(normalPath))
-	{
-		textures.push_back(Texture2D(normalPath.c_str(), Texture2D::Type::NORMAL, GL_REPEAT, GL_LINEAR));
+	else if (!table.update(tableIndex, units)) {
+		tableIndex = -1;
 	}
-	if (std::filesystem::is_regular_file(shininessPath))
-	{
-		textures.push_back(Texture2D(shininessPath.c_str(), Texture2D::Type::SHININESS, GL_REPEAT, GL_LINEAR));
+	// ģʽѾ飬ͷŶԭãTextureCacheʱɾ
+	if (tableIndex >= 0 && !table.isBindless()) {
+		deleteTextures();
 	}
+	return true;
 }
 
-void Material::bind(ShaderPtr shader)
+void Material::bind(const ShaderPtr& shader)
 {
-	for (auto i = GL_TEXTURE0; i <= GL_TEXTURE4; i++) {
-		glActiveTexture(i);
-		glBindTexture(GL_TEXTURE_2D, 0);
+	if (!updateReady()) {
+		// ռλʹòʱеĬϲ
+		shader->setBool("useMaterialTable", true);
+		shader->setInt("materialIndex", 0);
+		return;
+	}
+	if (tableIndex >= 0) {
+		shader->setBool("useMaterialTable", true);
+		shader->setInt("materialIndex", tableIndex);
+		return;
+	}
+	shader->setBool("useMaterialTable", false);
+	// ȷ0~4ŵԪԵûеİ0͵ǰͬGLState
+	GLuint units[5] = {};
+	bool hasNormalMap = false;
+	getUnits(units, hasNormalMap);
+	for (int i = 0; i < 5; i++) {
+		GLState::getInstance().bindTexture(GL_TEXTURE0 + i, GL_TEXTURE_2D, units[i]);
 	}
-	shader->setInt("useDefaultMaterial", 0);
 	if (textures.size() == 0) {
 		shader->setInt("useDefaultMaterial", 1);
 		return;
 	}
-	shader->setInt("hasNormalMap", 0);
-	for (int i = 0; i < textures.size(); i++)
+	shader->setInt("useDefaultMaterial", 0);
+	shader->setInt("hasNormalMap", hasNormalMap ? 1 : 0);
+}
+
+void Material::getUnits(GLuint units[5], bool& hasNormalMap) const
+{
+	for (size_t i = 0; i < textures.size(); i++)
 	{
 		switch (textures[i].getType()) {
 			case Texture2D::Type::ALBEDO:
-				textures[i].use(GL_TEXTURE0);
+				units[0] = textures[i].ID;
 				break;
 			case Texture2D::Type::AMBIENT:
-				textures[i].use(GL_TEXTURE1);
+				units[1] = textures[i].ID;
 				break;
 			case Texture2D::Type::SPECULAR:
-				textures[i].use(GL_TEXTURE2);
+				units[2] = textures[i].ID;
 				break;
 			case Texture2D::Type::NORMAL:
-				shader->setInt("hasNormalMap", 1);
-				textures[i].use(GL_TEXTURE3);
-				break;			
+				hasNormalMap = true;
+				units[3] = textures[i].ID;
+				break;
 			case Texture2D::Type::SHININESS:
-				textures[i].use(GL_TEXTURE4);
+				units[4] = textures[i].ID;
+				break;
+			default:
 				break;
 		}
 	}
 }
 
+void Material::loadTexture(const std::string& path, Texture2D::Type type)
+{
+	if (!std::filesystem::is_regular_file(path)) return;
+	GLuint texture = TextureCache::getInstance().acquire(path, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR);
+	if (texture) {
+		textures.push_back(Texture2D(texture, type));
+	}
+}
+
 void Material::deleteTextures()
 {
-	for (int i = 0; i < textures.size(); i++)
+	for (size_t i = 0; i < textures.size(); i++)
 	{
-		glDeleteTextures(1, &textures[i].ID);
+		TextureCache::getInstance().release(textures[i].ID);
 		textures[i].ID = 0;
 	}
 	textures.clear();
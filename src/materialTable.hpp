@@ -0,0 +1,365 @@
+#ifndef MATERIALTABLE_HPP
+#define MATERIALTABLE_HPP
+#pragma once
+
+#include "glState.hpp"
+#include "shader.hpp"
+#include "textureCache.hpp"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+// test.fragstd430ֶӦĲ
+// textures[i]bindlessģʽ64λģʽ(, )
+struct GPUMaterial {
+	GLuint textures[5][2];
+	GLuint textureMask; // iλʾiڣ˳Materialе0~4ŵԪһ
+	GLuint padding;
+};
+static_assert(sizeof(GPUMaterial) == 48, "GPUMaterial must match std430 MaterialData");
+
+typedef GLuint64 (APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+
+// вʵ÷һSSBOʱʱŶȡʰԪ
+// ӻƿԿʺϲ
+// ֧GL_ARB_bindless_textureGL_NV_gpu_shader5ʱֱӴߴ͸ʽ飬
+// 9~15ŵԪ޵Ĳʷ-1ʰ
+class MaterialTable {
+public:
+	static const int TEXTURE_SLOTS = 5;
+	static const int MAX_ARRAYS = 7;
+	static const GLenum FIRST_ARRAY_UNIT = GL_TEXTURE9;
+
+	static MaterialTable& getInstance() {
+		static MaterialTable instance;
+		return instance;
+	}
+
+	// Ҫɫ֮ǰã޸settings.glslеUSE_BINDLESS_TEXTURES
+	void init(GLuint binding);
+	// textures0~4ŵԪУ0ʾûСزʱţʧܷ-1
+	int add(const GLuint textures[TEXTURE_SLOTS]);
+	// ɾ֮ǰãͷפľñʱĬϲ
+	void release(int index);
+	// ʱãͷź֮add
+	void remove(int index);
+	// ¼ͷŵı
+	bool update(int index, const GLuint textures[TEXTURE_SLOTS]);
+	// ݱ仯ʱϴSSBO
+	void bind();
+
+	bool isBindless() const { return bindless; }
+	int getMaterialCount() const { return (int)(materials.size() - freeIndices.size()); }
+	int getArrayCount() const { return (int)arrays.size(); }
+	int getRejectedCount() const { return rejected; }
+private:
+	MaterialTable() = default;
+	~MaterialTable() = default;
+
+	struct TextureArray {
+		GLuint ID = 0;
+		GLsizei width = 0, height = 0;
+		GLenum internalFormat = 0;
+		GLsizei levels = 1;
+		int layers = 0, capacity = 0;
+		// ÿ㱻ٸãĲŽfreeLayers֮ȸ
+		std::vector<int> layerRefs;
+		std::vector<GLuint> layerTextures;
+		std::vector<int> freeLayers;
+	};
+	// һʳеãbindlessģʽפľģʽռõ(, )
+	struct MaterialRefs {
+		std::vector<GLuint64> handles;
+		std::vector<glm::uvec2> layers;
+	};
+
+	GLuint buffer = 0;
+	GLuint binding = 7;
+	bool bindless = false;
+	bool dirty = true;
+	int rejected = 0;
+	GLint maxLayers = 256;
+	std::vector<GPUMaterial> materials;
+	std::vector<int> freeIndices;
+	std::vector<TextureArray> arrays;
+	// ÿʳеãʱͷ
+	std::vector<MaterialRefs> refs;
+	// TextureCacheͬһľֻפһΣҲֻһ
+	std::unordered_map<GLuint64, int> residentCounts;
+	std::unordered_map<GLuint, glm::uvec2> arrayLayers;
+
+	PFNGLGETTEXTUREHANDLEARBPROC getTextureHandle = nullptr;
+	PFNGLMAKETEXTUREHANDLERESIDENTARBPROC makeHandleResident = nullptr;
+	PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC makeHandleNonResident = nullptr;
+
+	bool fill(GPUMaterial& material, MaterialRefs& materialRefs, const GLuint textures[TEXTURE_SLOTS]);
+	void releaseRefs(MaterialRefs& materialRefs);
+	void makeResident(GLuint64 handle);
+	void makeNonResident(GLuint64 handle);
+	// ҵ򴴽ܷ¸飬(, )Ӹòãʧܷfalse
+	bool copyToArray(GLuint texture, GLuint& arrayIndex, GLuint& layer);
+	void releaseLayer(glm::uvec2 ref);
+	void growArray(TextureArray& array, int capacity);
+	// ͨGL_RED/GL_RGB/GL_RGBAɱ洢ҪӦĴλʽ
+	static GLenum sizedFormat(GLenum internalFormat);
+};
+
+void MaterialTable::init(GLuint binding) {
+	this->binding = binding;
+	glGenBuffers(1, &buffer);
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+	// gladֻ˺ĺbindlessҪֶȡ
+	// test.fragͼԪmaterialIndexȡͬһλڲǶ̬һµģ
+	// ARB_bindless_textureֻ̬һµľҪNV_gpu_shader5
+	if (glfwExtensionSupported("GL_ARB_bindless_texture") && glfwExtensionSupported("GL_NV_gpu_shader5")) {
+		getTextureHandle = (PFNGLGETTEXTUREHANDLEARBPROC)glfwGetProcAddress("glGetTextureHandleARB");
+		makeHandleResident = (PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)glfwGetProcAddress("glMakeTextureHandleResidentARB");
+		makeHandleNonResident = (PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)glfwGetProcAddress("glMakeTextureHandleNonResidentARB");
+		bindless = getTextureHandle && makeHandleResident && makeHandleNonResident;
+	}
+	std::cout << "Material textures: " << (bindless ? "bindless handles" : "texture arrays") << std::endl;
+	Shader::changeSettings("USE_BINDLESS_TEXTURES", bindless);
+	// ɾֿܱãþɵĲ
+	TextureCache::getInstance().addEvictListener([this](GLuint texture) { arrayLayers.erase(texture); });
+
+	// 0ûĬϲ
+	materials.push_back(GPUMaterial{});
+	refs.emplace_back();
+}
+
+int MaterialTable::add(const GLuint textures[TEXTURE_SLOTS]) {
+	if (!buffer) return -1;
+	GPUMaterial material = {};
+	MaterialRefs materialRefs;
+	if (!fill(material, materialRefs, textures)) {
+		releaseRefs(materialRefs);
+		rejected++;
+		return -1;
+	}
+	dirty = true;
+	if (!freeIndices.empty()) {
+		int index = freeIndices.back();
+		freeIndices.pop_back();
+		materials[index] = material;
+		refs[index] = std::move(materialRefs);
+		return index;
+	}
+	materials.push_back(material);
+	refs.push_back(std::move(materialRefs));
+	return (int)materials.size() - 1;
+}
+
+void MaterialTable::release(int index) {
+	if (index <= 0 || index >= (int)materials.size()) return;
+	releaseRefs(refs[index]);
+	materials[index] = GPUMaterial{};
+	dirty = true;
+}
+
+void MaterialTable::remove(int index) {
+	if (index <= 0 || index >= (int)materials.size()) return;
+	release(index);
+	freeIndices.push_back(index);
+}
+
+bool MaterialTable::update(int index, const GLuint textures[TEXTURE_SLOTS]) {
+	if (index <= 0 || index >= (int)materials.size()) return false;
+	GPUMaterial material = {};
+	// ʧʱŵκ÷ʰ
+	if (!fill(material, refs[index], textures)) {
+		release(index);
+		return false;
+	}
+	materials[index] = material;
+	dirty = true;
+	return true;
+}
+
+bool MaterialTable::fill(GPUMaterial& material, MaterialRefs& materialRefs, const GLuint textures[TEXTURE_SLOTS]) {
+	for (int i = 0; i < TEXTURE_SLOTS; i++) {
+		if (!textures[i]) continue;
+		if (bindless) {
+			GLuint64 handle = getTextureHandle(textures[i]);
+			if (!handle) return false;
+			makeResident(handle);
+			materialRefs.handles.push_back(handle);
+			material.textures[i][0] = (GLuint)(handle & 0xFFFFFFFFu);
+			material.textures[i][1] = (GLuint)(handle >> 32);
+		}
+		else if (copyToArray(textures[i], material.textures[i][0], material.textures[i][1])) {
+			materialRefs.layers.push_back(glm::uvec2(material.textures[i][0], material.textures[i][1]));
+		}
+		else {
+			return false;
+		}
+		material.textureMask |= 1u << i;
+	}
+	return true;
+}
+
+void MaterialTable::releaseRefs(MaterialRefs& materialRefs) {
+	for (GLuint64 handle : materialRefs.handles) {
+		makeNonResident(handle);
+	}
+	for (const glm::uvec2& ref : materialRefs.layers) {
+		releaseLayer(ref);
+	}
+	materialRefs.handles.clear();
+	materialRefs.layers.clear();
+}
+
+void MaterialTable::makeResident(GLuint64 handle) {
+	if (residentCounts[handle]++ == 0) {
+		makeHandleResident(handle);
+	}
+}
+
+void MaterialTable::makeNonResident(GLuint64 handle) {
+	auto it = residentCounts.find(handle);
+	if (it == residentCounts.end()) return;
+	if (--it->second == 0) {
+		makeHandleNonResident(handle);
+		residentCounts.erase(it);
+	}
+}
+
+bool MaterialTable::copyToArray(GLuint texture, GLuint& arrayIndex, GLuint& layer) {
+	auto copied = arrayLayers.find(texture);
+	if (copied != arrayLayers.end()) {
+		arrayIndex = copied->second.x;
+		layer = copied->second.y;
+		arrays[arrayIndex].layerRefs[layer]++;
+		return true;
+	}
+	GLint width = 0, height = 0, internalFormat = 0;
+	glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_HEIGHT, &height);
+	glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+	internalFormat = (GLint)sizedFormat((GLenum)internalFormat);
+	if (width <= 0 || height <= 0 || !internalFormat) return false;
+	GLint levels = 1;
+	glGetTextureParameteriv(texture, GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+	levels = std::max(levels, 1);
+
+	int found = -1;
+	for (int i = 0; i < (int)arrays.size(); i++) {
+		if (arrays[i].width == width && arrays[i].height == height && arrays[i].internalFormat == (GLenum)internalFormat
+			&& arrays[i].levels == levels) {
+			found = i;
+			break;
+		}
+	}
+	if (found < 0) {
+		if ((int)arrays.size() >= MAX_ARRAYS) return false;
+		TextureArray array;
+		array.width = width;
+		array.height = height;
+		array.internalFormat = (GLenum)internalFormat;
+		array.levels = levels;
+		arrays.push_back(array);
+		found = (int)arrays.size() - 1;
+	}
+	TextureArray& array = arrays[found];
+	int target;
+	if (!array.freeLayers.empty()) {
+		target = array.freeLayers.back();
+		array.freeLayers.pop_back();
+	}
+	else {
+		if (array.layers >= maxLayers) return false;
+		if (array.layers == array.capacity) {
+			growArray(array, std::min(std::max(array.capacity * 2, 4), (int)maxLayers));
+		}
+		target = array.layers++;
+		array.layerRefs.push_back(0);
+		array.layerTextures.push_back(0);
+	}
+
+	// Թ˲ÿһmipmapҪ
+	for (GLint level = 0; level < levels; level++) {
+		glCopyImageSubData(texture, GL_TEXTURE_2D, level, 0, 0, 0, array.ID, GL_TEXTURE_2D_ARRAY, level, 0, 0, target,
+			std::max(1, width >> level), std::max(1, height >> level), 1);
+	}
+	arrayIndex = (GLuint)found;
+	layer = (GLuint)target;
+	array.layerRefs[target] = 1;
+	array.layerTextures[target] = texture;
+	arrayLayers[texture] = glm::uvec2(arrayIndex, layer);
+	return true;
+}
+
+void MaterialTable::releaseLayer(glm::uvec2 ref) {
+	TextureArray& array = arrays[ref.x];
+	if (--array.layerRefs[ref.y] > 0) return;
+	array.freeLayers.push_back((int)ref.y);
+	// 㱻úٰԭҵɾֱʱӳѾָĲ
+	auto it = arrayLayers.find(array.layerTextures[ref.y]);
+	if (it != arrayLayers.end() && it->second == ref) {
+		arrayLayers.erase(it);
+	}
+	array.layerTextures[ref.y] = 0;
+}
+
+void MaterialTable::growArray(TextureArray& array, int capacity) {
+	// ɱ洢ݣ󿽱еĲ
+	GLuint newID;
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &newID);
+	glTextureStorage3D(newID, array.levels, array.internalFormat, array.width, array.height, capacity);
+	glTextureParameteri(newID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(newID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTextureParameteri(newID, GL_TEXTURE_MIN_FILTER, array.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTextureParameteri(newID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	for (GLsizei level = 0; level < array.levels && array.layers > 0; level++) {
+		glCopyImageSubData(array.ID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, newID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+			std::max(1, array.width >> level), std::max(1, array.height >> level), array.layers);
+	}
+	if (array.ID) {
+		glDeleteTextures(1, &array.ID);
+	}
+	array.ID = newID;
+	array.capacity = capacity;
+	// ܻڻİ󶨼¼
+	GLState::getInstance().invalidate();
+}
+
+GLenum MaterialTable::sizedFormat(GLenum internalFormat) {
+	switch (internalFormat) {
+		case GL_RED:
+		case GL_R8:
+			return GL_R8;
+		case GL_RG:
+		case GL_RG8:
+			return GL_RG8;
+		case GL_RGB:
+		case GL_RGB8:
+			return GL_RGB8;
+		case GL_RGBA:
+		case GL_RGBA8:
+			return GL_RGBA8;
+		default:
+			return 0;
+	}
+}
+
+void MaterialTable::bind() {
+	if (!buffer) return;
+	if (dirty) {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, materials.size() * sizeof(GPUMaterial), materials.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		dirty = false;
+	}
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+	for (int i = 0; i < (int)arrays.size(); i++) {
+		GLState::getInstance().bindTexture(FIRST_ARRAY_UNIT + i, GL_TEXTURE_2D_ARRAY, arrays[i].ID);
+	}
+}
+
+#endif // !MATERIALTABLE_HPP
@@ -2,41 +2,50 @@
 #define MESH_HPP
 #pragma once
 
+#include "meshArena.hpp"
+#include "meshlet.hpp"
+#include "meshOptimizer.hpp"
+#include "meshSimplifier.hpp"
 #include "shader.hpp"
+#include "vertex.hpp"
+#include "vertexPacker.hpp"
+#include "core/renderSettings.hpp"
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <vector>
 
-#define MAX_BONES 500
-#define MAX_BONE_INFLUENCE 4
-
-struct Vertex
-{
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec2 texCoords;
-	glm::vec3 tangent;
-	glm::vec3 bitangent;
-	int boneIDs[MAX_BONE_INFLUENCE];
-    float weights[MAX_BONE_INFLUENCE];
-};
-
 class Mesh
 {
 public:
     std::vector<Vertex> vertices;
     std::vector<GLuint> indices;
+    // LOD1ʼĸͬһ鶥㣬lodErrors԰ΧжԽߵ
+    std::vector<std::vector<GLuint>> lods;
+    std::vector<float> lodErrors;
+    // LOD0гɵС飬GPU޳
+    std::vector<Meshlet> meshlets;
     Mesh() = default;
     Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices);
     bool initGLResources();
 	bool isReady() const { return glInitialized; }
-    void draw();
+    void draw(int lod = 0);
+    const MeshArena::Range& getRange() const { return range; }
     void setMaterialIndex(unsigned int index) { materialIndex = index; }
-    unsigned int getMaterialIndex() { return materialIndex; }
+    unsigned int getMaterialIndex() const { return materialIndex; }
     void buildAABB(glm::vec3& min, glm::vec3& max);
+    // ϴǰãϲظ㲢κͶ㣬񱣴
+    void optimize() { optimizeStats = MeshOptimizer::optimize(vertices, indices); }
+    const MeshOptimizer::Stats& getOptimizeStats() const { return optimizeStats; }
+    void setOptimizeStats(const MeshOptimizer::Stats& stats) { optimizeStats = stats; }
+    // optimize֮ãÿĿ룬򻯲ʱֹͣ
+    void buildLods();
+    int getLodCount() const { return 1 + (int)lods.size(); }
+    // optimize֮ã֮ٸĶindices
+    void buildMeshlets() { meshlets = MeshletBuilder::build(vertices, indices); }
 private:
-    GLuint VAO, VBO, EBO;
+    MeshArena::Range range;
     unsigned int materialIndex;
+    MeshOptimizer::Stats optimizeStats;
     bool glInitialized = false;
     void setupMesh();
 };
@@ -58,41 +67,56 @@ bool Mesh::initGLResources()
 
 void Mesh::setupMesh()
 {
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
-    glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
-	glEnableVertexAttribArray(3);
-	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
-	glEnableVertexAttribArray(4);
-	glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, boneIDs));
-	glEnableVertexAttribArray(5);
-	glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, weights));
-	glEnableVertexAttribArray(6);
+    // CPU˱Vertex(ΧС涼Ҫ)ֻϴݰʽѹ
+    VertexLayout layout = RenderSettings::getInstance().packedVertices ? VertexPacker::chooseLayout(vertices) : VertexLayout::STANDARD;
+    MeshArena& arena = MeshArena::get(layout);
+    if (layout == VertexLayout::PACKED_STATIC) {
+        std::vector<PackedVertex> packed = VertexPacker::packStatic(vertices);
+        range = arena.allocate(packed.data(), (GLuint)packed.size(), indices);
+    }
+    else if (layout == VertexLayout::PACKED_SKINNED) {
+        std::vector<PackedSkinnedVertex> packed = VertexPacker::packSkinned(vertices);
+        range = arena.allocate(packed.data(), (GLuint)packed.size(), indices);
+    }
+    else {
+        range = arena.allocate(vertices.data(), (GLuint)vertices.size(), indices);
+    }
+    for (const std::vector<GLuint>& lod : lods) {
+        arena.addLod(range, lod);
+    }
+    arena.addMeshlets(range, meshlets);
+}
 
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+void Mesh::buildLods()
+{
+    // i(԰ΧжԽ)
+    const float maxErrors[MAX_LODS] = { 0.0f, 0.01f, 0.03f, 0.1f };
+    lods.clear();
+    lodErrors.clear();
+    const std::vector<GLuint>* source = &indices;
+    float error = 0.0f;
+    for (int level = 1; level < MAX_LODS; level++) {
+        // ÿһ򻯣ÿδԭʼ
+        size_t target = indices.size() >> level;
+        target -= target % 3;
+        float levelError = 0.0f;
+        std::vector<GLuint> lod = MeshSimplifier::simplify(vertices, *source, target, maxErrors[level], levelError);
+        if (lod.empty() || lod.size() * 10 > source->size() * 9) break;
+        std::vector<uint32_t> clusters;
+        lods.push_back(MeshOptimizer::tipsify(lod, vertices.size(), MeshOptimizer::CACHE_SIZE, clusters));
+        error = std::max(error, levelError);
+        lodErrors.push_back(error);
+        source = &lods.back();
+    }
 }
 
-void Mesh::draw()
+void Mesh::draw(int lod)
 {
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    MeshArena::Range drawRange = range.getLod(lod);
+    MeshArena::get(range.layout).bind();
+    glDrawElementsBaseVertex(GL_TRIANGLES, drawRange.indexCount, GL_UNSIGNED_INT, (void*)(drawRange.firstIndex * sizeof(GLuint)), range.baseVertex);
+    RenderSettings::getInstance().stats.triangles += drawRange.indexCount / 3;
+    RenderSettings::getInstance().stats.fullDetailTriangles += range.indexCount / 3;
 }
 
 void Mesh::buildAABB(glm::vec3& min, glm::vec3& max) {
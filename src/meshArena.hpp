@@ -0,0 +1,303 @@
+#ifndef MESHARENA_HPP
+#define MESHARENA_HPP
+#pragma once
+
+#include "glState.hpp"
+#include "meshlet.hpp"
+#include "vertex.hpp"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// glMultiDrawElementsIndirectȡʽ
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// ͬһֶʽõĶ/壬ÿָʽֻһVAOлҪ°VAO
+// ҲöԺϲһglMultiDrawElementsIndirect
+// ֻ׷Ӳգʱݲ
+class MeshArena {
+public:
+	struct Lod {
+		GLuint firstIndex = 0;
+		GLuint indexCount = 0;
+	};
+	// firstIndex/indexCountLOD0LODͬһζ
+	struct Range {
+		GLint baseVertex = 0;
+		GLuint firstIndex = 0;
+		GLuint indexCount = 0;
+		GLuint id = 0; // ˳е
+		VertexLayout layout = VertexLayout::STANDARD;
+		int lodCount = 1;
+		Lod lods[MAX_LODS];
+		// ڱmeshletеλãֻLOD0
+		GLuint meshletOffset = 0;
+		GLuint meshletCount = 0;
+
+		// мʱֵһ
+		Range getLod(int level) const {
+			Range range = *this;
+			const Lod& lod = lods[std::clamp(level, 0, lodCount - 1)];
+			range.firstIndex = lod.firstIndex;
+			range.indexCount = lod.indexCount;
+			return range;
+		}
+	};
+
+	static MeshArena& get(VertexLayout layout) {
+		static MeshArena arenas[(int)VertexLayout::COUNT] = {
+			MeshArena(VertexLayout::STANDARD), MeshArena(VertexLayout::PACKED_SKINNED), MeshArena(VertexLayout::PACKED_STATIC)
+		};
+		return arenas[(int)layout];
+	}
+	static GLsizei getStride(VertexLayout layout);
+
+	// verticesĸʽУvertexCount
+	Range allocate(const void* vertices, GLuint vertexCount, const std::vector<GLuint>& indices);
+	// ׷һLODrangeеĶ
+	void addLod(Range& range, const std::vector<GLuint>& indices);
+	// ׷LOD0meshlet㻻еľλ
+	void addMeshlets(Range& range, const std::vector<Meshlet>& meshlets);
+	// location 78ʵ±ͲʱŵԴ
+	void setInstanceBuffer(GLuint buffer);
+	// ƺҪVAOͨGLState
+	void bind();
+
+	GLuint getVertexCount() const { return vertexCount; }
+	GLuint getIndexCount() const { return indexCount; }
+	GLuint getMeshletCount() const { return meshletCount; }
+	// ݻỻ壬ÿʹǰȡ
+	GLuint getMeshletBuffer() const { return meshletBuffer; }
+	size_t getVertexBytes() const { return (size_t)vertexCount * getStride(layout); }
+private:
+	explicit MeshArena(VertexLayout layout) : layout(layout) {}
+	~MeshArena() = default;
+
+	static const GLsizei INSTANCE_STRIDE = 2 * sizeof(GLuint);
+	// зһŲظ
+	static GLuint rangeCount;
+
+	VertexLayout layout;
+	GLuint VAO = 0, VBO = 0, EBO = 0, defaultInstanceBuffer = 0, layoutBuffer = 0;
+	GLuint vertexCount = 0, vertexCapacity = 0;
+	GLuint indexCount = 0, indexCapacity = 0;
+	GLuint meshletBuffer = 0, meshletCount = 0, meshletCapacity = 0;
+
+	void init();
+	void setupAttributes();
+	// д壬ʼλ
+	GLuint appendIndices(const std::vector<GLuint>& indices);
+	static GLuint grow(GLuint buffer, GLsizeiptr usedBytes, GLsizeiptr newBytes);
+};
+
+GLuint MeshArena::rangeCount = 0;
+
+GLsizei MeshArena::getStride(VertexLayout layout) {
+	switch (layout) {
+		case VertexLayout::PACKED_SKINNED: return sizeof(PackedSkinnedVertex);
+		case VertexLayout::PACKED_STATIC: return sizeof(PackedVertex);
+		default: return sizeof(Vertex);
+	}
+}
+
+void MeshArena::init() {
+	vertexCapacity = 1 << 16;
+	indexCapacity = 1 << 18;
+
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
+	GLState::getInstance().bindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexCapacity * getStride(layout), NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indexCapacity * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+
+	setupAttributes();
+	glBindVertexBuffer(0, VBO, 0, getStride(layout));
+
+	// location 9ɫǷѹΪ0жͬһֵ
+	GLuint packed = layout == VertexLayout::STANDARD ? 0 : 1;
+	glGenBuffers(1, &layoutBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, layoutBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(packed), &packed, GL_STATIC_DRAW);
+	glVertexAttribIFormat(9, 1, GL_UNSIGNED_INT, 0);
+	glVertexAttribBinding(9, 2);
+	glEnableVertexAttribArray(9);
+	glBindVertexBuffer(2, layoutBuffer, 0, 0);
+
+	// location 78ʵģ;±ͲʱţDrawBatcherÿύʱд룬
+	// ʵiȡbaseInstance+iʱʹãһֻ0Ļ屣֤ԺϷ
+	GLuint zero[2] = {};
+	glGenBuffers(1, &defaultInstanceBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, defaultInstanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(zero), zero, GL_STATIC_DRAW);
+	glVertexAttribIFormat(7, 1, GL_UNSIGNED_INT, 0);
+	glVertexAttribIFormat(8, 1, GL_UNSIGNED_INT, sizeof(GLuint));
+	for (GLuint i = 7; i <= 8; i++) {
+		glVertexAttribBinding(i, 1);
+		glEnableVertexAttribArray(i);
+	}
+	glVertexBindingDivisor(1, 1);
+	glBindVertexBuffer(1, defaultInstanceBuffer, 0, INSTANCE_STRIDE);
+	GLState::getInstance().bindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void MeshArena::setupAttributes() {
+	// ԸʽͻֿãݺֻҪ°󶨻
+	if (layout == VertexLayout::STANDARD) {
+		glVertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position));
+		glVertexAttribFormat(1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal));
+		glVertexAttribFormat(2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, texCoords));
+		glVertexAttribFormat(3, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, tangent));
+		glVertexAttribFormat(4, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, bitangent));
+		glVertexAttribIFormat(5, 4, GL_INT, offsetof(Vertex, boneIDs));
+		glVertexAttribFormat(6, 4, GL_FLOAT, GL_FALSE, offsetof(Vertex, weights));
+		for (GLuint i = 0; i <= 6; i++) {
+			glVertexAttribBinding(i, 0);
+			glEnableVertexAttribArray(i);
+		}
+		return;
+	}
+	// ѹʽǰ16ֽͬlocation 4()ʹãɫ
+	glVertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, offsetof(PackedVertex, position));
+	glVertexAttribFormat(1, 2, GL_SHORT, GL_TRUE, offsetof(PackedVertex, normal));
+	glVertexAttribFormat(2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, texCoords));
+	glVertexAttribFormat(3, 4, GL_BYTE, GL_TRUE, offsetof(PackedVertex, tangent));
+	for (GLuint i = 0; i <= 3; i++) {
+		glVertexAttribBinding(i, 0);
+		glEnableVertexAttribArray(i);
+	}
+	if (layout == VertexLayout::PACKED_SKINNED) {
+		glVertexAttribIFormat(5, 4, GL_UNSIGNED_BYTE, offsetof(PackedSkinnedVertex, boneIDs));
+		glVertexAttribFormat(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(PackedSkinnedVertex, weights));
+		for (GLuint i = 5; i <= 6; i++) {
+			glVertexAttribBinding(i, 0);
+			glEnableVertexAttribArray(i);
+		}
+	}
+	// رյԶȡȫֵĬֵ-1Ȩ0ɫûй
+	glVertexAttribI4i(5, -1, -1, -1, -1);
+	glVertexAttrib4f(6, 0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+MeshArena::Range MeshArena::allocate(const void* vertices, GLuint newVertexCount, const std::vector<GLuint>& indices) {
+	if (!VAO) {
+		init();
+	}
+	GLsizei stride = getStride(layout);
+	if (vertexCount + newVertexCount > vertexCapacity) {
+		GLuint newCapacity = vertexCapacity;
+		while (newCapacity < vertexCount + newVertexCount) newCapacity *= 2;
+		VBO = grow(VBO, (GLsizeiptr)vertexCount * stride, (GLsizeiptr)newCapacity * stride);
+		vertexCapacity = newCapacity;
+		GLState::getInstance().bindVertexArray(VAO);
+		glBindVertexBuffer(0, VBO, 0, stride);
+		GLState::getInstance().bindVertexArray(0);
+	}
+
+	Range range;
+	range.baseVertex = (GLint)vertexCount;
+	range.firstIndex = appendIndices(indices);
+	range.indexCount = (GLuint)indices.size();
+	range.id = rangeCount++;
+	range.layout = layout;
+	range.lods[0] = { range.firstIndex, range.indexCount };
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)vertexCount * stride, (GLsizeiptr)newVertexCount * stride, vertices);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	vertexCount += newVertexCount;
+	return range;
+}
+
+void MeshArena::addLod(Range& range, const std::vector<GLuint>& indices) {
+	if (range.lodCount >= MAX_LODS || indices.empty()) return;
+	range.lods[range.lodCount++] = { appendIndices(indices), (GLuint)indices.size() };
+}
+
+GLuint MeshArena::appendIndices(const std::vector<GLuint>& indices) {
+	if (!VAO) {
+		init();
+	}
+	if (indexCount + indices.size() > indexCapacity) {
+		GLuint newCapacity = indexCapacity;
+		while (newCapacity < indexCount + indices.size()) newCapacity *= 2;
+		EBO = grow(EBO, (GLsizeiptr)indexCount * sizeof(GLuint), (GLsizeiptr)newCapacity * sizeof(GLuint));
+		indexCapacity = newCapacity;
+		GLState::getInstance().bindVertexArray(VAO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		GLState::getInstance().bindVertexArray(0);
+	}
+
+	// ڵľֲ±꣬ʱbaseVertex
+	GLuint firstIndex = indexCount;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)indexCount * sizeof(GLuint), indices.size() * sizeof(GLuint), indices.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	indexCount += (GLuint)indices.size();
+	return firstIndex;
+}
+
+void MeshArena::addMeshlets(Range& range, const std::vector<Meshlet>& meshlets) {
+	if (meshlets.empty()) return;
+	if (!meshletBuffer) {
+		meshletCapacity = 1 << 12;
+		glGenBuffers(1, &meshletBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, meshletBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)meshletCapacity * sizeof(Meshlet), NULL, GL_STATIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+	if (meshletCount + meshlets.size() > meshletCapacity) {
+		GLuint newCapacity = meshletCapacity;
+		while (newCapacity < meshletCount + meshlets.size()) newCapacity *= 2;
+		meshletBuffer = grow(meshletBuffer, (GLsizeiptr)meshletCount * sizeof(Meshlet), (GLsizeiptr)newCapacity * sizeof(Meshlet));
+		meshletCapacity = newCapacity;
+	}
+	std::vector<Meshlet> absolute(meshlets);
+	for (Meshlet& meshlet : absolute) {
+		meshlet.firstIndex += range.firstIndex;
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, meshletBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)meshletCount * sizeof(Meshlet), absolute.size() * sizeof(Meshlet), absolute.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	range.meshletOffset = meshletCount;
+	range.meshletCount = (GLuint)absolute.size();
+	meshletCount += (GLuint)absolute.size();
+}
+
+void MeshArena::setInstanceBuffer(GLuint buffer) {
+	bind();
+	glBindVertexBuffer(1, buffer ? buffer : defaultInstanceBuffer, 0, INSTANCE_STRIDE);
+}
+
+void MeshArena::bind() {
+	if (!VAO) {
+		init();
+	}
+	GLState::getInstance().bindVertexArray(VAO);
+}
+
+GLuint MeshArena::grow(GLuint buffer, GLsizeiptr usedBytes, GLsizeiptr newBytes) {
+	GLuint newBuffer;
+	glGenBuffers(1, &newBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, newBytes, NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	if (usedBytes > 0) {
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glDeleteBuffers(1, &buffer);
+	return newBuffer;
+}
+
+#endif // !MESHARENA_HPP
@@ -83,6 +83,8 @@ MeshPtr MeshGenerator::generateCube() {
 		};
 		computeTangents(cube.vertices, cube.indices);
 		setDefaultBoneData(cube.vertices);
+		// ÿθԸ˹㣬ϲ36Ϊ24
+		cube.optimize();
 		cube.initGLResources();
 	}
 	return std::make_shared<Mesh>(cube);
@@ -133,6 +135,9 @@ MeshPtr MeshGenerator::generateSphere(int sectorCount, int stackCount)
 		sphere.indices = indices;
 		computeTangents(sphere.vertices, sphere.indices);
 		setDefaultBoneData(sphere.vertices);
+		sphere.optimize();
+		sphere.buildLods();
+		sphere.buildMeshlets();
 		sphere.initGLResources();
 	}
 	return std::make_shared<Mesh>(sphere);
@@ -0,0 +1,285 @@
+#ifndef MESHOPTIMIZER_HPP
+#define MESHOPTIMIZER_HPP
+#pragma once
+
+#include "vertex.hpp"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+// ʱŻִУ
+// 1. ϲȫͬĶ
+// 2. TipsifyΣ߶任
+// 3. Իˢ´Ϊ߽ηִأ⡢ĴȻٹȻ
+// 4. һα˳Ŷ㣬߶ȡľֲ
+// ֻб3ıʱԭ
+class MeshOptimizer {
+public:
+	// ACMR: ÿƽĻδ(ԽԽãԼ0.5)
+	// ATVR: δ/(1.0)
+	struct Stats {
+		uint32_t vertexCountBefore = 0, vertexCountAfter = 0;
+		uint32_t triangleCount = 0;
+		float acmrBefore = 0.0f, acmrAfter = 0.0f;
+		float atvrBefore = 0.0f, atvrAfter = 0.0f;
+	};
+	// ģFIFOСTipsifyʹõͬ
+	static const int CACHE_SIZE = 16;
+	// ȻACMRıʱTipsify˳
+	static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+	static Stats optimize(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+
+	static size_t deduplicate(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+	// źclusters¼ÿصʼ
+	static std::vector<GLuint> tipsify(const std::vector<GLuint>& indices, size_t vertexCount, int cacheSize, std::vector<uint32_t>& clusters);
+	static std::vector<GLuint> sortClusters(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, const std::vector<uint32_t>& clusters);
+	static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+	static uint32_t countCacheMisses(const std::vector<GLuint>& indices, size_t vertexCount, int cacheSize);
+private:
+	static float computeAcmr(const std::vector<GLuint>& indices, size_t vertexCount) {
+		return indices.empty() ? 0.0f : (float)countCacheMisses(indices, vertexCount, CACHE_SIZE) / (indices.size() / 3);
+	}
+};
+
+MeshOptimizer::Stats MeshOptimizer::optimize(std::vector<Vertex>& vertices, std::vector<GLuint>& indices) {
+	Stats stats;
+	stats.vertexCountBefore = (uint32_t)vertices.size();
+	stats.triangleCount = (uint32_t)(indices.size() / 3);
+	if (vertices.empty() || indices.empty()) return stats;
+	uint32_t missesBefore = countCacheMisses(indices, vertices.size(), CACHE_SIZE);
+	stats.acmrBefore = (float)missesBefore / stats.triangleCount;
+	stats.atvrBefore = (float)missesBefore / vertices.size();
+
+	if (indices.size() % 3 == 0) {
+		deduplicate(vertices, indices);
+		std::vector<uint32_t> clusters;
+		indices = tipsify(indices, vertices.size(), CACHE_SIZE, clusters);
+		std::vector<GLuint> sorted = sortClusters(vertices, indices, clusters);
+		if (computeAcmr(sorted, vertices.size()) <= computeAcmr(indices, vertices.size()) * OVERDRAW_THRESHOLD) {
+			indices.swap(sorted);
+		}
+		optimizeVertexFetch(vertices, indices);
+	}
+
+	uint32_t missesAfter = countCacheMisses(indices, vertices.size(), CACHE_SIZE);
+	stats.vertexCountAfter = (uint32_t)vertices.size();
+	stats.acmrAfter = (float)missesAfter / stats.triangleCount;
+	stats.atvrAfter = (float)missesAfter / vertices.size();
+	return stats;
+}
+
+size_t MeshOptimizer::deduplicate(std::vector<Vertex>& vertices, std::vector<GLuint>& indices) {
+	// Vertexȫ4ֽڳԱû䣬ֱӰֽڱȽ
+	struct VertexHash {
+		size_t operator()(const Vertex& vertex) const {
+			const unsigned char* bytes = (const unsigned char*)&vertex;
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < sizeof(Vertex); i++) {
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+			}
+			return (size_t)hash;
+		}
+	};
+	struct VertexEqual {
+		bool operator()(const Vertex& a, const Vertex& b) const { return memcmp(&a, &b, sizeof(Vertex)) == 0; }
+	};
+	std::unordered_map<Vertex, GLuint, VertexHash, VertexEqual> unique;
+	unique.reserve(vertices.size());
+	std::vector<GLuint> remap(vertices.size());
+	std::vector<Vertex> result;
+	result.reserve(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		auto [it, inserted] = unique.try_emplace(vertices[i], (GLuint)result.size());
+		if (inserted) {
+			result.push_back(vertices[i]);
+		}
+		remap[i] = it->second;
+	}
+	for (GLuint& index : indices) {
+		index = remap[index];
+	}
+	size_t removed = vertices.size() - result.size();
+	vertices.swap(result);
+	return removed;
+}
+
+std::vector<GLuint> MeshOptimizer::tipsify(const std::vector<GLuint>& indices, size_t vertexCount, int cacheSize, std::vector<uint32_t>& clusters) {
+	// Sander et al. 2007, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+	size_t triangleCount = indices.size() / 3;
+	// 㵽εڽӱ(CSR)
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (GLuint index : indices) {
+		adjacencyOffsets[index + 1]++;
+	}
+	std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++) {
+		adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+	}
+
+	std::vector<int> liveTriangles(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) {
+		liveTriangles[v] = (int)(adjacencyOffsets[v + 1] - adjacencyOffsets[v]);
+	}
+	std::vector<int> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<GLuint> deadEnd;
+	std::vector<GLuint> candidates;
+	std::vector<GLuint> result;
+	result.reserve(indices.size());
+	clusters.clear();
+
+	int timestamp = cacheSize + 1;
+	size_t cursor = 0;
+	long long fanning = 0;
+	bool newCluster = true;
+	// һȡһεĶ
+	while (fanning < (long long)vertexCount && liveTriangles[fanning] == 0) fanning++;
+	if (fanning >= (long long)vertexCount) return indices;
+
+	while (fanning >= 0) {
+		if (newCluster) {
+			clusters.push_back((uint32_t)(result.size() / 3));
+			newCluster = false;
+		}
+		candidates.clear();
+		for (uint32_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++) {
+			uint32_t triangle = adjacency[a];
+			if (emitted[triangle]) continue;
+			for (int k = 0; k < 3; k++) {
+				GLuint v = indices[triangle * 3 + k];
+				result.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+				if (timestamp - cacheTime[v] > cacheSize) {
+					cacheTime[v] = timestamp++;
+				}
+			}
+			emitted[triangle] = true;
+		}
+
+		// ںѡڻչ󲻻ԼĶ㣬ѡ뻺
+		long long next = -1;
+		int best = -1;
+		for (GLuint v : candidates) {
+			if (liveTriangles[v] <= 0) continue;
+			int priority = 0;
+			if (timestamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+				priority = timestamp - cacheTime[v];
+			}
+			if (priority > best) {
+				best = priority;
+				next = v;
+			}
+		}
+		if (next < 0) {
+			// ͬȻĶ㣬˳ɨ裻ﻺֲжϣΪִر߽
+			newCluster = true;
+			while (!deadEnd.empty()) {
+				GLuint v = deadEnd.back();
+				deadEnd.pop_back();
+				if (liveTriangles[v] > 0) {
+					next = v;
+					break;
+				}
+			}
+			while (next < 0 && cursor < vertexCount) {
+				if (liveTriangles[cursor] > 0) {
+					next = (long long)cursor;
+				}
+				cursor++;
+			}
+		}
+		fanning = next;
+	}
+	return result;
+}
+
+std::vector<GLuint> MeshOptimizer::sortClusters(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, const std::vector<uint32_t>& clusters) {
+	size_t triangleCount = indices.size() / 3;
+	if (clusters.size() < 2) return indices;
+	glm::vec3 meshCenter(0.0f);
+	for (const Vertex& vertex : vertices) {
+		meshCenter += vertex.position;
+	}
+	meshCenter /= (float)vertices.size();
+
+	// صڵǱȨķ( - )ĵԽԽӦȻ
+	struct Cluster {
+		uint32_t begin, end;
+		float sortKey;
+	};
+	std::vector<Cluster> sorted;
+	for (size_t c = 0; c < clusters.size(); c++) {
+		Cluster cluster;
+		cluster.begin = clusters[c];
+		cluster.end = c + 1 < clusters.size() ? clusters[c + 1] : (uint32_t)triangleCount;
+		glm::vec3 center(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (uint32_t t = cluster.begin; t < cluster.end; t++) {
+			const glm::vec3& a = vertices[indices[t * 3]].position;
+			const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+			const glm::vec3& c3 = vertices[indices[t * 3 + 2]].position;
+			glm::vec3 n = glm::cross(b - a, c3 - a);
+			float triangleArea = glm::length(n);
+			center += (a + b + c3) / 3.0f * triangleArea;
+			normal += n;
+			area += triangleArea;
+		}
+		if (area > 0.0f) {
+			center /= area;
+		}
+		float length = glm::length(normal);
+		cluster.sortKey = length > 0.0f ? glm::dot(center - meshCenter, normal / length) : 0.0f;
+		sorted.push_back(cluster);
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+	std::vector<GLuint> result;
+	result.reserve(indices.size());
+	for (const Cluster& cluster : sorted) {
+		result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+	}
+	return result;
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices) {
+	const GLuint UNUSED = ~0u;
+	std::vector<GLuint> remap(vertices.size(), UNUSED);
+	std::vector<Vertex> result;
+	result.reserve(vertices.size());
+	for (GLuint& index : indices) {
+		if (remap[index] == UNUSED) {
+			remap[index] = (GLuint)result.size();
+			result.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	// ûбõĶֱӶ
+	vertices.swap(result);
+}
+
+uint32_t MeshOptimizer::countCacheMisses(const std::vector<GLuint>& indices, size_t vertexCount, int cacheSize) {
+	// FIFO棺¼ÿ뻺ʱ䣬cacheSizeβΪѱ
+	std::vector<uint32_t> insertTime(vertexCount, 0);
+	uint32_t time = (uint32_t)cacheSize + 1;
+	uint32_t misses = 0;
+	for (GLuint index : indices) {
+		if (index >= vertexCount) continue;
+		if (time - insertTime[index] > (uint32_t)cacheSize) {
+			insertTime[index] = time++;
+			misses++;
+		}
+	}
+	return misses;
+}
+
+#endif // !MESHOPTIMIZER_HPP
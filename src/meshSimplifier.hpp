@@ -0,0 +1,238 @@
+#ifndef MESHSIMPLIFIER_HPP
+#define MESHSIMPLIFIER_HPP
+#pragma once
+
+#include "vertex.hpp"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+// ڶ(Garland & Heckbert 1997)
+// ֻ۵һϲڶϣ㻺岻䣬ֻµ
+// LODԹͬһζ
+// ߽UV/߽ӷϵĶ(ͬһλж)ᱻߣѷ
+class MeshSimplifier {
+public:
+	// 򻯵targetIndexCountң۵targetError(԰ΧжԽ)ʱǰֹͣ
+	// errorʵʵ(ֵͬ)
+	static std::vector<GLuint> simplify(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices,
+		size_t targetIndexCount, float targetError, float& error);
+private:
+	struct Quadric {
+		double a2 = 0, ab = 0, ac = 0, ad = 0;
+		double b2 = 0, bc = 0, bd = 0;
+		double c2 = 0, cd = 0;
+		double d2 = 0;
+		void addPlane(const glm::dvec3& n, double d, double weight);
+		void add(const Quadric& q);
+		double evaluate(const glm::vec3& p) const;
+	};
+	struct Collapse {
+		GLuint from, to;
+		double cost;
+	};
+	static bool flips(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, const uint32_t* triangles,
+		uint32_t triangleCount, GLuint from, GLuint to);
+};
+
+void MeshSimplifier::Quadric::addPlane(const glm::dvec3& n, double d, double weight) {
+	a2 += n.x * n.x * weight; ab += n.x * n.y * weight; ac += n.x * n.z * weight; ad += n.x * d * weight;
+	b2 += n.y * n.y * weight; bc += n.y * n.z * weight; bd += n.y * d * weight;
+	c2 += n.z * n.z * weight; cd += n.z * d * weight;
+	d2 += d * d * weight;
+}
+
+void MeshSimplifier::Quadric::add(const Quadric& q) {
+	a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+	b2 += q.b2; bc += q.bc; bd += q.bd;
+	c2 += q.c2; cd += q.cd;
+	d2 += q.d2;
+}
+
+double MeshSimplifier::Quadric::evaluate(const glm::vec3& p) const {
+	double x = p.x, y = p.y, z = p.z;
+	double result = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+		+ b2 * y * y + 2 * bc * y * z + 2 * bd * y
+		+ c2 * z * z + 2 * cd * z + d2;
+	return std::max(result, 0.0);
+}
+
+bool MeshSimplifier::flips(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, const uint32_t* triangles,
+	uint32_t triangleCount, GLuint from, GLuint to) {
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		const GLuint* triangle = &indices[triangles[t] * 3];
+		if (triangle[0] == to || triangle[1] == to || triangle[2] == to) continue; // ۵˻ᱻɾ
+		glm::vec3 p[3], q[3];
+		for (int k = 0; k < 3; k++) {
+			p[k] = vertices[triangle[k]].position;
+			q[k] = triangle[k] == from ? vertices[to].position : p[k];
+		}
+		glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+		glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+		// ߷ת߼˻
+		if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after)) return true;
+	}
+	return false;
+}
+
+std::vector<GLuint> MeshSimplifier::simplify(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices,
+	size_t targetIndexCount, float targetError, float& error) {
+	error = 0.0f;
+	size_t vertexCount = vertices.size();
+	std::vector<GLuint> result = indices;
+	if (indices.size() % 3 != 0 || indices.size() <= targetIndexCount || vertexCount == 0) return result;
+
+	glm::vec3 minPos(FLT_MAX), maxPos(-FLT_MAX);
+	for (const Vertex& vertex : vertices) {
+		minPos = glm::min(minPos, vertex.position);
+		maxPos = glm::max(maxPos, vertex.position);
+	}
+	double extent = glm::length(maxPos - minPos);
+	if (extent <= 0.0) return result;
+
+	// ͬһλõĶΪһ飬ڲҽӷͱ߽
+	struct PositionHash {
+		size_t operator()(const glm::vec3& p) const {
+			uint32_t bits[3];
+			memcpy(bits, &p, sizeof(bits));
+			return (size_t)(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+		}
+	};
+	std::unordered_map<glm::vec3, GLuint, PositionHash> positions;
+	positions.reserve(vertexCount);
+	std::vector<GLuint> positionId(vertexCount);
+	std::vector<uint32_t> positionUses;
+	for (size_t i = 0; i < vertexCount; i++) {
+		auto [it, inserted] = positions.try_emplace(vertices[i].position, (GLuint)positionUses.size());
+		if (inserted) positionUses.push_back(0);
+		positionId[i] = it->second;
+		positionUses[it->second]++;
+	}
+	std::vector<bool> locked(vertexCount, false);
+	for (size_t i = 0; i < vertexCount; i++) {
+		locked[i] = positionUses[positionId[i]] > 1;
+	}
+	// ֻһεıǱ߽磬˶
+	std::unordered_map<uint64_t, int> edges;
+	edges.reserve(indices.size());
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		for (int k = 0; k < 3; k++) {
+			uint64_t a = positionId[indices[i + k]], b = positionId[indices[i + (k + 1) % 3]];
+			edges[std::min(a, b) << 32 | std::max(a, b)]++;
+		}
+	}
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		for (int k = 0; k < 3; k++) {
+			GLuint a = indices[i + k], b = indices[i + (k + 1) % 3];
+			uint64_t pa = positionId[a], pb = positionId[b];
+			if (edges[std::min(pa, pb) << 32 | std::max(pa, pb)] == 1) {
+				locked[a] = locked[b] = true;
+			}
+		}
+	}
+
+	// ÿۼƽĶȨ
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		glm::dvec3 p0 = vertices[indices[i]].position, p1 = vertices[indices[i + 1]].position, p2 = vertices[indices[i + 2]].position;
+		glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+		double area = glm::length(normal);
+		if (area <= 0.0) continue;
+		normal /= area;
+		Quadric q;
+		q.addPlane(normal, -glm::dot(normal, p0), area);
+		for (int k = 0; k < 3; k++) {
+			quadrics[indices[i + k]].add(q);
+		}
+	}
+
+	double maxCost = (double)targetError * extent;
+	maxCost *= maxCost;
+	double resultCost = 0.0;
+	std::vector<uint32_t> adjacencyOffsets, adjacency, fill;
+	std::vector<Collapse> collapses;
+	std::vector<GLuint> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	// ÿһ˰򣬻ڵ۵һִУȻؽ
+	while (result.size() > targetIndexCount) {
+		adjacencyOffsets.assign(vertexCount + 1, 0);
+		for (GLuint index : result) {
+			adjacencyOffsets[index + 1]++;
+		}
+		std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+		adjacency.resize(result.size());
+		fill.assign(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < result.size(); i++) {
+			adjacency[fill[result[i]]++] = (uint32_t)(i / 3);
+		}
+
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int k = 0; k < 3; k++) {
+				GLuint a = result[i + k];
+				if (locked[a]) continue;
+				for (int j = 1; j < 3; j++) {
+					GLuint b = result[i + (k + j) % 3];
+					Quadric q = quadrics[a];
+					q.add(quadrics[b]);
+					collapses.push_back({ a, b, q.evaluate(vertices[b].position) });
+				}
+			}
+		}
+		// ÿ۵ԼȥΣһֻҪ˵һ
+		auto cheaper = [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; };
+		size_t needed = std::min(collapses.size(), std::max<size_t>((result.size() - targetIndexCount) / 3 * 2, 64));
+		std::nth_element(collapses.begin(), collapses.begin() + (needed - 1), collapses.end(), cheaper);
+		collapses.resize(needed);
+		std::sort(collapses.begin(), collapses.end(), cheaper);
+
+		for (size_t i = 0; i < vertexCount; i++) {
+			remap[i] = (GLuint)i;
+		}
+		touched.assign(vertexCount, false);
+		size_t triangles = result.size() / 3;
+		size_t targetTriangles = targetIndexCount / 3;
+		size_t applied = 0;
+		for (const Collapse& collapse : collapses) {
+			if (collapse.cost > maxCost || triangles <= targetTriangles) break;
+			if (touched[collapse.from] || touched[collapse.to]) continue;
+			const uint32_t* around = adjacency.data() + adjacencyOffsets[collapse.from];
+			uint32_t aroundCount = adjacencyOffsets[collapse.from + 1] - adjacencyOffsets[collapse.from];
+			if (flips(vertices, result, around, aroundCount, collapse.from, collapse.to)) continue;
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			// һΧβٱ仯֤תȻЧ
+			for (uint32_t t = 0; t < aroundCount; t++) {
+				const GLuint* triangle = &result[around[t] * 3];
+				touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+					triangles--;
+				}
+			}
+			resultCost = std::max(resultCost, collapse.cost);
+			applied++;
+		}
+		if (applied == 0) break;
+
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			GLuint a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+			if (a == b || b == c || a == c) continue;
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+	error = (float)(std::sqrt(resultCost) / extent);
+	return result;
+}
+
+#endif // !MESHSIMPLIFIER_HPP
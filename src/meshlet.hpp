@@ -0,0 +1,123 @@
+#ifndef MESHLET_HPP
+#define MESHLET_HPP
+#pragma once
+
+#include "vertex.hpp"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// ˳гɵС飬GPU޳Сλ
+// ֺɫеstd430ṹһ£ֱϴ
+struct Meshlet {
+	glm::vec3 center;   // ΧģͿռ
+	float radius;
+	glm::vec3 coneAxis; // ׶coneAxisΪ0ʱ޳
+	float coneCutoff;
+	GLuint firstIndex;  // LOD0㣬ϴʱɷеľλ
+	GLuint indexCount;
+	GLuint vertexCount;
+	GLuint padding;
+};
+
+// LOD0ԭ˳гСΣ·䶥meshletֻ¼һķΧ
+// optimize֮˳Ѿֲźãδ๲㣬гĿȽϽ
+class MeshletBuilder {
+public:
+	static const int MAX_VERTICES = 64;
+	static const int MAX_TRIANGLES = 124;
+	// ׶Žǽӽʱ޳ãֱӹر
+	static constexpr float MIN_CONE_DOT = 0.1f;
+
+	static std::vector<Meshlet> build(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices);
+private:
+	static Meshlet finish(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, GLuint firstIndex, GLuint indexCount, GLuint vertexCount);
+};
+
+std::vector<Meshlet> MeshletBuilder::build(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices) {
+	std::vector<Meshlet> meshlets;
+	if (vertices.empty() || indices.size() < 3 || indices.size() % 3 != 0) return meshlets;
+	// ¼ÿĸmeshletͳƿڲظĶ
+	std::vector<uint32_t> stamp(vertices.size(), UINT32_MAX);
+	uint32_t current = 0;
+	GLuint begin = 0;
+	GLuint vertexCount = 0;
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		int newVertices = 0;
+		for (int k = 0; k < 3; k++) {
+			if (stamp[indices[i + k]] != current) newVertices++;
+		}
+		GLuint triangles = (GLuint)(i - begin) / 3;
+		if (triangles > 0 && (vertexCount + newVertices > MAX_VERTICES || triangles >= MAX_TRIANGLES)) {
+			meshlets.push_back(finish(vertices, indices, begin, (GLuint)i - begin, vertexCount));
+			current++;
+			begin = (GLuint)i;
+			vertexCount = 0;
+		}
+		for (int k = 0; k < 3; k++) {
+			if (stamp[indices[i + k]] != current) {
+				stamp[indices[i + k]] = current;
+				vertexCount++;
+			}
+		}
+	}
+	meshlets.push_back(finish(vertices, indices, begin, (GLuint)indices.size() - begin, vertexCount));
+	return meshlets;
+}
+
+Meshlet MeshletBuilder::finish(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, GLuint firstIndex, GLuint indexCount, GLuint vertexCount) {
+	Meshlet meshlet = {};
+	meshlet.firstIndex = firstIndex;
+	meshlet.indexCount = indexCount;
+	meshlet.vertexCount = vertexCount;
+
+	// ΧȡΧģ뾶ǵԶľ
+	glm::vec3 minPos(FLT_MAX), maxPos(-FLT_MAX);
+	for (GLuint i = firstIndex; i < firstIndex + indexCount; i++) {
+		minPos = glm::min(minPos, vertices[indices[i]].position);
+		maxPos = glm::max(maxPos, vertices[indices[i]].position);
+	}
+	meshlet.center = (minPos + maxPos) * 0.5f;
+	float radius2 = 0.0f;
+	for (GLuint i = firstIndex; i < firstIndex + indexCount; i++) {
+		glm::vec3 d = vertices[indices[i]].position - meshlet.center;
+		radius2 = std::max(radius2, glm::dot(d, d));
+	}
+	meshlet.radius = std::sqrt(radius2);
+
+	// ׶ȡελߵƽŽɺнķ߾
+	std::vector<glm::vec3> normals;
+	normals.reserve(indexCount / 3);
+	glm::vec3 axis(0.0f);
+	for (GLuint i = firstIndex; i < firstIndex + indexCount; i += 3) {
+		const glm::vec3& a = vertices[indices[i]].position;
+		const glm::vec3& b = vertices[indices[i + 1]].position;
+		const glm::vec3& c = vertices[indices[i + 2]].position;
+		glm::vec3 n = glm::cross(b - a, c - a);
+		float length = glm::length(n);
+		if (length <= 0.0f) continue;
+		normals.push_back(n / length);
+		axis += normals.back();
+	}
+	float axisLength = glm::length(axis);
+	meshlet.coneAxis = glm::vec3(0.0f);
+	meshlet.coneCutoff = 1.0f;
+	if (normals.empty() || axisLength <= 0.0f) return meshlet;
+	axis /= axisLength;
+	float minDot = 1.0f;
+	for (const glm::vec3& n : normals) {
+		minDot = std::min(minDot, glm::dot(axis, n));
+	}
+	if (minDot <= MIN_CONE_DOT) return meshlet;
+	// ΧķļнС(90 - Ž)ʱζ
+	// dot(center - camera, axis) >= cutoff * |center - camera| + radiuscutoff = sin(Ž)
+	meshlet.coneAxis = axis;
+	meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+	return meshlet;
+}
+
+#endif // !MESHLET_HPP
@@ -0,0 +1,202 @@
+#ifndef MESHLETCULLER_HPP
+#define MESHLETCULLER_HPP
+#pragma once
+
+#include "camera.hpp"
+#include "depthPyramid.hpp"
+#include "meshArena.hpp"
+#include "shader.hpp"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// GPUmeshlet޳ÿʵһ飬meshlet׶׶һ֡Hi-Zԣ
+// ɼmeshlet׷һӻ(ԭӼѹ)Ȼ󰴼ύӻ
+// ģ;ֱӶȡDrawBatcherϴSSBO(binding 6)ÿʽڸԵһ
+class MeshletCuller {
+public:
+	MeshletCuller() = default;
+	void init();
+	// occlusionΪջûйʱڵ
+	void begin(const ShaderPtr& cullShader, const Frustum& frustum, const glm::vec3& cameraPos, bool coneCulling, const DepthPyramid* occlusion);
+	void add(const MeshArena::Range& range, unsigned int transformIndex, unsigned int materialIndex);
+	bool empty() const { return instanceCount == 0; }
+	// ģ;Ѿϴ֮ãύļӻƴ
+	int submit(const ShaderPtr& shader);
+	// ޳һsubmitѹٻһ(Ԥ֮ɫpass)
+	// ÷Ҫ֤ģ;±һsubmitʱһ
+	int redraw(const ShaderPtr& shader);
+
+	int getInstanceCount() const { return instanceCount; }
+	int getTestedMeshlets() const { return testedMeshlets; }
+	// ɼGPUأһ֡Ľȴ֡ļ
+	int getVisibleMeshlets() const { return visibleMeshlets; }
+private:
+	// meshletCull.compеCullInstanceһ
+	struct Instance {
+		GLuint transformIndex;
+		GLuint materialIndex;
+		GLuint meshletOffset;
+		GLuint meshletCount;
+		GLint baseVertex;
+	};
+	static const GLuint MESHLET_BINDING = 8, INSTANCE_BINDING = 9, COMMAND_BINDING = 10, DRAW_DATA_BINDING = 11, COUNT_BINDING = 12;
+
+	GLuint instanceBuffer = 0, commandBuffer = 0, drawDataBuffer = 0, countBuffer = 0;
+	GLuint readbackBuffers[2] = {};
+	int frame = 0;
+
+	ShaderPtr cullShader;
+	glm::vec4 frustumPlanes[6];
+	glm::vec3 cameraPos = glm::vec3(0.0f);
+	bool coneCulling = true;
+	const DepthPyramid* occlusion = nullptr;
+
+	std::vector<Instance> instances[(int)VertexLayout::COUNT];
+	int instanceCount = 0;
+	// ÿָʽδcommandBaseʼǸøʽʵmeshlet֮
+	GLuint commandBase[(int)VertexLayout::COUNT] = {};
+	GLuint commandTotal = 0;
+	int testedMeshlets = 0, visibleMeshlets = 0;
+};
+
+void MeshletCuller::init() {
+	glGenBuffers(1, &instanceBuffer);
+	glGenBuffers(1, &commandBuffer);
+	glGenBuffers(1, &drawDataBuffer);
+	glGenBuffers(1, &countBuffer);
+	glGenBuffers(2, readbackBuffers);
+	GLuint zero[(int)VertexLayout::COUNT] = {};
+	glBindBuffer(GL_COPY_WRITE_BUFFER, countBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, sizeof(zero), zero, GL_DYNAMIC_DRAW);
+	for (GLuint buffer : readbackBuffers) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, sizeof(zero), zero, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void MeshletCuller::begin(const ShaderPtr& cullShader, const Frustum& frustum, const glm::vec3& cameraPos, bool coneCulling, const DepthPyramid* occlusion) {
+	this->cullShader = cullShader;
+	frustumPlanes[0] = frustum.leftPlane;
+	frustumPlanes[1] = frustum.rightPlane;
+	frustumPlanes[2] = frustum.bottomPlane;
+	frustumPlanes[3] = frustum.topPlane;
+	frustumPlanes[4] = frustum.nearPlane;
+	frustumPlanes[5] = frustum.farPlane;
+	this->cameraPos = cameraPos;
+	this->coneCulling = coneCulling;
+	this->occlusion = occlusion && occlusion->isValid() ? occlusion : nullptr;
+	for (std::vector<Instance>& list : instances) {
+		list.clear();
+	}
+	instanceCount = 0;
+	testedMeshlets = 0;
+}
+
+void MeshletCuller::add(const MeshArena::Range& range, unsigned int transformIndex, unsigned int materialIndex) {
+	instances[(int)range.layout].push_back({ transformIndex, materialIndex, range.meshletOffset, range.meshletCount, range.baseVertex });
+	instanceCount++;
+	testedMeshlets += (int)range.meshletCount;
+}
+
+int MeshletCuller::submit(const ShaderPtr& shader) {
+	if (instanceCount == 0) return 0;
+	// ȡһ֡ļGPUִ꣬
+	GLuint counts[(int)VertexLayout::COUNT] = {};
+	glBindBuffer(GL_COPY_READ_BUFFER, readbackBuffers[(frame + 1) % 2]);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(counts), counts);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	visibleMeshlets = 0;
+	for (GLuint count : counts) {
+		visibleMeshlets += (int)count;
+	}
+
+	commandTotal = 0;
+	std::vector<Instance> packed;
+	packed.reserve(instanceCount);
+	for (int layout = 0; layout < (int)VertexLayout::COUNT; layout++) {
+		commandBase[layout] = commandTotal;
+		for (const Instance& instance : instances[layout]) {
+			commandTotal += instance.meshletCount;
+		}
+		packed.insert(packed.end(), instances[layout].begin(), instances[layout].end());
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, packed.size() * sizeof(Instance), packed.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)commandTotal * sizeof(DrawElementsIndirectCommand), NULL, GL_STREAM_DRAW);
+	if (!GLAD_GL_VERSION_4_6) {
+		// ûаʱύȫδдcountΪ0ͼԪ
+		glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawDataBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)commandTotal * sizeof(glm::uvec2), NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, countBuffer);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, instanceBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, drawDataBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNT_BINDING, countBuffer);
+
+	cullShader->use();
+	cullShader->setVec4Array("frustumPlanes", frustumPlanes, 6);
+	cullShader->setVec3("cameraPos", cameraPos);
+	cullShader->setBool("coneCulling", coneCulling);
+	cullShader->setBool("occlusionCulling", occlusion != nullptr);
+	if (occlusion) {
+		GLState::getInstance().bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, occlusion->getTexture());
+		cullShader->setInt("hiZ", 0);
+		cullShader->setMat4("hiZViewProj", occlusion->getViewProj());
+		cullShader->setVec2("hiZSize", occlusion->getSize());
+	}
+	GLuint instanceOffset = 0;
+	for (int layout = 0; layout < (int)VertexLayout::COUNT; layout++) {
+		if (instances[layout].empty()) continue;
+		// meshletڸԵķ
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESHLET_BINDING, MeshArena::get((VertexLayout)layout).getMeshletBuffer());
+		cullShader->setInt("layoutIndex", layout);
+		cullShader->setInt("commandBase", (int)commandBase[layout]);
+		cullShader->setInt("instanceOffset", (int)instanceOffset);
+		glDispatchCompute((GLuint)instances[layout].size(), 1, 1);
+		instanceOffset += (GLuint)instances[layout].size();
+	}
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_COPY_READ_BUFFER, countBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, readbackBuffers[frame % 2]);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(counts));
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	frame++;
+	return redraw(shader);
+}
+
+int MeshletCuller::redraw(const ShaderPtr& shader) {
+	if (instanceCount == 0) return 0;
+	int drawCalls = 0;
+	shader->use();
+	shader->setBool("useDrawData", true);
+	shader->setBool("useMaterialTable", true);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glBindBuffer(GL_PARAMETER_BUFFER, countBuffer);
+	for (int layout = 0; layout < (int)VertexLayout::COUNT; layout++) {
+		if (instances[layout].empty()) continue;
+		GLuint maxCount = (layout + 1 < (int)VertexLayout::COUNT ? commandBase[layout + 1] : commandTotal) - commandBase[layout];
+		MeshArena::get((VertexLayout)layout).setInstanceBuffer(drawDataBuffer);
+		const void* offset = (const void*)(commandBase[layout] * sizeof(DrawElementsIndirectCommand));
+		if (GLAD_GL_VERSION_4_6) {
+			glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, offset, (GLintptr)(layout * sizeof(GLuint)), (GLsizei)maxCount, 0);
+		}
+		else {
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, offset, (GLsizei)maxCount, 0);
+		}
+		drawCalls++;
+	}
+	glBindBuffer(GL_PARAMETER_BUFFER, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	return drawCalls;
+}
+
+#endif // !MESHLETCULLER_HPP
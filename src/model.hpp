@@ -2,29 +2,40 @@
 #define MODEL_HPP
 #pragma once
 
+#include "drawBatcher.hpp"
 #include "material.hpp"
 #include "mesh.hpp"
 #include "utils.hpp"
 #include "assimpNode.hpp"
 #include "animation.hpp"
+#include "mappedFile.hpp"
 #include <unordered_map>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
-#include <future>
+#include <memory>
 
 class Model
 {
 public:
 	Model() = default;
-	// 첽Դ
-	static std::future<std::shared_ptr<Model>> LoadAsync(const char* path);
-	// ̵߳ãʼopenglԴ
+	// ߳importȡڵ㡢Ͳʣ
+	// ĶbuildMesh̳߳вɣ߳setMeshϴȫɺinitGLResources
+	// ʧܷؿ
+	static std::shared_ptr<Model> import(const std::string& path);
+	size_t getMeshCount() const { return meshes.size(); }
+	// ֻȡͬͬʱ
+	MeshPtr buildMesh(size_t index) const;
+	// ̵߳ãϴһ
+	void setMesh(size_t index, MeshPtr mesh);
+	// ̵߳ãʼûϴͲʣͷŵõĳ
 	bool initGLResources();
 
 	std::string getPath() { return path; }
 	std::string getName() { return name; }
-	void draw(ShaderPtr shader);
+	void draw(const ShaderPtr& shader);
+	// ΣtransformIndexӦģ;
+	void addToBatch(DrawBatcher& batcher, unsigned int transformIndex);
 	bool isReady() const { return loaded && glInitialized; }
 	void buildAABB(glm::vec3& min, glm::vec3& max);
 	Node* findNode(std::string name);
@@ -32,6 +43,9 @@ public:
 	std::vector<Animation>& getAnimations() { return animations; }
 	Texture2D& getBoneMatrixTexture() { return boneMatrixTexture; }
 private:
+	// дԤҪ
+	friend class ModelCache;
+
 	bool loaded = false, glInitialized = false;
 
 	std::unordered_map<unsigned int, Material> materials;
@@ -43,28 +57,90 @@ private:
 	std::string directory;
 	std::string name;
 
-	void loadModel(std::string path);
+	// ڼ䱣ɺͷ
+	struct MeshTask {
+		aiMesh* mesh;
+		glm::mat4 nodeTransform;
+		std::vector<int> boneIDs; // mesh->mBonesһһӦĽڵ
+	};
+	std::unique_ptr<Assimp::Importer> importer;
+	const aiScene* scene = nullptr;
+	std::vector<MeshTask> meshTasks;
+	// Ԥ浼ʱֱָӳļ
+	struct CookedLod {
+		const GLuint* indices;
+		GLuint indexCount;
+		float error;
+	};
+	struct CookedMesh {
+		const Vertex* vertices;
+		GLuint vertexCount;
+		const GLuint* indices;
+		GLuint indexCount;
+		unsigned int materialIndex;
+		MeshOptimizer::Stats optimizeStats;
+		std::vector<CookedLod> lods;
+		const Meshlet* meshlets;
+		GLuint meshletCount;
+	};
+	std::unique_ptr<MappedFile> cookedFile;
+	std::vector<CookedMesh> cookedMeshes;
+
+	bool loadModel(std::string path);
 	void processNode(aiNode* node, const aiScene* scene, int parentIndex);
-	Mesh processMesh(aiMesh* mesh, const aiScene* scene, glm::mat4 nodeTransform);
+	// ڵͲʻ޸Ĺnodesmaterialsڱڵʱ˳
+	std::vector<int> registerBones(aiMesh* mesh);
+	void registerMaterial(aiMesh* mesh, const aiScene* scene);
+	Mesh processMesh(const MeshTask& task) const;
 
 	Texture2D boneMatrixTexture;
 };
 
-std::future<std::shared_ptr<Model>> Model::LoadAsync(const char* path) {
-	std::string modelPathStr(path);
-	return std::async(std::launch::async, [modelPathStr]() {
-		auto model = std::make_shared<Model>();
-		model->loadModel(modelPathStr.c_str());
-		return model;
-		});
+std::shared_ptr<Model> Model::import(const std::string& path) {
+	auto model = std::make_shared<Model>();
+	if (!model->loadModel(path)) {
+		return nullptr;
+	}
+	return model;
+}
+
+MeshPtr Model::buildMesh(size_t index) const
+{
+	if (!cookedMeshes.empty()) {
+		// 鿽
+		const CookedMesh& cooked = cookedMeshes[index];
+		auto mesh = std::make_shared<Mesh>();
+		mesh->vertices.assign(cooked.vertices, cooked.vertices + cooked.vertexCount);
+		mesh->indices.assign(cooked.indices, cooked.indices + cooked.indexCount);
+		mesh->setMaterialIndex(cooked.materialIndex);
+		mesh->setOptimizeStats(cooked.optimizeStats);
+		for (const CookedLod& lod : cooked.lods) {
+			mesh->lods.emplace_back(lod.indices, lod.indices + lod.indexCount);
+			mesh->lodErrors.push_back(lod.error);
+		}
+		mesh->meshlets.assign(cooked.meshlets, cooked.meshlets + cooked.meshletCount);
+		return mesh;
+	}
+	return std::make_shared<Mesh>(processMesh(meshTasks[index]));
+}
+
+void Model::setMesh(size_t index, MeshPtr mesh)
+{
+	meshes[index] = mesh;
+	if (mesh && !mesh->isReady()) {
+		mesh->initGLResources();
+	}
 }
 
 bool Model::initGLResources()
 {
-	if (!loaded || glInitialized) return false;
+	if (glInitialized || (!scene && !cookedFile)) return false;
 
-	for (auto& mesh : meshes) {
-		if (!mesh->initGLResources()) {
+	for (size_t i = 0; i < meshes.size(); i++) {
+		if (!meshes[i]) {
+			setMesh(i, buildMesh(i));
+		}
+		if (!meshes[i]->isReady()) {
 			std::cerr << "Failed to initialize mesh GL resources\n";
 			return false;
 		}
@@ -72,11 +148,17 @@ bool Model::initGLResources()
 	for (auto it = materials.begin(); it != materials.end(); ++it) {
 		it->second.initGLResources();
 	}
+	meshTasks.clear();
+	importer.reset();
+	scene = nullptr;
+	cookedMeshes.clear();
+	cookedFile.reset();
+	loaded = true;
 	glInitialized = true;
 	return true;
 }
 
-void Model::draw(ShaderPtr shader)
+void Model::draw(const ShaderPtr& shader)
 {
 	for (unsigned int i = 0; i < meshes.size(); i++)
 	{
@@ -88,6 +170,15 @@ void Model::draw(ShaderPtr shader)
 	}
 }
 
+void Model::addToBatch(DrawBatcher& batcher, unsigned int transformIndex)
+{
+	for (auto& mesh : meshes) {
+		if (!mesh->isReady()) continue;
+		auto material = materials.find(mesh->getMaterialIndex());
+		batcher.add(*mesh, material != materials.end() ? &material->second : nullptr, transformIndex);
+	}
+}
+
 void Model::buildAABB(glm::vec3& min, glm::vec3& max)
 {
 	// ʼminmaxΪֵ
@@ -108,14 +199,14 @@ void Model::buildAABB(glm::vec3& min, glm::vec3& max)
 	}
 }
 
-void Model::loadModel(std::string path)
+bool Model::loadModel(std::string path)
 {
-	Assimp::Importer importer;
-	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_CalcTangentSpace);
+	importer = std::make_unique<Assimp::Importer>();
+	scene = importer->ReadFile(path, aiProcess_Triangulate | aiProcess_CalcTangentSpace);
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
 	{
-		std::cerr << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
-		return;
+		std::cerr << "ERROR::ASSIMP::" << importer->GetErrorString() << std::endl;
+		return false;
 	}
 	this->path = path;
 	directory = path.substr(0, path.find_last_of('\\')) + "\\";
@@ -124,8 +215,8 @@ void Model::loadModel(std::string path)
 	for(auto i = 0; i<scene->mNumAnimations; i++) {
 		animations.emplace_back(scene->mAnimations[i], nodes);
 	}
-	importer.FreeScene();
-	loaded = true;
+	meshes.resize(meshTasks.size());
+	return true;
 }
 
 void Model::processNode(aiNode* node, const aiScene* scene, int parentIndex)
@@ -178,14 +269,75 @@ void Model::processNode(aiNode* node, const aiScene* scene, int parentIndex)
 			nodeTransform = AssimpGLMHelpers::ConvertMatrixToGLMFormat(parent->mTransformation) * nodeTransform;
 			parent = parent->mParent;
 		}
-		MeshPtr meshPtr = std::make_shared<Mesh>(processMesh(mesh, scene, nodeTransform));
-		meshes.push_back(meshPtr);
+		std::vector<int> boneIDs = registerBones(mesh);
+		registerMaterial(mesh, scene);
+		meshTasks.push_back({ mesh, nodeTransform, boneIDs });
+	}
+}
+
+std::vector<int> Model::registerBones(aiMesh* mesh)
+{
+	std::vector<int> boneIDs;
+	for (int boneIndex = 0; boneIndex < mesh->mNumBones; boneIndex++) {
+		int boneID = -1;
+		std::string boneName = mesh->mBones[boneIndex]->mName.C_Str();
+		if (findNode(boneName) == nullptr) {
+			Node node;
+			node.name = boneName;
+			node.id = static_cast<int>(nodes.size());
+			node.parentIndex = -1;
+			node.transform = glm::mat4(1.0f);
+			node.offsetMatrix = AssimpGLMHelpers::ConvertMatrixToGLMFormat(mesh->mBones[boneIndex]->mOffsetMatrix);
+			node.position = glm::vec3(0.0f);
+			node.isBoneNode = true;
+			nodes.push_back(node);
+			boneID = node.id;
+		}
+		else {
+			auto it = std::find_if(nodes.begin(), nodes.end(), [&boneName](const Node& node) {
+				return node.name == boneName;
+				});
+			if (it != nodes.end()) {
+				it->offsetMatrix = AssimpGLMHelpers::ConvertMatrixToGLMFormat(mesh->mBones[boneIndex]->mOffsetMatrix);
+				it->isBoneNode = true;
+				boneID = it->id;
+			}
+		}
+		assert(boneID != -1);
+		boneIDs.push_back(boneID);
+	}
+	return boneIDs;
+}
+
+void Model::registerMaterial(aiMesh* mesh, const aiScene* scene)
+{
+	if (mesh->mMaterialIndex >= 0)
+	{
+		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+		if (materials.find(mesh->mMaterialIndex) == materials.end()) {
+			aiString albedoPath;
+			material->GetTexture(aiTextureType_DIFFUSE, 0, &albedoPath);
+			aiString ambientPath;
+			material->GetTexture(aiTextureType_AMBIENT, 0, &ambientPath);
+			aiString specularPath;
+			material->GetTexture(aiTextureType_SPECULAR, 0, &specularPath);
+			aiString normalPath;
+			material->GetTexture(aiTextureType_HEIGHT, 0, &normalPath);
+			aiString shininessPath;
+			material->GetTexture(aiTextureType_SHININESS, 0, &shininessPath);
+			materials.emplace(mesh->mMaterialIndex, Material(mesh->mMaterialIndex, directory + albedoPath.C_Str(), directory + ambientPath.C_Str(),
+				directory + specularPath.C_Str(), directory + normalPath.C_Str(), directory + shininessPath.C_Str()));
+		}
 	}
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene, glm::mat4 nodeTransform)
+Mesh Model::processMesh(const MeshTask& task) const
 {
 	Mesh result;
+	const aiMesh* mesh = task.mesh;
+	const glm::mat4& nodeTransform = task.nodeTransform;
+	result.vertices.reserve(mesh->mNumVertices);
+	result.indices.reserve((size_t)mesh->mNumFaces * 3);
 
 	for (unsigned int i = 0; i < mesh->mNumVertices; i++)
 	{
@@ -248,31 +400,7 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene, glm::mat4 nodeTransf
 	}
 
 	for (int boneIndex = 0; boneIndex < mesh->mNumBones; boneIndex++) {
-		int boneID = -1;
-		std::string boneName = mesh->mBones[boneIndex]->mName.C_Str();
-		if (findNode(boneName) == nullptr) {
-			Node node;
-			node.name = boneName;
-			node.id = static_cast<int>(nodes.size());
-			node.parentIndex = -1;
-			node.transform = glm::mat4(1.0f);
-			node.offsetMatrix = AssimpGLMHelpers::ConvertMatrixToGLMFormat(mesh->mBones[boneIndex]->mOffsetMatrix);
-			node.position = glm::vec3(0.0f);
-			node.isBoneNode = true;
-			nodes.push_back(node);
-			boneID = node.id;
-		}
-		else {
-			auto it = std::find_if(nodes.begin(), nodes.end(), [&boneName](const Node& node) {
-				return node.name == boneName;
-				});
-			if (it != nodes.end()) {
-				it->offsetMatrix = AssimpGLMHelpers::ConvertMatrixToGLMFormat(mesh->mBones[boneIndex]->mOffsetMatrix);
-				it->isBoneNode = true;
-				boneID = it->id;
-			}
-		}
-		assert(boneID != -1);
+		int boneID = task.boneIDs[boneIndex];
 		auto weights = mesh->mBones[boneIndex]->mWeights;
 		int numWeights = mesh->mBones[boneIndex]->mNumWeights;
 		for (int weightIndex = 0; weightIndex < numWeights; weightIndex++) {
@@ -298,27 +426,10 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene, glm::mat4 nodeTransf
 		}
 	}
 
-	if (mesh->mMaterialIndex >= 0)
-	{
-		result.setMaterialIndex(mesh->mMaterialIndex);
-		Material mat;
-		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-		if (materials.find(mesh->mMaterialIndex) == materials.end()) {
-			aiString albedoPath;
-			material->GetTexture(aiTextureType_DIFFUSE, 0, &albedoPath);
-			aiString ambientPath;
-			material->GetTexture(aiTextureType_AMBIENT, 0, &ambientPath);
-			aiString specularPath;
-			material->GetTexture(aiTextureType_SPECULAR, 0, &specularPath);
-			aiString normalPath;
-			material->GetTexture(aiTextureType_HEIGHT, 0, &normalPath);
-			aiString shininessPath;
-			material->GetTexture(aiTextureType_SHININESS, 0, &shininessPath);
-			mat = Material(mesh->mMaterialIndex, directory + albedoPath.C_Str(), directory + ambientPath.C_Str(),
-				directory + specularPath.C_Str(), directory + normalPath.C_Str(), directory + shininessPath.C_Str());
-			materials.insert({ mesh->mMaterialIndex, mat });
-		}
-	}
+	result.setMaterialIndex(mesh->mMaterialIndex);
+	result.optimize();
+	result.buildLods();
+	result.buildMeshlets();
 	return result;
 }
 
@@ -0,0 +1,392 @@
+#ifndef MODELCACHE_HPP
+#define MODELCACHE_HPP
+#pragma once
+
+#include "mappedFile.hpp"
+#include "model.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ģ͵Ԥ棺AssimpĽڵ㡢ʡؼ֡񶥵/дɶļ
+// ´ʱӳļֱӶȡ鿽پAssimpŻ񣬶ȡŻ
+// 水Դļ·ļͷ¼ԴļĴС޸ʱݹϣһͬµ
+class ModelCache {
+public:
+	// Чʱص뵽һģ(û)򷵻ؿ
+	static std::shared_ptr<Model> load(const std::string& path);
+	// ģȫɺãڹִ߳
+	static bool save(const Model& model);
+	// ԱAssimpͶȡȫĺʱ漰GL
+	static std::string benchmark(const std::vector<std::string>& paths);
+private:
+	static constexpr uint32_t MAGIC = 0x31434D54; // "TMC1"
+	static constexpr uint32_t VERSION = 4;
+
+	struct SourceKey {
+		uint64_t size = 0;
+		int64_t mtime = 0;
+		uint64_t hash = 0;
+	};
+	static bool makeKey(const std::string& path, SourceKey& key);
+	static std::string cachePath(const std::string& path);
+	static uint64_t fnv1a(const unsigned char* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+	// ˳д/ȡȡԽʱvalidΪfalse
+	class Writer {
+	public:
+		explicit Writer(std::ofstream& out) : out(out) {}
+		template <typename T> void pod(const T& value) { bytes(&value, sizeof(T)); }
+		void string(const std::string& value);
+		template <typename T> void array(const std::vector<T>& values);
+		// ݰ16ֽڶ룬ӳֱӵʹ
+		void align();
+		void bytes(const void* data, size_t size);
+	private:
+		std::ofstream& out;
+		size_t offset = 0;
+	};
+	class Reader {
+	public:
+		Reader(const unsigned char* data, size_t size) : data(data), size(size) {}
+		template <typename T> T pod();
+		std::string string();
+		template <typename T> std::vector<T> array();
+		void align() { offset = (offset + 15) & ~(size_t)15; }
+		// صǰλõָ벢sizeֽ
+		const unsigned char* skip(size_t bytes);
+		bool valid = true;
+	private:
+		const unsigned char* data;
+		size_t size;
+		size_t offset = 0;
+	};
+};
+
+uint64_t ModelCache::fnv1a(const unsigned char* data, size_t size, uint64_t hash) {
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ data[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+bool ModelCache::makeKey(const std::string& path, SourceKey& key) {
+	std::error_code error;
+	auto mtime = std::filesystem::last_write_time(path, error);
+	if (error) return false;
+	MappedFile source(path);
+	if (!source.isOpen()) return false;
+	key.size = source.getSize();
+	key.mtime = (int64_t)mtime.time_since_epoch().count();
+	key.hash = fnv1a(source.getData(), source.getSize());
+	return true;
+}
+
+std::string ModelCache::cachePath(const std::string& path) {
+	std::string normalized = std::filesystem::path(path).lexically_normal().generic_string();
+	std::ostringstream name;
+	name << "cache/models/" << std::hex << std::setw(16) << std::setfill('0')
+		<< fnv1a((const unsigned char*)normalized.data(), normalized.size()) << ".tmc";
+	return name.str();
+}
+
+void ModelCache::Writer::bytes(const void* data, size_t size) {
+	out.write((const char*)data, size);
+	offset += size;
+}
+
+void ModelCache::Writer::string(const std::string& value) {
+	pod((uint32_t)value.size());
+	bytes(value.data(), value.size());
+}
+
+template <typename T>
+void ModelCache::Writer::array(const std::vector<T>& values) {
+	pod((uint32_t)values.size());
+	bytes(values.data(), values.size() * sizeof(T));
+}
+
+void ModelCache::Writer::align() {
+	static const char zeros[16] = {};
+	size_t padding = ((offset + 15) & ~(size_t)15) - offset;
+	bytes(zeros, padding);
+}
+
+const unsigned char* ModelCache::Reader::skip(size_t bytes) {
+	if (!valid || bytes > size - offset) {
+		valid = false;
+		return nullptr;
+	}
+	const unsigned char* pointer = data + offset;
+	offset += bytes;
+	return pointer;
+}
+
+template <typename T>
+T ModelCache::Reader::pod() {
+	T value = {};
+	const unsigned char* pointer = skip(sizeof(T));
+	if (pointer) {
+		memcpy(&value, pointer, sizeof(T));
+	}
+	return value;
+}
+
+std::string ModelCache::Reader::string() {
+	uint32_t length = pod<uint32_t>();
+	const unsigned char* pointer = skip(length);
+	return pointer ? std::string((const char*)pointer, length) : std::string();
+}
+
+template <typename T>
+std::vector<T> ModelCache::Reader::array() {
+	uint32_t count = pod<uint32_t>();
+	const unsigned char* pointer = skip((size_t)count * sizeof(T));
+	std::vector<T> values;
+	if (pointer) {
+		values.resize(count);
+		memcpy(values.data(), pointer, (size_t)count * sizeof(T));
+	}
+	return values;
+}
+
+bool ModelCache::save(const Model& model) {
+	SourceKey key;
+	if (!makeKey(model.path, key)) return false;
+	// ļ֮ǰ֮꣬ʧֻʣд
+	for (const MeshPtr& mesh : model.meshes) {
+		if (!mesh) return false;
+	}
+	std::string target = cachePath(model.path);
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(target).parent_path(), error);
+	// дʱļٸдһ˳𻵵Ļ
+	std::string temporary = target + ".tmp";
+	bool written = false;
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		if (!out) return false;
+		Writer writer(out);
+		writer.pod(MAGIC);
+		writer.pod(VERSION);
+		writer.pod((uint32_t)sizeof(Vertex));
+		writer.pod(key);
+		writer.string(model.path);
+		writer.string(model.directory);
+		writer.string(model.name);
+
+		writer.pod((uint32_t)model.nodes.size());
+		for (const Node& node : model.nodes) {
+			writer.string(node.name);
+			writer.pod(node.id);
+			writer.pod(node.parentIndex);
+			writer.pod(node.position);
+			writer.pod(node.transform);
+			writer.pod(node.offsetMatrix);
+			writer.pod((uint8_t)node.isBoneNode);
+			writer.array(node.childrenIndices);
+		}
+
+		writer.pod((uint32_t)model.materials.size());
+		for (const auto& [materialKey, material] : model.materials) {
+			writer.pod(materialKey);
+			writer.pod(material.getIndex());
+			writer.string(material.albedoPath);
+			writer.string(material.ambientPath);
+			writer.string(material.specularPath);
+			writer.string(material.normalPath);
+			writer.string(material.shininessPath);
+		}
+
+		writer.pod((uint32_t)model.animations.size());
+		for (const Animation& animation : model.animations) {
+			writer.string(animation.getName());
+			writer.pod(animation.getDuration());
+			writer.pod(animation.getTicksPerSecond());
+			writer.pod((uint32_t)animation.getBones().size());
+			for (const auto& [boneName, bone] : animation.getBones()) {
+				writer.string(boneName);
+				writer.pod(bone.getBoneID());
+				writer.array(bone.getPositions());
+				writer.array(bone.getRotations());
+				writer.array(bone.getScales());
+			}
+		}
+
+		writer.pod((uint32_t)model.meshes.size());
+		for (const MeshPtr& mesh : model.meshes) {
+			writer.pod(mesh->getMaterialIndex());
+			writer.pod(mesh->getOptimizeStats());
+			writer.pod((uint32_t)mesh->vertices.size());
+			writer.pod((uint32_t)mesh->indices.size());
+			writer.align();
+			writer.bytes(mesh->vertices.data(), mesh->vertices.size() * sizeof(Vertex));
+			writer.align();
+			writer.bytes(mesh->indices.data(), mesh->indices.size() * sizeof(GLuint));
+			writer.pod((uint32_t)mesh->lods.size());
+			for (size_t lod = 0; lod < mesh->lods.size(); lod++) {
+				writer.pod(mesh->lodErrors[lod]);
+				writer.pod((uint32_t)mesh->lods[lod].size());
+				writer.align();
+				writer.bytes(mesh->lods[lod].data(), mesh->lods[lod].size() * sizeof(GLuint));
+			}
+			writer.pod((uint32_t)mesh->meshlets.size());
+			writer.align();
+			writer.bytes(mesh->meshlets.data(), mesh->meshlets.size() * sizeof(Meshlet));
+		}
+		out.close();
+		written = !out.fail();
+	}
+	// дʧʱɾдһʱļ
+	if (!written) {
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+	std::filesystem::rename(temporary, target, error);
+	if (error) {
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+	return true;
+}
+
+std::shared_ptr<Model> ModelCache::load(const std::string& path) {
+	std::string source = cachePath(path);
+	if (!std::filesystem::is_regular_file(source)) return nullptr;
+	auto file = std::make_unique<MappedFile>(source);
+	if (!file->isOpen()) return nullptr;
+
+	Reader reader(file->getData(), file->getSize());
+	if (reader.pod<uint32_t>() != MAGIC || reader.pod<uint32_t>() != VERSION || reader.pod<uint32_t>() != sizeof(Vertex)) {
+		return nullptr;
+	}
+	SourceKey cachedKey = reader.pod<SourceKey>();
+	SourceKey key;
+	if (!makeKey(path, key) || key.size != cachedKey.size || key.mtime != cachedKey.mtime || key.hash != cachedKey.hash) {
+		return nullptr;
+	}
+
+	auto model = std::make_shared<Model>();
+	model->path = reader.string();
+	model->directory = reader.string();
+	model->name = reader.string();
+
+	uint32_t nodeCount = reader.pod<uint32_t>();
+	for (uint32_t i = 0; i < nodeCount && reader.valid; i++) {
+		Node node;
+		node.name = reader.string();
+		node.id = reader.pod<int>();
+		node.parentIndex = reader.pod<int>();
+		node.position = reader.pod<glm::vec3>();
+		node.transform = reader.pod<glm::mat4>();
+		node.offsetMatrix = reader.pod<glm::mat4>();
+		node.isBoneNode = reader.pod<uint8_t>() != 0;
+		node.childrenIndices = reader.array<int>();
+		model->nodes.push_back(node);
+	}
+
+	uint32_t materialCount = reader.pod<uint32_t>();
+	for (uint32_t i = 0; i < materialCount && reader.valid; i++) {
+		unsigned int materialKey = reader.pod<unsigned int>();
+		unsigned int index = reader.pod<unsigned int>();
+		std::string albedoPath = reader.string();
+		std::string ambientPath = reader.string();
+		std::string specularPath = reader.string();
+		std::string normalPath = reader.string();
+		std::string shininessPath = reader.string();
+		model->materials.emplace(materialKey, Material(index, albedoPath, ambientPath, specularPath, normalPath, shininessPath));
+	}
+
+	uint32_t animationCount = reader.pod<uint32_t>();
+	for (uint32_t i = 0; i < animationCount && reader.valid; i++) {
+		std::string name = reader.string();
+		float duration = reader.pod<float>();
+		float ticksPerSecond = reader.pod<float>();
+		uint32_t boneCount = reader.pod<uint32_t>();
+		std::unordered_map<std::string, Bone> bones;
+		for (uint32_t b = 0; b < boneCount && reader.valid; b++) {
+			std::string boneName = reader.string();
+			int id = reader.pod<int>();
+			std::vector<KeyPosition> positions = reader.array<KeyPosition>();
+			std::vector<KeyRotation> rotations = reader.array<KeyRotation>();
+			std::vector<KeyScale> scales = reader.array<KeyScale>();
+			bones[boneName] = Bone(id, std::move(positions), std::move(rotations), std::move(scales));
+		}
+		model->animations.emplace_back(name, duration, ticksPerSecond, std::move(bones));
+	}
+
+	uint32_t meshCount = reader.pod<uint32_t>();
+	for (uint32_t i = 0; i < meshCount && reader.valid; i++) {
+		Model::CookedMesh mesh;
+		mesh.materialIndex = reader.pod<unsigned int>();
+		mesh.optimizeStats = reader.pod<MeshOptimizer::Stats>();
+		mesh.vertexCount = reader.pod<uint32_t>();
+		mesh.indexCount = reader.pod<uint32_t>();
+		reader.align();
+		mesh.vertices = (const Vertex*)reader.skip((size_t)mesh.vertexCount * sizeof(Vertex));
+		reader.align();
+		mesh.indices = (const GLuint*)reader.skip((size_t)mesh.indexCount * sizeof(GLuint));
+		uint32_t lodCount = reader.pod<uint32_t>();
+		for (uint32_t lod = 0; lod < lodCount && reader.valid; lod++) {
+			Model::CookedLod cookedLod;
+			cookedLod.error = reader.pod<float>();
+			cookedLod.indexCount = reader.pod<uint32_t>();
+			reader.align();
+			cookedLod.indices = (const GLuint*)reader.skip((size_t)cookedLod.indexCount * sizeof(GLuint));
+			if (lod < MAX_LODS - 1) {
+				mesh.lods.push_back(cookedLod);
+			}
+		}
+		mesh.meshletCount = reader.pod<uint32_t>();
+		reader.align();
+		mesh.meshlets = (const Meshlet*)reader.skip((size_t)mesh.meshletCount * sizeof(Meshlet));
+		model->cookedMeshes.push_back(mesh);
+	}
+	if (!reader.valid || model->cookedMeshes.empty()) {
+		std::cerr << "Corrupted model cache: " << source << std::endl;
+		return nullptr;
+	}
+	model->meshes.resize(model->cookedMeshes.size());
+	model->cookedFile = std::move(file);
+	return model;
+}
+
+std::string ModelCache::benchmark(const std::vector<std::string>& paths) {
+	using Clock = std::chrono::steady_clock;
+	auto buildAll = [](Model& model) {
+		for (size_t i = 0; i < model.getMeshCount(); i++) {
+			model.meshes[i] = model.buildMesh(i);
+		}
+	};
+	std::ostringstream result;
+	result << std::fixed << std::setprecision(1) << "Model load (cold: Assimp, warm: cooked cache)\n";
+	for (const std::string& path : paths) {
+		std::string fileName = std::filesystem::path(path).filename().string();
+		Clock::time_point start = Clock::now();
+		std::shared_ptr<Model> cold = Model::import(path);
+		if (!cold) continue;
+		buildAll(*cold);
+		double coldMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		// ȷڣдʱ䲻
+		if (!save(*cold)) {
+			result << fileName << ": failed to write cache\n";
+			continue;
+		}
+		start = Clock::now();
+		std::shared_ptr<Model> warm = load(path);
+		if (!warm) continue;
+		buildAll(*warm);
+		double warmMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		result << fileName << ": cold " << coldMs << " ms, warm " << warmMs << " ms (x" << coldMs / std::max(warmMs, 0.001) << ")\n";
+	}
+	return result.str();
+}
+
+#endif // !MODELCACHE_HPP
@@ -2,6 +2,7 @@
 #define SHADER_HPP
 #pragma once
 
+#include "glState.hpp"
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -9,6 +10,9 @@
 #include <sstream>
 #include <iostream>
 #include <regex>
+#include <deque>
+#include <string_view>
+#include <unordered_map>
 
 class Shader
 {
@@ -16,20 +20,37 @@ public:
     GLuint ID;
     Shader(const char* vertexShaderPath, const char* fragmentShaderPath);
     Shader(const char* vertexShaderPath, const char* geometryShaderPath, const char* fragmentShaderPath);
+    // ɫ֧ͬ#include
+    explicit Shader(const char* computeShaderPath);
     void reCompile();
     void use();
     void setVec2(const char* name, glm::vec2 vec);
     void setVec3(const char* name, glm::vec3 vec);
+    void setIVec3(const char* name, glm::ivec3 vec);
     void setMat4(const char* name, glm::mat4 mat);
     void setFloat(const char* name, float value);
     void setInt(const char* name, int value);
     void setBool(const char* name, bool value);
+    void setMat4Array(const char* name, const glm::mat4* mats, int count);
+    void setVec4Array(const char* name, const glm::vec4* vecs, int count);
+    // Ӻõuniformλãڷ-1(glUniform*)
+    GLint getUniformLocation(const char* name) const;
+    // еɫţ˳䣬±󲻱
+    unsigned int getSortId() const { return sortId; }
 	static void changeSettings(const char* name, bool value);
 private:
+    unsigned int sortId = nextSortId();
+    static unsigned int nextSortId() { static unsigned int counter = 0; return counter++; }
     std::string preprocessShader(const std::string shaderContent);
+    void reflectUniforms();
+    void compileCompute();
+    // ֵĴ洢Ͳֿstring_viewʱstd::string
+    std::deque<std::string> uniformNames;
+    std::unordered_map<std::string_view, GLint> uniformLocations;
     std::string vertexShaderPath;
 	std::string fragmentShaderPath;
 	std::string geometryShaderPath;
+	std::string computeShaderPath;
 };
 
 std::string readShaderFile(const char* shaderFilePath) {
@@ -98,6 +119,7 @@ Shader::Shader(const char* vertexShaderPath, const char* fragmentShaderPath) {
     }
     glDeleteShader(vShader);
     glDeleteShader(fShader);
+    reflectUniforms();
 }
 
 Shader::Shader(const char* vertexShaderPath, const char* geometryShaderPath, const char* fragmentShaderPath) {
@@ -157,10 +179,49 @@ Shader::Shader(const char* vertexShaderPath, const char* geometryShaderPath, con
     glDeleteShader(vShader);
     glDeleteShader(gShader);
     glDeleteShader(fShader);
+    reflectUniforms();
+}
+
+Shader::Shader(const char* computeShaderPath) {
+    this->computeShaderPath = computeShaderPath;
+    compileCompute();
+}
+
+void Shader::compileCompute() {
+    GLuint cShader = glCreateShader(GL_COMPUTE_SHADER);
+    std::string cShaderContent = preprocessShader(readShaderFile(computeShaderPath.c_str()));
+    const char* cshaderCode = cShaderContent.c_str();
+    glShaderSource(cShader, 1, &cshaderCode, NULL);
+
+    int success;
+    char infoLog[512];
+    glCompileShader(cShader);
+    glGetShaderiv(cShader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(cShader, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+    ID = glCreateProgram();
+    glAttachShader(ID, cShader);
+    glLinkProgram(ID);
+    glGetProgramiv(ID, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(ID, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    }
+    glDeleteShader(cShader);
+    reflectUniforms();
 }
 
 void Shader::reCompile() {
     glDeleteProgram(ID);
+    // ³ܸñɾID
+    GLState::getInstance().invalidate();
+    if (!computeShaderPath.empty()) {
+        compileCompute();
+        return;
+    }
     GLuint vShader = glCreateShader(GL_VERTEX_SHADER);
     GLuint fShader = glCreateShader(GL_FRAGMENT_SHADER);
     std::string vShaderContent = readShaderFile(vertexShaderPath.c_str());
@@ -196,55 +257,111 @@ void Shader::reCompile() {
     }
     glDeleteShader(vShader);
     glDeleteShader(fShader);
+    reflectUniforms();
+}
+
+void Shader::reflectUniforms() {
+    uniformLocations.clear();
+    uniformNames.clear();
+    GLint uniformCount = 0, maxNameLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::string name(maxNameLength, '\0');
+    auto addUniform = [this](const std::string& uniformName, GLint location) {
+        uniformNames.push_back(uniformName);
+        uniformLocations[uniformNames.back()] = location;
+        };
+    for (GLint i = 0; i < uniformCount; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type;
+        glGetActiveUniform(ID, i, maxNameLength, &length, &size, &type, &name[0]);
+        std::string uniformName = name.substr(0, length);
+        GLint location = glGetUniformLocation(ID, uniformName.c_str());
+        // uniform blockеĳԱûλ
+        if (location == -1) continue;
+        addUniform(uniformName, location);
+        // ֻ"name[0]""name"ÿԪ
+        size_t bracket = uniformName.rfind("[0]");
+        if (bracket != std::string::npos && bracket + 3 == uniformName.size()) {
+            std::string baseName = uniformName.substr(0, bracket);
+            addUniform(baseName, location);
+            for (GLint k = 1; k < size; k++) {
+                std::string elementName = baseName + "[" + std::to_string(k) + "]";
+                addUniform(elementName, glGetUniformLocation(ID, elementName.c_str()));
+            }
+        }
+    }
+}
+
+GLint Shader::getUniformLocation(const char* name) const {
+    auto it = uniformLocations.find(std::string_view(name));
+    return it == uniformLocations.end() ? -1 : it->second;
 }
 
 void Shader::use() {
-    glUseProgram(ID);
+    GLState::getInstance().useProgram(ID);
 }
 
 void Shader::setVec3(const char* name, glm::vec3 vec) {
-    int location = glGetUniformLocation(ID, name);
+    int location = getUniformLocation(name);
     glUniform3fv(location, 1, glm::value_ptr(vec));
 }
 
+void Shader::setIVec3(const char* name, glm::ivec3 vec) {
+    int location = getUniformLocation(name);
+    glUniform3iv(location, 1, glm::value_ptr(vec));
+}
+
 void Shader::setVec2(const char* name, glm::vec2 vec) {
-    int location = glGetUniformLocation(ID, name);
+    int location = getUniformLocation(name);
     glUniform2fv(location, 1, glm::value_ptr(vec));
 }
 
 void Shader::setMat4(const char* name, glm::mat4 mat) {
-    int location = glGetUniformLocation(ID, name);
+    int location = getUniformLocation(name);
     glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
 }
 
 void Shader::setFloat(const char* name, float value) {
-    int location = glGetUniformLocation(ID, name);
+    int location = getUniformLocation(name);
     glUniform1f(location, value);
 }
 
 void Shader::setInt(const char* name, int value) {
-    int location = glGetUniformLocation(ID, name);
+    int location = getUniformLocation(name);
     glUniform1i(location, value);
 }
 
 void Shader::setBool(const char* name, bool value) {
-    int location = glGetUniformLocation(ID, name);
+    int location = getUniformLocation(name);
     glUniform1i(location, value);
 }
 
+void Shader::setMat4Array(const char* name, const glm::mat4* mats, int count) {
+    int location = getUniformLocation(name);
+    glUniformMatrix4fv(location, count, GL_FALSE, glm::value_ptr(mats[0]));
+}
+
+void Shader::setVec4Array(const char* name, const glm::vec4* vecs, int count) {
+    int location = getUniformLocation(name);
+    glUniform4fv(location, count, glm::value_ptr(vecs[0]));
+}
+
 void Shader::changeSettings(const char* name, bool value)
 {
     const std::string filename = "data/shader/settings.glsl";
     std::ifstream in(filename);
-    if (!in.is_open()) return;
 
     std::string result;
     std::string line;
+    bool found = false;
     std::regex defineRe(R"(^(\s*//\s*)?(#define\s+)" + std::string(name) + R"(\b.*)$)");
 
     while (std::getline(in, line)) {
         std::smatch m;
         if (std::regex_match(line, m, defineRe)) {
+            found = true;
             bool hasComment = m[1].matched && m[1].str().find("//") != std::string::npos;
             if (value) {
                 if (hasComment) {
@@ -264,6 +381,10 @@ void Shader::changeSettings(const char* name, bool value)
         }
     }
     in.close();
+    // ļﻹû(ļ)ʱ׷һ
+    if (!found) {
+        result += (value ? "#define " : "//#define ") + std::string(name) + "\n";
+    }
 
     if (!result.empty() && result.back() == '\n') {
         result.pop_back();
@@ -2,7 +2,11 @@
 #define TEXTURE_HPP
 #pragma once
 
+#include "glState.hpp"
+#include "threadPool.hpp"
 #include <glad/glad.h>
+#include <algorithm>
+#include <future>
 #include <iostream>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -11,7 +15,7 @@ class Texture {
 public:
 	Texture() = default;
 	~Texture() = default;
-	GLuint ID;
+	GLuint ID = 0;
 	virtual void use(GLenum textureUnit) = 0;
 };
 
@@ -28,12 +32,13 @@ public:
 	Texture2D() {};
 	Texture2D(int width, int height, GLenum wrap, GLenum filter, GLenum internalFormat, GLenum format, GLenum dataType); // Empty texture, for framebuffer usage etc.
 	Texture2D(const char* path, Type type, GLenum wrap, GLenum filter); // Load texture from file.
+	Texture2D(GLuint ID, Type type) : type(type) { this->ID = ID; } // Wrap an existing texture, e.g. one shared by TextureCache.
 	virtual void use(GLenum textureUnit) override;
 	void setBorderColor(float r, float g, float b, float a);
 	void setDefaultColor(float r, float g, float b, float a);
 	void resetSize(int width, int height);
 	void subImage2D(int xOffset, int yOffset, int width, int height, const void* data);
-	Type getType() { return type; }
+	Type getType() const { return type; }
 private:
 	Type type;
 	GLenum internalFormat, format, dataType;
@@ -90,8 +95,7 @@ Texture2D::Texture2D(const char* path, Type type, GLenum wrap, GLenum filter) {
 }
 
 void Texture2D::use(GLenum textureUnit) {
-	glActiveTexture(textureUnit);
-	glBindTexture(GL_TEXTURE_2D, ID);
+	GLState::getInstance().bindTexture(textureUnit, GL_TEXTURE_2D, ID);
 }
 
 void Texture2D::setBorderColor(float r, float g, float b, float a) {
@@ -137,8 +141,7 @@ Texture2DArray::Texture2DArray(int width, int height, int length, GLenum wrap, G
 }
 
 void Texture2DArray::use(GLenum textureUnit) {
-	glActiveTexture(textureUnit);
-	glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+	GLState::getInstance().bindTexture(textureUnit, GL_TEXTURE_2D_ARRAY, ID);
 }
 
 class CubeMap : public Texture {
@@ -156,14 +159,28 @@ CubeMap::CubeMap(const char* folderPath, GLenum wrap, GLenum filter) {
 	faces.push_back(folderPath + std::string("/bottom.jpg"));
 	faces.push_back(folderPath + std::string("/front.jpg"));
 	faces.push_back(folderPath + std::string("/back.jpg"));
-	stbi_set_flip_vertically_on_load(false);
-	int width, height, nrChannels;
-	unsigned char* data;
+	// ̳߳ͬʱ룬ϴڵǰ߳
+	struct Face {
+		int width = 0, height = 0, nrChannels = 0;
+		unsigned char* data = nullptr;
+	};
+	std::vector<std::future<Face>> decoding;
+	for (size_t i = 0; i < faces.size(); i++) {
+		std::string face = faces[i];
+		decoding.push_back(ThreadPool::getShared().submit([face]() {
+			Face result;
+			stbi_set_flip_vertically_on_load_thread(false);
+			result.data = stbi_load(face.c_str(), &result.width, &result.height, &result.nrChannels, 0);
+			return result;
+		}));
+	}
 	bool validFlag = true;
 	glGenTextures(1, &ID);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, ID);
-	for (int i = 0; i < faces.size(); i++) {
-		data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
+	for (size_t i = 0; i < faces.size(); i++) {
+		Face face = decoding[i].get();
+		int width = face.width, height = face.height, nrChannels = face.nrChannels;
+		unsigned char* data = face.data;
 		if (data) {
 			GLenum informat, outformat;
 			if (nrChannels == 1) {
@@ -178,12 +195,11 @@ CubeMap::CubeMap(const char* folderPath, GLenum wrap, GLenum filter) {
 				informat = GL_RGBA;
 				outformat = GL_RGBA;
 			}
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, informat, width, height, 0, outformat, GL_UNSIGNED_BYTE, data);
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)i, 0, informat, width, height, 0, outformat, GL_UNSIGNED_BYTE, data);
 			stbi_image_free(data);
 		}
 		else {
 			validFlag = false;
-			break;
 		}
 	}
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, wrap);
@@ -199,8 +215,7 @@ CubeMap::CubeMap(const char* folderPath, GLenum wrap, GLenum filter) {
 }
 
 void CubeMap::use(GLenum textureUnit) {
-	glActiveTexture(textureUnit);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, ID);
+	GLState::getInstance().bindTexture(textureUnit, GL_TEXTURE_CUBE_MAP, ID);
 }
 
 class CubeMapArray : public Texture {
@@ -208,11 +223,30 @@ public:
 	CubeMapArray() {};
 	CubeMapArray(int width, int height, int length, GLenum wrap, GLenum filter, GLenum internalFormat, GLenum format);
 	virtual void use(GLenum textureUnit) override;
+	// ·Ϊlength壬ǰе
+	void resetLength(int length);
+	int getLength() { return length; }
+private:
+	int width, height, length;
+	GLenum wrap, filter, internalFormat, format;
+	GLuint createTexture(int length);
 };
 
 CubeMapArray::CubeMapArray(int width, int height, int length, GLenum wrap, GLenum filter, GLenum internalFormat, GLenum format) {
-	glGenTextures(1, &ID);
-	glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, ID);
+	this->width = width;
+	this->height = height;
+	this->length = length;
+	this->wrap = wrap;
+	this->filter = filter;
+	this->internalFormat = internalFormat;
+	this->format = format;
+	ID = createTexture(length);
+}
+
+GLuint CubeMapArray::createTexture(int length) {
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, texture);
 	glTexImage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 0, internalFormat, width, height, length * 6, 0, format, GL_FLOAT, nullptr);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, wrap);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, wrap);
@@ -220,11 +254,25 @@ CubeMapArray::CubeMapArray(int width, int height, int length, GLenum wrap, GLenu
 	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, filter);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, filter);
 	glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+	return texture;
+}
+
+void CubeMapArray::resetLength(int length) {
+	if (length == this->length) return;
+	GLuint texture = createTexture(length);
+	int copyLength = std::min(length, this->length);
+	if (copyLength > 0) {
+		glCopyImageSubData(ID, GL_TEXTURE_CUBE_MAP_ARRAY, 0, 0, 0, 0,
+			texture, GL_TEXTURE_CUBE_MAP_ARRAY, 0, 0, 0, 0,
+			width, height, copyLength * 6);
+	}
+	glDeleteTextures(1, &ID);
+	ID = texture;
+	this->length = length;
 }
 
 void CubeMapArray::use(GLenum textureUnit) {
-	glActiveTexture(textureUnit);
-	glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, ID);
+	GLState::getInstance().bindTexture(textureUnit, GL_TEXTURE_CUBE_MAP_ARRAY, ID);
 }
 
 class RenderBuffer {
@@ -278,8 +326,7 @@ void Texture3D::subImage3D(int xOffset, int yOffset, int zOffset, int width, int
 }
 
 void Texture3D::use(GLenum textureUnit) {
-	glActiveTexture(textureUnit);
-	glBindTexture(GL_TEXTURE_3D, ID);
+	GLState::getInstance().bindTexture(textureUnit, GL_TEXTURE_3D, ID);
 }
 
 #endif // !TEXTURE_HPP
\ No newline at end of file
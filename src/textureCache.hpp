@@ -0,0 +1,350 @@
+#ifndef TEXTURECACHE_HPP
+#define TEXTURECACHE_HPP
+#pragma once
+
+#include "texture.hpp"
+#include "threadPool.hpp"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ļص(·, Ʒʽ, ˷ʽ)ͬһͼƬֻϴһ
+// üɾʱֱУ
+// δʹܴСԤʱδʹõ˳ɾ
+// ͼƬ̳߳н룬߳ÿ֡ͨPBOϴһ֣ϴ֮ǰ״̬ΪLOADING
+// ʧܵУٴacquireʱ¼أʧܵĿһͷʱɾ
+class TextureCache {
+public:
+	enum class State {
+		LOADING,
+		READY,
+		FAILED
+	};
+
+	static TextureCache& getInstance() {
+		static TextureCache instance;
+		return instance;
+	}
+
+	// ֣ں̨أgetStateжǷʹ
+	// filterС˷ʽʹmipmapĹ˷ʽʱŷ䲢mipmap
+	// صɻУʹʱrelease
+	GLuint acquire(const std::string& path, GLenum wrap, GLenum filter);
+	void release(GLuint texture);
+	State getState(GLuint texture) const;
+	// ߳ÿ֡ãϴɵͼƬÿ֡дbudgetBytes
+	void update(size_t budgetBytes);
+	// ɾûõ
+	void evictUnused();
+	void setUnusedBudget(size_t bytes);
+	// ɾ֮ǰãֵҪ
+	void addEvictListener(const std::function<void(GLuint)>& listener) { evictListeners.push_back(listener); }
+
+	int getTextureCount() const { return (int)entries.size(); }
+	size_t getTotalBytes() const { return totalBytes; }
+	size_t getUnusedBytes() const { return unusedBytes; }
+	int getHits() const { return hits; }
+	int getMisses() const { return misses; }
+	int getLoadingCount() const { return loadingCount; }
+	size_t getUploadedBytes() const { return uploadedBytes; }
+private:
+	TextureCache() = default;
+	~TextureCache() = default;
+
+	struct Entry {
+		std::string key;
+		State state = State::LOADING;
+		int refCount = 0;
+		size_t bytes = 0;
+		uint64_t lastUse = 0;
+		bool mipmaps = false;
+	};
+	// ߳̽ĽpixelsΪձʾʧ
+	struct DecodedImage {
+		std::string key;
+		std::string path;
+		GLuint texture = 0;
+		int width = 0, height = 0, channels = 0;
+		unsigned char* pixels = nullptr;
+	};
+	struct Upload {
+		DecodedImage image;
+		GLuint pbo = 0;
+		int nextRow = 0;
+		GLsizei levels = 1;
+	};
+	std::unordered_map<std::string, GLuint> lookup;
+	std::unordered_map<GLuint, Entry> entries;
+	std::vector<std::function<void(GLuint)>> evictListeners;
+	size_t unusedBudget = 256ull << 20;
+	size_t totalBytes = 0, unusedBytes = 0;
+	uint64_t useCounter = 0;
+	int hits = 0, misses = 0;
+	int loadingCount = 0;
+	size_t uploadedBytes = 0;
+
+	std::mutex decodedMutex;
+	std::vector<DecodedImage> decoded;
+	std::deque<Upload> uploads;
+	// ʱȵȹ߳̽ǻдdecoded
+	ThreadPool decodePool;
+
+	static std::string makeKey(const std::string& path, GLenum wrap, GLenum filter);
+	static size_t estimateBytes(int width, int height, int channels, bool mipmaps);
+	static bool usesMipmaps(GLenum filter);
+	// ʼϴ䲻ɱ洢PBOfalseʾͼƬѾҪ
+	bool beginUpload(DecodedImage& image, Upload& upload);
+	void finishUpload(Upload& upload);
+	void trim();
+	void evict(GLuint texture);
+};
+
+
+std::string TextureCache::makeKey(const std::string& path, GLenum wrap, GLenum filter) {
+	// ͬһļĲͬд(./..б)һͬһ
+	std::string normalized = std::filesystem::path(path).lexically_normal().generic_string();
+	return normalized + "|" + std::to_string(wrap) + "|" + std::to_string(filter);
+}
+
+size_t TextureCache::estimateBytes(int width, int height, int channels, bool mipmaps) {
+	// RGB8ڴϰ4ֽڴ洢mipmapԼΪ04/3
+	size_t bytesPerPixel = channels == 3 ? 4 : (size_t)channels;
+	size_t bytes = (size_t)width * height * bytesPerPixel;
+	return mipmaps ? bytes * 4 / 3 : bytes;
+}
+
+bool TextureCache::usesMipmaps(GLenum filter) {
+	return filter == GL_NEAREST_MIPMAP_NEAREST || filter == GL_LINEAR_MIPMAP_NEAREST
+		|| filter == GL_NEAREST_MIPMAP_LINEAR || filter == GL_LINEAR_MIPMAP_LINEAR;
+}
+
+GLuint TextureCache::acquire(const std::string& path, GLenum wrap, GLenum filter) {
+	std::string key = makeKey(path, wrap, filter);
+	auto it = lookup.find(key);
+	if (it != lookup.end() && entries[it->second].state == State::FAILED) {
+		// ļѾ޸ĿֻӲұƳԱõĵһreleaseʱɾ
+		lookup.erase(it);
+		it = lookup.end();
+	}
+	if (it != lookup.end()) {
+		Entry& entry = entries[it->second];
+		if (entry.refCount == 0) {
+			unusedBytes -= entry.bytes;
+		}
+		entry.refCount++;
+		entry.lastUse = ++useCounter;
+		hits++;
+		return it->second;
+	}
+
+	misses++;
+	// ȴ󣬲ھúã洢Ƚɺٷ
+	GLuint texture;
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_S, wrap);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_T, wrap);
+	glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, filter);
+	// Ŵ˲ʹmipmapķʽ
+	GLenum magFilter = filter;
+	if (usesMipmaps(filter)) {
+		magFilter = filter == GL_NEAREST_MIPMAP_NEAREST || filter == GL_NEAREST_MIPMAP_LINEAR ? GL_NEAREST : GL_LINEAR;
+	}
+	glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, magFilter);
+	Entry entry;
+	entry.key = key;
+	entry.mipmaps = usesMipmaps(filter);
+	entry.refCount = 1;
+	entry.lastUse = ++useCounter;
+	lookup[key] = texture;
+	entries[texture] = entry;
+	loadingCount++;
+
+	decodePool.submit([this, key, path, texture]() {
+		DecodedImage image;
+		image.key = key;
+		image.path = path;
+		image.texture = texture;
+		stbi_set_flip_vertically_on_load_thread(true);
+		image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
+		std::lock_guard<std::mutex> lock(decodedMutex);
+		decoded.push_back(image);
+	});
+	return texture;
+}
+
+TextureCache::State TextureCache::getState(GLuint texture) const {
+	auto it = entries.find(texture);
+	return it != entries.end() ? it->second.state : State::FAILED;
+}
+
+bool TextureCache::beginUpload(DecodedImage& image, Upload& upload) {
+	// ȴڼѱɾֱãüȷϻͬһ
+	auto it = entries.find(image.texture);
+	if (it == entries.end() || it->second.key != image.key || it->second.state != State::LOADING) {
+		stbi_image_free(image.pixels);
+		return false;
+	}
+	if (!image.pixels || image.channels < 1 || image.channels > 4) {
+		std::cerr << "Failed to load texture: " << image.path << std::endl;
+		stbi_image_free(image.pixels);
+		it->second.state = State::FAILED;
+		loadingCount--;
+		if (it->second.refCount == 0) {
+			evict(image.texture);
+		}
+		return false;
+	}
+	const GLenum sizedFormats[4] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+	GLsizei levels = 1;
+	if (it->second.mipmaps) {
+		levels = (GLsizei)std::floor(std::log2((float)std::max(image.width, image.height))) + 1;
+	}
+	glTextureStorage2D(image.texture, levels, sizedFormats[image.channels - 1], image.width, image.height);
+	upload.image = image;
+	upload.levels = levels;
+	upload.nextRow = 0;
+	glCreateBuffers(1, &upload.pbo);
+	glNamedBufferStorage(upload.pbo, (GLsizeiptr)image.width * image.height * image.channels, nullptr, GL_MAP_WRITE_BIT);
+	return true;
+}
+
+void TextureCache::finishUpload(Upload& upload) {
+	glDeleteBuffers(1, &upload.pbo);
+	stbi_image_free(upload.image.pixels);
+	if (upload.levels > 1) {
+		glGenerateTextureMipmap(upload.image.texture);
+	}
+	auto it = entries.find(upload.image.texture);
+	if (it == entries.end()) return;
+	Entry& entry = it->second;
+	entry.state = State::READY;
+	entry.bytes = estimateBytes(upload.image.width, upload.image.height, upload.image.channels, upload.levels > 1);
+	totalBytes += entry.bytes;
+	if (entry.refCount == 0) {
+		unusedBytes += entry.bytes;
+	}
+	loadingCount--;
+}
+
+void TextureCache::update(size_t budgetBytes) {
+	uploadedBytes = 0;
+	std::vector<DecodedImage> ready;
+	{
+		std::lock_guard<std::mutex> lock(decodedMutex);
+		ready.swap(decoded);
+	}
+	for (DecodedImage& image : ready) {
+		Upload upload;
+		if (beginUpload(image, upload)) {
+			uploads.push_back(upload);
+		}
+	}
+	if (uploads.empty()) return;
+
+	// ÿ֡ϴһУ֤ԤСʱҲ
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	while (!uploads.empty() && (uploadedBytes == 0 || uploadedBytes < budgetBytes)) {
+		Upload& upload = uploads.front();
+		const DecodedImage& image = upload.image;
+		size_t rowBytes = (size_t)image.width * image.channels;
+		size_t remaining = budgetBytes > uploadedBytes ? budgetBytes - uploadedBytes : 0;
+		int rows = std::clamp((int)(remaining / rowBytes), 1, image.height - upload.nextRow);
+		GLintptr offset = (GLintptr)upload.nextRow * rowBytes;
+		GLsizeiptr size = (GLsizeiptr)rows * rowBytes;
+		// ÿдлصҪȴGPU֮ǰĲ
+		void* mapped = glMapNamedBufferRange(upload.pbo, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (mapped) {
+			memcpy(mapped, image.pixels + offset, size);
+			glUnmapNamedBuffer(upload.pbo);
+		}
+		const GLenum formats[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload.pbo);
+		glTextureSubImage2D(image.texture, 0, 0, upload.nextRow, image.width, rows, formats[image.channels - 1], GL_UNSIGNED_BYTE, (void*)offset);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		upload.nextRow += rows;
+		uploadedBytes += size;
+		if (upload.nextRow >= image.height) {
+			finishUpload(upload);
+			uploads.pop_front();
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	trim();
+}
+
+void TextureCache::release(GLuint texture) {
+	auto it = entries.find(texture);
+	if (it == entries.end() || it->second.refCount == 0) return;
+	Entry& entry = it->second;
+	entry.lastUse = ++useCounter;
+	if (--entry.refCount == 0) {
+		if (entry.state == State::FAILED) {
+			evict(texture);
+			return;
+		}
+		unusedBytes += entry.bytes;
+		trim();
+	}
+}
+
+void TextureCache::setUnusedBudget(size_t bytes) {
+	unusedBudget = bytes;
+	trim();
+}
+
+void TextureCache::evictUnused() {
+	std::vector<GLuint> unused;
+	for (auto& [texture, entry] : entries) {
+		if (entry.refCount == 0 && entry.state != State::LOADING) unused.push_back(texture);
+	}
+	for (GLuint texture : unused) {
+		evict(texture);
+	}
+}
+
+void TextureCache::trim() {
+	while (unusedBytes > unusedBudget) {
+		GLuint oldest = 0;
+		uint64_t oldestUse = UINT64_MAX;
+		for (auto& [texture, entry] : entries) {
+			if (entry.refCount == 0 && entry.state != State::LOADING && entry.lastUse < oldestUse) {
+				oldest = texture;
+				oldestUse = entry.lastUse;
+			}
+		}
+		if (!oldest) break;
+		evict(oldest);
+	}
+}
+
+void TextureCache::evict(GLuint texture) {
+	auto it = entries.find(texture);
+	if (it == entries.end()) return;
+	for (const auto& listener : evictListeners) {
+		listener(texture);
+	}
+	totalBytes -= it->second.bytes;
+	if (it->second.refCount == 0) {
+		unusedBytes -= it->second.bytes;
+	}
+	// ʧܺ¼صѾռͬһ
+	auto key = lookup.find(it->second.key);
+	if (key != lookup.end() && key->second == texture) {
+		lookup.erase(key);
+	}
+	entries.erase(it);
+	glDeleteTextures(1, &texture);
+	GLState::getInstance().invalidate();
+}
+
+#endif // !TEXTURECACHE_HPP
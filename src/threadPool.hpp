@@ -0,0 +1,99 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// ̶Ḷ́߳ύ˳ִ
+// ﲻܵglҪ̴߳
+class ThreadPool {
+public:
+	// threadCountΪ0ʱʹӲ߳һ(һ)
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	// ȫֹõ̳߳أʹ
+	static ThreadPool& getShared() {
+		static ThreadPool instance;
+		return instance;
+	}
+
+	template <typename F>
+	auto submit(F&& task) -> std::future<decltype(task())>;
+
+	unsigned int getThreadCount() const { return (unsigned int)workers.size(); }
+	// Ŷлûʼ
+	size_t getPendingCount();
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stopping = false;
+
+	void workerLoop();
+};
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+	if (threadCount == 0) {
+		threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+	}
+	for (unsigned int i = 0; i < threadCount; i++) {
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+template <typename F>
+auto ThreadPool::submit(F&& task) -> std::future<decltype(task())> {
+	// std::functionҪɿpackaged_taskshared_ptr
+	auto packaged = std::make_shared<std::packaged_task<decltype(task())()>>(std::forward<F>(task));
+	std::future<decltype(task())> future = packaged->get_future();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push([packaged]() { (*packaged)(); });
+	}
+	condition.notify_one();
+	return future;
+}
+
+size_t ThreadPool::getPendingCount() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return tasks.size();
+}
+
+void ThreadPool::workerLoop() {
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			// ʱȰѾύִ
+			if (stopping && tasks.empty()) return;
+			task = std::move(tasks.front());
+			tasks.pop();
+		}
+		task();
+	}
+}
+
+#endif // !THREADPOOL_HPP
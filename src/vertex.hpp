@@ -0,0 +1,50 @@
+#ifndef VERTEX_HPP
+#define VERTEX_HPP
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+#define MAX_BONES 500
+#define MAX_BONE_INFLUENCE 4
+#define MAX_LODS 4
+
+struct Vertex
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texCoords;
+	glm::vec3 tangent;
+	glm::vec3 bitangent;
+	int boneIDs[MAX_BONE_INFLUENCE];
+    float weights[MAX_BONE_INFLUENCE];
+};
+
+// ϴGPUĶʽÿѡһ֣ԷMeshArenaһ
+// PACKEDʽķߺð룬cross(N, T)ͷλָUVΪ뾫
+enum class VertexLayout {
+	STANDARD,		// Vertexԭϴ88ֽڣų255ʱʹ
+	PACKED_SKINNED,	// 32ֽڣuint8Ȩunorm8
+	PACKED_STATIC,	// 24ֽڣûй
+	COUNT
+};
+
+struct PackedVertex
+{
+	glm::vec3 position;
+	uint32_t normal;	// 룬2 x snorm16
+	uint32_t tangent;	// xy + ߷z4 x snorm8
+	uint32_t texCoords;	// 2 x half
+};
+
+struct PackedSkinnedVertex
+{
+	glm::vec3 position;
+	uint32_t normal;
+	uint32_t tangent;
+	uint32_t texCoords;
+	uint8_t boneIDs[MAX_BONE_INFLUENCE];
+	uint32_t weights;	// 4 x unorm8
+};
+
+#endif // !VERTEX_HPP
@@ -0,0 +1,102 @@
+#ifndef VERTEXPACKER_HPP
+#define VERTEXPACKER_HPP
+#pragma once
+
+#include "vertex.hpp"
+#include <glm/glm.hpp>
+#include <glm/packing.hpp>
+#include <cmath>
+#include <vector>
+
+// CPU˵Vertexתѹʽtest.vertеoctDecode
+class VertexPacker {
+public:
+	// ûйPACKED_STATICŶܷŽuint8PACKED_SKINNEDSTANDARD
+	static VertexLayout chooseLayout(const std::vector<Vertex>& vertices);
+	static std::vector<PackedVertex> packStatic(const std::vector<Vertex>& vertices);
+	static std::vector<PackedSkinnedVertex> packSkinned(const std::vector<Vertex>& vertices);
+
+	static glm::vec2 octEncode(glm::vec3 n);
+private:
+	template <typename T>
+	static void packCommon(const Vertex& vertex, T& packed);
+};
+
+VertexLayout VertexPacker::chooseLayout(const std::vector<Vertex>& vertices) {
+	bool skinned = false;
+	for (const Vertex& vertex : vertices) {
+		for (int i = 0; i < MAX_BONE_INFLUENCE; i++) {
+			if (vertex.boneIDs[i] < 0 || vertex.weights[i] <= 0.0f) continue;
+			if (vertex.boneIDs[i] > 255) return VertexLayout::STANDARD;
+			skinned = true;
+		}
+	}
+	return skinned ? VertexLayout::PACKED_SKINNED : VertexLayout::PACKED_STATIC;
+}
+
+glm::vec2 VertexPacker::octEncode(glm::vec3 n) {
+	float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+	if (length < 1e-6f) return glm::vec2(0.0f);
+	n /= length;
+	glm::vec2 encoded(n.x, n.y);
+	if (n.z < 0.0f) {
+		// °ضԽ۵
+		encoded.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+		encoded.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+	}
+	return encoded;
+}
+
+template <typename T>
+void VertexPacker::packCommon(const Vertex& vertex, T& packed) {
+	packed.position = vertex.position;
+	packed.normal = glm::packSnorm2x16(octEncode(vertex.normal));
+	// ֻcross(N, T)ķ򣬾UVʱΪ-1
+	float handedness = glm::dot(glm::cross(vertex.normal, vertex.tangent), vertex.bitangent) < 0.0f ? -1.0f : 1.0f;
+	packed.tangent = glm::packSnorm4x8(glm::vec4(octEncode(vertex.tangent), handedness, 0.0f));
+	packed.texCoords = glm::packHalf2x16(vertex.texCoords);
+}
+
+std::vector<PackedVertex> VertexPacker::packStatic(const std::vector<Vertex>& vertices) {
+	std::vector<PackedVertex> packed(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		packCommon(vertices[i], packed[i]);
+	}
+	return packed;
+}
+
+std::vector<PackedSkinnedVertex> VertexPacker::packSkinned(const std::vector<Vertex>& vertices) {
+	std::vector<PackedSkinnedVertex> packed(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		const Vertex& vertex = vertices[i];
+		PackedSkinnedVertex& result = packed[i];
+		packCommon(vertex, result);
+		// δʹõĲλΪ0ȨΪ0ɫȨΪ0Ĳλ
+		float weights[MAX_BONE_INFLUENCE] = {};
+		float sum = 0.0f;
+		for (int j = 0; j < MAX_BONE_INFLUENCE; j++) {
+			bool used = vertex.boneIDs[j] >= 0 && vertex.weights[j] > 0.0f;
+			result.boneIDs[j] = used ? (uint8_t)vertex.boneIDs[j] : 0;
+			weights[j] = used ? vertex.weights[j] : 0.0f;
+			sum += weights[j];
+		}
+		// ܺͱΪ255ӵȨ
+		int quantized[MAX_BONE_INFLUENCE] = {};
+		int total = 0, largest = 0;
+		for (int j = 0; j < MAX_BONE_INFLUENCE && sum > 0.0f; j++) {
+			quantized[j] = (int)std::round(weights[j] / sum * 255.0f);
+			total += quantized[j];
+			if (quantized[j] > quantized[largest]) largest = j;
+		}
+		if (sum > 0.0f) {
+			quantized[largest] += 255 - total;
+		}
+		result.weights = 0;
+		for (int j = 0; j < MAX_BONE_INFLUENCE; j++) {
+			result.weights |= (uint32_t)quantized[j] << (j * 8);
+		}
+	}
+	return packed;
+}
+
+#endif // !VERTEXPACKER_HPP